@@ -2,7 +2,34 @@
 
 int main(int argc, char** argv){
 
-	Analyzer analyzer(argv[1], argv[2]);	
+	if (argc < 3) {
+
+		std::cerr << "This program takes two to six parameters:\n";
+
+		std::cerr << "The 1st parameter specifies the MRT dump file.\n";
+
+		std::cerr << "The 2nd parameter specifies the output file.\n";
+
+		std::cerr << "The 3rd parameter (optional) specifies the output, 0 for table (default) and 1 for update.\n";
+
+		std::cerr << "The 4th parameter (optional) specifies the address family, 0 for IPv4 (default), 1 for IPv6 and 2 for both in separate files.\n";
+
+		std::cerr << "The 5th parameter (optional) prints each entry to stdout if 1, 0 by default.\n";
+
+		std::cerr << "The 6th parameter (optional) appends the peer as the nexthop of each prefix, 0 for none (default), 1 for the first peer and 2 for the peer with the shortest AS path.\n";
+
+		exit(0);
+	}
+
+	int mode = argc > 3 ? atoi(argv[3]) : 0;
+
+	int family = argc > 4 ? atoi(argv[4]) : 0;
+
+	bool verbose = argc > 5 && 0 != atoi(argv[5]);
+
+	int nexthop = argc > 6 ? atoi(argv[6]) : 0;
+
+	Analyzer analyzer(argv[1], argv[2], mode, family, verbose, nexthop);
 
 	analyzer.generate();
 
@@ -29,10 +29,15 @@ Author: Dan Ardelean (dan@ripe.net)
 #define _ANALYZER_H
 
 #include "../external/bgpdump/bgpdump_lib.h"
+#include "mrtreader.h"
 #include <time.h>
 
 #include <stdlib.h>
 #include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <string.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
@@ -40,11 +45,6 @@ Author: Dan Ardelean (dan@ripe.net)
 
 #define BGPDUMP_HAVE_IPV6
 
-//#define OUTPUT_TO_FILE_IPV4_TABLE
-//#define OUTPUT_TO_FILE_IPV6_TABLE
-//#define OUTPUT_TO_FILE_IPV4_UPDATE
-#define OUTPUT_TO_FILE_IPV6_UPDATE
-
 static const char* bgp_state_name[] = {
 		"Unknown",
 		"IDLE",
@@ -119,21 +119,180 @@ static const char *notify_subcodes[][12] = {
 
 	};
 
+/// \brief buffered writer of the prefix lines
+///
+/// The lines are formatted into a large buffer and written in blocks, rather than flushed one by one.
+class PrefixWriter {
+
+private:
+
+	std::ofstream mFout; ///< output file
+
+	std::vector<char> mBuffer; ///< buffered lines
+
+	size_t mSize; ///< number of bytes in the buffer
+
+	size_t mLineNum; ///< number of lines written
+
+public:
+
+	PrefixWriter() : mSize(0), mLineNum(0) {}
+
+	~PrefixWriter() {
+
+		flush();
+	}
+
+	/// \brief open the output file
+	///
+	/// \param _capacity size of the buffer in bytes
+	void open(const std::string& _fn, const size_t _capacity = 1 << 20) {
+
+		mFout.open(_fn, std::ios_base::binary);
+
+		if (!mFout) {
+
+			std::cerr << "cannot open " << _fn << "\n";
+
+			exit(1);
+		}
+
+		mBuffer.resize(_capacity);
+
+		return;
+	}
+
+	/// \brief append a line of "prefix length tail"
+	void writeLine(const char* _prefix, const int _length, const char* _tail) {
+
+		char line[BGPDUMP_ADDRSTRLEN + 64];
+
+		size_t len = strlen(_prefix);
+
+		memcpy(line, _prefix, len);
+
+		line[len++] = ' ';
+
+		// length has at most three digits
+		if (_length >= 100) line[len++] = '0' + _length / 100;
+
+		if (_length >= 10) line[len++] = '0' + _length / 10 % 10;
+
+		line[len++] = '0' + _length % 10;
+
+		size_t tailLen = strlen(_tail);
+
+		memcpy(line + len, _tail, tailLen);
+
+		len += tailLen;
+
+		line[len++] = '\n';
+
+		write(line, len);
+
+		++mLineNum;
+
+		return;
+	}
+
+	/// \brief append raw bytes
+	void write(const char* _data, const size_t _len) {
+
+		if (mSize + _len > mBuffer.size()) flush();
+
+		memcpy(&mBuffer[mSize], _data, _len);
+
+		mSize += _len;
+
+		return;
+	}
+
+	/// \brief write out the buffer
+	void flush() {
+
+		if (0 == mSize) return;
+
+		mFout.write(&mBuffer[0], mSize);
+
+		mSize = 0;
+
+		return;
+	}
+
+	/// \brief number of lines written
+	size_t getLineNum() const {
+
+		return mLineNum;
+	}
+};
+
+/// \brief convert MRT dumps into the table and update files of the index
+///
+/// Two kinds of output are supported (mode): 0 for table, i.e., the prefixes in the RIB dumps (TABLE_DUMP and TABLE_DUMP_V2) as "prefix length type" lines,
+/// and 1 for update, i.e., the withdrawn and announced prefixes in the BGP4MP updates as "prefix length 0/1" lines.
+/// The address family (family) is 0 for IPv4, 1 for IPv6 or 2 for both, in which case the IPv4 and IPv6 prefixes are written
+/// into two files named by the output file with suffixes "_ipv4" and "_ipv6".
+/// The human-readable dump of each entry to stdout (verbose) is off by default, as printing dominates the conversion.
+///
+/// A peer ID can be appended to each line as the nexthop of the prefix (nexthop): 0 for none, 1 for the first peer of a RIB entry
+/// and 2 for the peer with the shortest AS path (the first one of a tie). An update takes the peer sending it in either case.
+/// The ID of a peer is its IPv4 address as an integer, or a 32-bit hash of its IPv6 address, thus consistent across the RIB dumps and updates.
 class Analyzer {
 
 private:
 	
 	const std::string dfn; /// dump file
 
-	std::ofstream ofout; /// output IPs
+	int mMode; ///< 0 for table and 1 for update
+
+	int mFamily; ///< 0 for IPv4, 1 for IPv6 and 2 for both
+
+	bool mVerbose; ///< dump each entry to stdout
+
+	int mNexthop; ///< 0 for no nexthop, 1 for the first peer and 2 for the peer with the shortest AS path
+
+	PrefixWriter mWriter[2]; ///< writers of IPv4 and IPv6 prefixes, a single one is used unless both families are written
 
 public:
 
-	Analyzer(const std::string & _dfn, const std::string & _ofn) : 
+	/// \brief ctor
+	///
+	/// \param _dfn dump file, in MRT format, possibly compressed
+	/// \param _ofn output file
+	/// \param _mode 0 for table and 1 for update
+	/// \param _family 0 for IPv4, 1 for IPv6 and 2 for both
+	/// \param _verbose dump each entry to stdout
+	/// \param _nexthop 0 for no nexthop, 1 for the first peer and 2 for the peer with the shortest AS path
+	Analyzer(const std::string & _dfn, const std::string & _ofn, const int _mode = 0, const int _family = 0, const bool _verbose = false, const int _nexthop = 0) : 
 		dfn(_dfn),
-		ofout(_ofn, std::ios_base::binary) {}
+		mMode(_mode),
+		mFamily(_family),
+		mVerbose(_verbose),
+		mNexthop(_nexthop) {
+
+		if (2 == mFamily) {
+
+			mWriter[0].open(_ofn + "_ipv4");
 
+			mWriter[1].open(_ofn + "_ipv6");
+		}
+		else {
+
+			mWriter[0].open(_ofn);
+		}
+	}
+
+	/// \brief convert the dump file
+	///
+	/// An uncompressed file is decoded in place by MrtReader, unless each entry is to be printed, which requires libbgpdump.
 	void generate() {
+
+		if (!mVerbose && !MrtReader::isCompressed(dfn)) {
+
+			generateMapped();
+
+			return;
+		}
 		
 		BGPDUMP* dump;
 
@@ -141,6 +300,13 @@ public:
 		
 		dump = bgpdump_open_dump(dfn.c_str());
 
+		if (nullptr == dump) {
+
+			std::cerr << "cannot open " << dfn << "\n";
+
+			exit(1);
+		}
+
 		do {
 
 			entry = bgpdump_read_next(dump);
@@ -155,9 +321,294 @@ public:
 	
 		bgpdump_close_dump(dump);
 
+		for (auto& writer : mWriter) {
+
+			writer.flush();
+		}
+
+		report();
 	}
 
+	/// \brief convert an uncompressed dump file through a memory mapping
+	void generateMapped() {
+
+		MrtReader reader;
+
+		if (!reader.open(dfn)) {
+
+			std::cerr << "cannot open " << dfn << "\n";
+
+			exit(1);
+		}
+
+		uint32 bestPeer = 0; // peer of the RIB entry chosen so far
+
+		uint16 bestPathLength = 0; // AS path length of the RIB entry chosen so far
+
+		reader.forEach([&](const MrtPrefix& _prefix) {
+
+			uint32 peer = getPeerId(_prefix.peerAfi, _prefix.peerIp);
+
+			switch (_prefix.type) {
+
+			case 12: // TABLE_DUMP
+
+				if (0 == mMode) writePrefix(_prefix.afi, _prefix.addr, _prefix.length, " BGPDUMP_TYPE_MRTD_TABLE_DUMP", peer);
+
+				break;
+
+			case 13: // TABLE_DUMP_V2, a prefix per record rather than per peer, written after its last entry
+
+				if (0 != mMode) break;
+
+				if (0 == _prefix.entryNum) { // no entry, written with peer 0 as extract() does
+
+					writePrefix(_prefix.afi, _prefix.addr, _prefix.length, " BGPDUMP_TYPE_TABLE_DUMP_V2", 0);
+
+					break;
+				}
+
+				if (0 == _prefix.entry || (2 == mNexthop && _prefix.pathLength < bestPathLength)) {
+
+					bestPeer = peer;
+
+					bestPathLength = _prefix.pathLength;
+				}
+
+				if (_prefix.entry + 1 == _prefix.entryNum) writePrefix(_prefix.afi, _prefix.addr, _prefix.length, " BGPDUMP_TYPE_TABLE_DUMP_V2", bestPeer);
+
+				break;
+
+			default: // BGP4MP
+
+				if (1 == mMode) writePrefix(_prefix.afi, _prefix.addr, _prefix.length, _prefix.announce ? " 1" : " 0", peer);
+			}
+		});
+
+		for (auto& writer : mWriter) {
+
+			writer.flush();
+		}
+
+		if (0 != reader.getErrorNum()) std::cerr << "malformed record num: " << reader.getErrorNum() << std::endl;
+
+		report();
+
+		return;
+	}
+
+	/// \brief print the number of prefixes written
+	void report() const {
+
+		if (2 == mFamily) {
+
+			std::cerr << "ipv4 prefix num: " << mWriter[0].getLineNum() << " ipv6 prefix num: " << mWriter[1].getLineNum() << std::endl;
+		}
+		else {
+
+			std::cerr << (0 == mFamily ? "ipv4" : "ipv6") << " prefix num: " << mWriter[0].getLineNum() << std::endl;
+		}
+
+		return;
+	}
+
+	/// \brief write a prefix of the selected family
+	///
+	/// \param _afi AFI_IP or AFI_IP6
+	/// \param _addr address of the prefix, in network order
+	/// \param _tail rest of the line following the length
+	/// \param _peer peer ID, appended if the nexthops are written
+	void writePrefix(const int _afi, const void* _addr, const int _length, const char* _tail, const uint32 _peer = 0) {
+
+		int family = AFI_IP == _afi ? 0 : 1;
+
+		if (2 != mFamily && family != mFamily) return;
+
+		char prefix[BGPDUMP_ADDRSTRLEN];
+
+		inet_ntop(0 == family ? AF_INET : AF_INET6, _addr, prefix, sizeof(prefix));
+
+		if (0 != mNexthop) {
+
+			char tail[64];
+
+			snprintf(tail, sizeof(tail), "%s %u", _tail, _peer);
+
+			mWriter[2 == mFamily ? family : 0].writeLine(prefix, _length, tail);
+		}
+		else {
+
+			mWriter[2 == mFamily ? family : 0].writeLine(prefix, _length, _tail);
+		}
+
+		return;
+	}
+
+	/// \brief ID of a peer, the IPv4 address as an integer or the FNV-1a hash of the IPv6 address
+	///
+	/// \param _afi AFI_IP or AFI_IP6
+	/// \param _ip address of the peer, in network order
+	static uint32 getPeerId(const int _afi, const void* _ip) {
+
+		const unsigned char* ip = static_cast<const unsigned char*>(_ip);
+
+		if (AFI_IP == _afi) return (static_cast<uint32>(ip[0]) << 24) | (static_cast<uint32>(ip[1]) << 16) | (static_cast<uint32>(ip[2]) << 8) | ip[3];
+
+		uint32 hash = 2166136261u;
+
+		for (int i = 0; i < 16; ++i) {
+
+			hash = (hash ^ ip[i]) * 16777619u;
+		}
+
+		return hash;
+	}
+
+	/// \brief number of ASes in the AS path of an entry, 0xffff if absent
+	static uint16 getPathLength(const attributes_t* _attr) {
+
+		if (nullptr == _attr || 0 == (_attr->flag & ATTR_FLAG_BIT(BGP_ATTR_AS_PATH)) || nullptr == _attr->aspath) return 0xffff;
+
+		return static_cast<uint16>(std::min(_attr->aspath->count, 0xfffe));
+	}
+
+	/// \brief call _func(afi, address, length, announce) for each prefix withdrawn or announced in a BGP4MP update
+	///
+	/// The withdrawn prefixes go first, then the announced ones, IPv4 before IPv6 in each, as in the message.
+	/// Only the messages (subtypes MESSAGE, MESSAGE_AS4, MESSAGE_LOCAL and MESSAGE_AS4_LOCAL) are decoded, and the unicast prefixes of both AFIs in MP_REACH_NLRI and MP_UNREACH_NLRI,
+	/// the same as MrtReader.
+	template<typename F>
+	static void forEachUpdate(BGPDUMP_ENTRY *entry, F _func) {
+
+		if (BGPDUMP_TYPE_ZEBRA_BGP != entry->type) return;
+
+		switch (entry->subtype) {
+
+		case BGPDUMP_SUBTYPE_ZEBRA_BGP_MESSAGE:
+		case BGPDUMP_SUBTYPE_ZEBRA_BGP_MESSAGE_AS4:
+		case BGPDUMP_SUBTYPE_ZEBRA_BGP_MESSAGE_LOCAL:
+		case BGPDUMP_SUBTYPE_ZEBRA_BGP_MESSAGE_AS4_LOCAL:
+
+			break;
+
+		default:
+
+			return;
+		}
+
+		if (BGP_MSG_UPDATE != entry->body.zebra_message.type) return;
+
+		for (int i = 0; i < entry->body.zebra_message.withdraw_count; ++i) {
+
+			_func(AFI_IP, &entry->body.zebra_message.withdraw[i].address, entry->body.zebra_message.withdraw[i].len, false);
+		}
+
+		struct mp_info* mp = nullptr != entry->attr ? entry->attr->mp_info : nullptr;
+
+		for (int afi = AFI_IP; nullptr != mp && afi <= BGPDUMP_MAX_AFI; ++afi) {
+
+			struct mp_nlri* mp_withdraw = mp->withdraw[afi][SAFI_UNICAST];
+
+			for (int i = 0; nullptr != mp_withdraw && i < mp_withdraw->prefix_count; ++i) {
+
+				_func(afi, &mp_withdraw->nlri[i].address, mp_withdraw->nlri[i].len, false);
+			}
+		}
+
+		for (int i = 0; i < entry->body.zebra_message.announce_count; ++i) {
+
+			_func(AFI_IP, &entry->body.zebra_message.announce[i].address, entry->body.zebra_message.announce[i].len, true);
+		}
+
+		for (int afi = AFI_IP; nullptr != mp && afi <= BGPDUMP_MAX_AFI; ++afi) {
+
+			struct mp_nlri* mp_announce = mp->announce[afi][SAFI_UNICAST];
+
+			for (int i = 0; nullptr != mp_announce && i < mp_announce->prefix_count; ++i) {
+
+				_func(afi, &mp_announce->nlri[i].address, mp_announce->nlri[i].len, true);
+			}
+		}
+
+		return;
+	}
+
+	/// \brief write the prefixes in an entry
+	void extract(BGPDUMP_ENTRY *entry) {
+
+		switch (entry->type) {
+
+		case BGPDUMP_TYPE_MRTD_TABLE_DUMP:
+
+			if (0 != mMode) break;
+
+			// a prefix longer than the address is malformed, skipped as MrtReader does
+			if ((AFI_IP == entry->subtype || AFI_IP6 == entry->subtype) && entry->body.mrtd_table_dump.mask <= (AFI_IP == entry->subtype ? 32 : 128)) {
+
+				writePrefix(entry->subtype, &entry->body.mrtd_table_dump.prefix, entry->body.mrtd_table_dump.mask, " BGPDUMP_TYPE_MRTD_TABLE_DUMP",
+					getPeerId(entry->subtype, &entry->body.mrtd_table_dump.peer_ip));
+			}
+
+			break;
+
+		case BGPDUMP_TYPE_TABLE_DUMP_V2: {
+
+			if (0 != mMode) break;
+
+			BGPDUMP_TABLE_DUMP_V2_PREFIX* e = &entry->body.mrtd_table_dump_v2_prefix;
+
+			if (AFI_IP == e->afi || AFI_IP6 == e->afi) {
+
+				// choose the entry of the nexthop, the first one by default
+				int best = 0;
+
+				for (int i = 1; 2 == mNexthop && i < e->entry_count; ++i) {
+
+					if (getPathLength(e->entries[i].attr) < getPathLength(e->entries[best].attr)) best = i;
+				}
+
+				uint32 peer = e->entry_count > 0 ? getPeerId(e->entries[best].peer->afi, &e->entries[best].peer->peer_ip) : 0;
+
+				writePrefix(e->afi, &e->prefix, e->prefix_length, " BGPDUMP_TYPE_TABLE_DUMP_V2", peer);
+			}
+
+			break;
+		}
+
+		case BGPDUMP_TYPE_ZEBRA_BGP: {
+
+			if (1 != mMode) break;
+
+			uint32 peer = getPeerId(entry->body.zebra_message.address_family, &entry->body.zebra_message.source_ip);
+
+			forEachUpdate(entry, [this, peer](const int _afi, const BGPDUMP_IP_ADDRESS* _addr, const int _length, const bool _announce) {
+
+				writePrefix(_afi, _addr, _length, _announce ? " 1" : " 0", peer);
+			});
+
+			break;
+		}
+
+		default:
+
+			break;
+		}
+
+		return;
+	}
+
+	/// \brief process an entry, the human-readable dump is printed only in verbose mode
 	void process(BGPDUMP_ENTRY *entry) {
+
+		if (mVerbose) show(entry);
+
+		extract(entry);
+
+		return;
+	}
+
+	/// \brief print an entry to stdout
+	void show(BGPDUMP_ENTRY *entry) {
 		char prefix[BGPDUMP_ADDRSTRLEN], peer_ip[BGPDUMP_ADDRSTRLEN];
 		char source_ip[BGPDUMP_ADDRSTRLEN], destination_ip[BGPDUMP_ADDRSTRLEN];
 		struct mp_nlri *mp_announce, *mp_withdraw;
@@ -178,10 +629,6 @@ public:
 
 				strcpy(peer_ip, inet_ntoa(entry->body.mrtd_table_dump.peer_ip.v4_addr));
 
-#ifdef OUTPUT_TO_FILE_IPV4_TABLE	
-
-				ofout << prefix << " " << int(entry->body.mrtd_table_dump.mask) << " BGPDUMP_TYPE_MRTD_TABLE_DUMP" << std::endl; 
-#endif
 
 #ifdef BGPDUMP_HAVE_IPV6
 			}
@@ -192,9 +639,6 @@ public:
 				inet_ntop(AF_INET6, &entry->body.mrtd_table_dump.peer_ip.v6_addr, peer_ip,
 					sizeof(peer_ip));
 
-#ifdef OUTPUT_TO_FILE_IPV6_TABLE	
-				ofout << prefix << " " << int(entry->body.mrtd_table_dump.mask) << " BGPDUMP_TYPE_MRTD_TABLE_DUMP" << std::endl; 
-#endif
 
 #endif
 			}
@@ -222,10 +666,6 @@ public:
 
 				strcpy(prefix, inet_ntoa(e->prefix.v4_addr));
 
-#ifdef OUTPUT_TO_FILE_IPV4_TABLE
-
-				ofout << prefix << " " << int(e->prefix_length) << " BGPDUMP_TYPE_TABLE_DUMP_V2" << std::endl;
-#endif
 
 #ifdef BGPDUMP_HAVE_IPV6
 			}
@@ -233,10 +673,6 @@ public:
 
 				inet_ntop(AF_INET6, &e->prefix.v6_addr, prefix, INET6_ADDRSTRLEN);
 
-#ifdef OUTPUT_TO_FILE_IPV6_TABLE
-
-				ofout << prefix << " " << int(e->prefix_length) << " BGPDUMP_TYPE_TABLE_DUMP_V2" << std::endl;
-#endif
 
 #endif
 			}
@@ -318,20 +754,20 @@ public:
 				case BGP_MSG_UPDATE:
 					printf("WITHDRAW        :\n");
 					
-					show_prefixes(entry->body.zebra_message.withdraw_count, entry->body.zebra_message.withdraw, false);
+					show_prefixes(entry->body.zebra_message.withdraw_count, entry->body.zebra_message.withdraw);
 
 #ifdef BGPDUMP_HAVE_IPV6
 					if (entry->attr->mp_info &&
 						(mp_withdraw = MP_IPV6_WITHDRAW(entry->attr->mp_info)) != NULL) {
-						show_v6_prefixes(mp_withdraw->prefix_count, mp_withdraw->nlri, false);
+						show_v6_prefixes(mp_withdraw->prefix_count, mp_withdraw->nlri);
 					}
 #endif
 					printf("ANNOUNCE        :\n");
-					show_prefixes(entry->body.zebra_message.announce_count, entry->body.zebra_message.announce, true);
+					show_prefixes(entry->body.zebra_message.announce_count, entry->body.zebra_message.announce);
 #ifdef BGPDUMP_HAVE_IPV6
 					if (entry->attr->mp_info &&
 						(mp_announce = MP_IPV6_ANNOUNCE(entry->attr->mp_info)) != NULL) {
-						show_v6_prefixes(mp_announce->prefix_count, mp_announce->nlri, true);
+						show_v6_prefixes(mp_announce->prefix_count, mp_announce->nlri);
 					}
 #endif
 					break;
@@ -466,26 +902,18 @@ public:
 		}
 	}
 
-	void show_prefixes(int count, struct prefix *prefix, bool announce) {
+	void show_prefixes(int count, struct prefix *prefix) {
 		int i;
 		for (i = 0; i < count; i++) {
 
 			printf("      %s/%d\n", inet_ntoa(prefix[i].address.v4_addr), prefix[i].len);
 
-#ifdef OUTPUT_TO_FILE_IPV4_UPDATE
-
-			ofout << inet_ntoa(prefix[i].address.v4_addr) << " ";
-
-			ofout << int(prefix[i].len) << " ";
-
-			ofout << ((true == announce) ? 1 : 0) << std::endl; // ! output
-#endif
 
 		}
 	}
 
 #ifdef BGPDUMP_HAVE_IPV6
-	void show_v6_prefixes(int count, struct prefix *prefix, bool announce) {
+	void show_v6_prefixes(int count, struct prefix *prefix) {
 		int i;
 		char str[INET6_ADDRSTRLEN];
 
@@ -494,14 +922,6 @@ public:
 
 			printf("      %s/%d\n", str, prefix[i].len);
 
-#ifdef OUTPUT_TO_FILE_IPV6_UPDATE
-
-			ofout << str << " ";
-
-			ofout << int(prefix[i].len) << " ";
-
-			ofout << ((true == announce) ? 1 : 0) << std::endl; // ! output
-#endif
 
 		}
 	}
@@ -0,0 +1,37 @@
+#include "common/cachesim.h"
+
+int main(int argc, char** argv){
+
+	if (argc < 2) {
+
+		std::cerr << "This program takes one to five parameters:\n";
+
+		std::cerr << "The 1st parameter specifies the access log, written by generateAccessLog.\n";
+
+		std::cerr << "The 2nd parameter (optional) specifies the size of L1 in KB, 32 by default.\n";
+
+		std::cerr << "The 3rd parameter (optional) specifies the size of L2 in KB, 1024 by default.\n";
+
+		std::cerr << "The 4th parameter (optional) specifies the size of LLC in KB, 8192 by default.\n";
+
+		std::cerr << "The 5th parameter (optional) specifies the size of a page in KB, 4 by default.\n";
+
+		exit(0);
+	}
+
+	size_t l1 = argc > 2 ? atoi(argv[2]) : 32;
+
+	size_t l2 = argc > 3 ? atoi(argv[3]) : 1024;
+
+	size_t llc = argc > 4 ? atoi(argv[4]) : 8192;
+
+	size_t page = argc > 5 ? atoi(argv[5]) : 4;
+
+	utility::CacheSim sim(l1, l2, llc, page);
+
+	sim.replay(argv[1]);
+
+	sim.report();
+
+	return 0;
+}
@@ -0,0 +1,287 @@
+#ifndef _ACCESSLOG_H
+#define _ACCESSLOG_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file accesslog.h
+/// \brief Log of the memory accesses made by the lookups, for cache simulation.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "utility.h"
+
+#include <vector>
+#include <cstring>
+
+
+NAMESPACE_UTILITY_BEG
+
+/// \brief Log of the memory accesses of the lookups.
+///
+/// An index with a log attached (see setAccessLog() of the trees) records the address and the size of each node or entry touched by search(),
+/// in parallel with the stage trace, so that the log can be replayed by CacheSim to predict the hit rates of the caches and TLBs
+/// for a node layout and a table size, without running on the target CPU.
+///
+/// The log is a binary file with an 8-byte magic "IPACCLOG", followed by a record per access and a mark at the end of each lookup.
+/// A record is the size of the access as a varint (LEB128), then the difference from the address of the previous access as a zigzag varint,
+/// thus about 4 bytes per access for nodes allocated nearby. A size of 0 marks the end of a lookup.
+class AccessLog{
+
+private:
+
+	std::ofstream mFout; ///< log file
+
+	std::vector<char> mBuffer; ///< pending bytes
+
+	uint64 mPrevAddr; ///< address of the previous access
+
+	size_t mAccessNum; ///< number of accesses
+
+	size_t mLookupNum; ///< number of lookups
+
+	uint64 mByteNum; ///< number of bytes accessed
+
+	static const size_t CAPACITY = 1 << 20; ///< bytes buffered before writing
+
+	/// \brief append a varint
+	void putVarint(uint64 _value) {
+
+		while (_value >= 0x80) {
+
+			mBuffer.push_back(static_cast<char>((_value & 0x7f) | 0x80));
+
+			_value >>= 7;
+		}
+
+		mBuffer.push_back(static_cast<char>(_value));
+
+		return;
+	}
+
+	/// \brief read a varint
+	///
+	/// \return false at the end of the file
+	static bool getVarint(std::istream& _fin, uint64& _value) {
+
+		_value = 0;
+
+		for (int shift = 0; shift < 64; shift += 7) {
+
+			int byte = _fin.get();
+
+			if (EOF == byte) return false;
+
+			_value |= static_cast<uint64>(byte & 0x7f) << shift;
+
+			if (0 == (byte & 0x80)) return true;
+		}
+
+		return false;
+	}
+
+public:
+
+	/// \brief ctor
+	AccessLog() : mPrevAddr(0), mAccessNum(0), mLookupNum(0), mByteNum(0) {}
+
+	/// \brief dtor
+	~AccessLog() {
+
+		close();
+	}
+
+	/// \brief open the log file for writing
+	void open(const std::string& _fn) {
+
+		mFout.open(_fn, std::ios_base::binary);
+
+		if (!mFout) {
+
+			std::cerr << "cannot open " << _fn << "\n";
+
+			exit(1);
+		}
+
+		mFout.write("IPACCLOG", 8);
+
+		mBuffer.reserve(CAPACITY + 32);
+
+		mPrevAddr = 0;
+
+		return;
+	}
+
+	/// \brief write the pending bytes and close the log file
+	void close() {
+
+		if (!mFout.is_open()) return;
+
+		flush();
+
+		mFout.close();
+
+		return;
+	}
+
+	/// \brief write the pending bytes
+	void flush() {
+
+		mFout.write(mBuffer.data(), mBuffer.size());
+
+		mBuffer.clear();
+
+		return;
+	}
+
+	/// \brief record an access
+	///
+	/// \param _addr address of the node or entry
+	/// \param _size number of bytes accessed, larger than 0
+	void record(const void* _addr, const uint32 _size) {
+
+		uint64 addr = reinterpret_cast<uintptr_t>(_addr);
+
+		int64 delta = static_cast<int64>(addr - mPrevAddr);
+
+		putVarint(_size);
+
+		putVarint((static_cast<uint64>(delta) << 1) ^ static_cast<uint64>(delta >> 63)); // zigzag
+
+		mPrevAddr = addr;
+
+		++mAccessNum;
+
+		mByteNum += _size;
+
+		if (mBuffer.size() >= CAPACITY) flush();
+
+		return;
+	}
+
+	/// \brief mark the end of a lookup
+	void endLookup() {
+
+		putVarint(0);
+
+		++mLookupNum;
+
+		return;
+	}
+
+	/// \brief number of accesses recorded
+	size_t getAccessNum() const {
+
+		return mAccessNum;
+	}
+
+	/// \brief number of lookups recorded
+	size_t getLookupNum() const {
+
+		return mLookupNum;
+	}
+
+	/// \brief print the numbers of accesses and bytes per lookup
+	void report() const {
+
+		double lookupnum = std::max(static_cast<size_t>(1), mLookupNum);
+
+		std::cerr << "lookup num: " << mLookupNum << " access num: " << mAccessNum << " accesses per lookup: " << mAccessNum / lookupnum
+			<< " bytes per lookup: " << mByteNum / lookupnum << std::endl;
+
+		return;
+	}
+
+	/// \brief replay a log, calling _func(addr, size) for each access and _func(0, 0) at the end of each lookup
+	///
+	/// \return false if the file is not an access log
+	template<typename F>
+	static bool replay(const std::string& _fn, F _func) {
+
+		std::ifstream fin(_fn, std::ios_base::binary);
+
+		if (!fin) {
+
+			std::cerr << "cannot open " << _fn << "\n";
+
+			exit(1);
+		}
+
+		char magic[8];
+
+		if (!fin.read(magic, sizeof(magic)) || 0 != memcmp(magic, "IPACCLOG", sizeof(magic))) return false;
+
+		uint64 addr = 0, size, zigzag;
+
+		while (getVarint(fin, size)) {
+
+			if (0 == size) {
+
+				_func(0, 0);
+
+				continue;
+			}
+
+			if (!getVarint(fin, zigzag)) break;
+
+			addr += static_cast<uint64>(static_cast<int64>(zigzag >> 1) ^ -static_cast<int64>(zigzag & 1));
+
+			_func(addr, static_cast<uint32>(size));
+		}
+
+		return true;
+	}
+};
+
+/// \brief log the memory accesses of the lookups in a request file
+///
+/// \param W 32 or 128 for IPv4 or IPv6
+/// \param _index index with search(ip) and setAccessLog(), e.g., any of the trees
+/// \param _reqFile requests, see generateSearchRequest
+/// \param _logFile access log
+/// \param _num at most _num requests are looked up, all of them if 0
+template<int W, typename T>
+void generateAccessLog(T& _index, const std::string& _reqFile, const std::string& _logFile, const size_t _num = 0) {
+
+	std::ifstream fin(_reqFile, std::ios_base::binary);
+
+	if (!fin) {
+
+		std::cerr << "cannot open " << _reqFile << "\n";
+
+		exit(1);
+	}
+
+	AccessLog log;
+
+	log.open(_logFile);
+
+	_index.setAccessLog(&log);
+
+	std::vector<typename choose_ip_type<W>::ip_type> batch;
+
+	while ((0 == _num || log.getLookupNum() < _num) && readRequestBatch(fin, batch)) {
+
+		for (size_t i = 0; i < batch.size() && (0 == _num || log.getLookupNum() < _num); ++i) {
+
+			_index.search(batch[i]);
+
+			log.endLookup();
+		}
+	}
+
+	_index.setAccessLog(nullptr);
+
+	log.close();
+
+	log.report();
+
+	return;
+}
+
+NAMESPACE_UTILITY_END
+
+#endif // _ACCESSLOG_H
@@ -0,0 +1,270 @@
+#ifndef _CACHESIM_H
+#define _CACHESIM_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file cachesim.h
+/// \brief Simulator of the caches and TLBs replaying an access log.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "common.h"
+#include "accesslog.h"
+
+#include <vector>
+#include <algorithm>
+
+
+NAMESPACE_UTILITY_BEG
+
+/// \brief A set-associative cache with LRU replacement.
+///
+/// The blocks are cache lines for a data cache, or pages for a TLB, i.e., a TLB of N entries is a cache of N pages.
+class SetAssocCache{
+
+private:
+
+	std::string mName; ///< name in the report
+
+	int mBlockBits; ///< log2 of the block size
+
+	size_t mSetNum; ///< number of sets
+
+	size_t mWayNum; ///< number of ways
+
+	std::vector<uint64> mTags; ///< block number plus one in each way, 0 for invalid
+
+	std::vector<uint64> mStamps; ///< time of the last use of each way
+
+	uint64 mClock; ///< time of accesses
+
+	size_t mHitNum; ///< number of hits
+
+	size_t mMissNum; ///< number of misses
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _name name in the report
+	/// \param _blocknum number of blocks, i.e., lines or TLB entries
+	/// \param _waynum number of ways, a divisor of _blocknum
+	/// \param _blocksize size of a block in bytes, a power of 2
+	SetAssocCache(const std::string& _name, const size_t _blocknum, const size_t _waynum, const size_t _blocksize) :
+		mName(_name), mBlockBits(0), mSetNum(std::max(static_cast<size_t>(1), _blocknum / _waynum)), mWayNum(_waynum),
+		mTags(mSetNum * _waynum, 0), mStamps(mSetNum * _waynum, 0), mClock(0), mHitNum(0), mMissNum(0) {
+
+		assert(0 == (_blocksize & (_blocksize - 1)));
+
+		while ((static_cast<size_t>(1) << mBlockBits) < _blocksize) ++mBlockBits;
+	}
+
+	/// \brief access a byte, and fill its block on a miss
+	///
+	/// \return true for a hit
+	bool access(const uint64 _addr) {
+
+		uint64 block = _addr >> mBlockBits;
+
+		size_t set = static_cast<size_t>(block % mSetNum) * mWayNum;
+
+		++mClock;
+
+		size_t victim = set;
+
+		for (size_t i = set; i < set + mWayNum; ++i) {
+
+			if (block + 1 == mTags[i]) {
+
+				mStamps[i] = mClock;
+
+				++mHitNum;
+
+				return true;
+			}
+
+			if (mStamps[i] < mStamps[victim]) victim = i;
+		}
+
+		mTags[victim] = block + 1;
+
+		mStamps[victim] = mClock;
+
+		++mMissNum;
+
+		return false;
+	}
+
+	/// \brief size of a block in bytes
+	size_t getBlockSize() const {
+
+		return static_cast<size_t>(1) << mBlockBits;
+	}
+
+	/// \brief number of hits
+	size_t getHitNum() const {
+
+		return mHitNum;
+	}
+
+	/// \brief number of misses
+	size_t getMissNum() const {
+
+		return mMissNum;
+	}
+
+	/// \brief print the hit rate and the misses per lookup
+	void report(const size_t _lookupnum) const {
+
+		size_t accessnum = mHitNum + mMissNum;
+
+		std::cerr << mName << "--size: " << mSetNum * mWayNum * getBlockSize() / 1024 << "KB ways: " << mWayNum << " access num: " << accessnum
+			<< " hit rate: " << (0 == accessnum ? 0.0 : static_cast<double>(mHitNum) / accessnum)
+			<< " misses per lookup: " << static_cast<double>(mMissNum) / std::max(static_cast<size_t>(1), _lookupnum) << std::endl;
+
+		return;
+	}
+};
+
+/// \brief Simulator of a memory hierarchy of a core, replaying an access log.
+///
+/// Each access touches every cache line and page it spans.
+/// A line is looked up in L1, then in L2 on a miss and in LLC on a miss again, and filled into each level missed (non-inclusive, LRU).
+/// A page is looked up in the first-level dTLB, then in the second-level STLB.
+/// The default geometry is that of a typical server core: 32KB 8-way L1d, 1MB 16-way L2, 8MB 16-way LLC share, 64-byte lines,
+/// 64-entry 4-way dTLB and 1536-entry 12-way STLB of 4KB pages. All the accesses are loads, and the hardware prefetchers are not modeled.
+class CacheSim{
+
+private:
+
+	std::vector<SetAssocCache> mCaches; ///< L1, L2 and LLC
+
+	std::vector<SetAssocCache> mTlbs; ///< dTLB and STLB
+
+	size_t mLookupNum; ///< number of lookups
+
+	size_t mAccessNum; ///< number of accesses
+
+	/// \brief access a block in a hierarchy, from the first level on
+	static void access(std::vector<SetAssocCache>& _levels, const uint64 _addr) {
+
+		for (auto& level : _levels) {
+
+			if (level.access(_addr)) break;
+		}
+
+		return;
+	}
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _l1 size of L1 in KB
+	/// \param _l2 size of L2 in KB
+	/// \param _llc size of LLC in KB
+	/// \param _page size of a page in KB, e.g., 4 or 2048 for huge pages
+	CacheSim(const size_t _l1 = 32, const size_t _l2 = 1024, const size_t _llc = 8192, const size_t _page = 4) : mLookupNum(0), mAccessNum(0) {
+
+		static const size_t LINE = 64;
+
+		mCaches.push_back(SetAssocCache("L1", _l1 * 1024 / LINE, 8, LINE));
+
+		mCaches.push_back(SetAssocCache("L2", _l2 * 1024 / LINE, 16, LINE));
+
+		mCaches.push_back(SetAssocCache("LLC", _llc * 1024 / LINE, 16, LINE));
+
+		mTlbs.push_back(SetAssocCache("dTLB", 64, 4, _page * 1024));
+
+		mTlbs.push_back(SetAssocCache("STLB", 1536, 12, _page * 1024));
+	}
+
+	/// \brief access _size bytes from _addr
+	void access(const uint64 _addr, const uint32 _size) {
+
+		uint64 end = _addr + _size - 1;
+
+		uint64 line = mCaches[0].getBlockSize();
+
+		for (uint64 addr = _addr & ~(line - 1); addr <= end; addr += line) {
+
+			access(mCaches, addr);
+		}
+
+		uint64 page = mTlbs[0].getBlockSize();
+
+		for (uint64 addr = _addr & ~(page - 1); addr <= end; addr += page) {
+
+			access(mTlbs, addr);
+		}
+
+		++mAccessNum;
+
+		return;
+	}
+
+	/// \brief mark the end of a lookup
+	void endLookup() {
+
+		++mLookupNum;
+
+		return;
+	}
+
+	/// \brief replay an access log
+	void replay(const std::string& _fn) {
+
+		bool valid = AccessLog::replay(_fn, [this](const uint64 _addr, const uint32 _size) {
+
+			if (0 == _size) endLookup();
+			else access(_addr, _size);
+		});
+
+		if (!valid) {
+
+			std::cerr << _fn << " is not an access log\n";
+
+			exit(1);
+		}
+
+		return;
+	}
+
+	/// \brief number of lookups replayed
+	size_t getLookupNum() const {
+
+		return mLookupNum;
+	}
+
+	/// \brief a level of caches, 0 for L1, 1 for L2 and 2 for LLC
+	const SetAssocCache& getCache(const int _level) const {
+
+		return mCaches[_level];
+	}
+
+	/// \brief a level of TLBs, 0 for dTLB and 1 for STLB
+	const SetAssocCache& getTlb(const int _level) const {
+
+		return mTlbs[_level];
+	}
+
+	/// \brief print the hit rates of all the levels
+	void report() const {
+
+		std::cerr << "lookup num: " << mLookupNum << " access num: " << mAccessNum << " accesses per lookup: "
+			<< static_cast<double>(mAccessNum) / std::max(static_cast<size_t>(1), mLookupNum) << std::endl;
+
+		for (auto& cache : mCaches) cache.report(mLookupNum);
+
+		for (auto& tlb : mTlbs) tlb.report(mLookupNum);
+
+		return;
+	}
+};
+
+NAMESPACE_UTILITY_END
+
+#endif // _CACHESIM_H
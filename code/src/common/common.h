@@ -11,11 +11,13 @@
 #include <limits>
 #include <cassert>
 
-static const double LAMBDA = 0.1;// packet arriving probability
+static const double LAMBDA = 0.1;// packet arriving probability (default, see SchedParam)
 
-static const int BURSTSIZE = 1; // number of packets arriving at the same time
+static const int BURSTSIZE = 1; // number of packets arriving at the same time (default, see SchedParam)
 
-static const int QUEUESIZE = 128; // size of queue
+static const int QUEUESIZE = 128; // size of queue (default, see SchedParam)
+
+static const size_t SEARCHBATCH = 4096; // number of lookup requests searched in a row when generating traces
 
 #define _PRINT_MSG_ENABLE //option for enabling printMsg 
 
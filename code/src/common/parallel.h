@@ -0,0 +1,76 @@
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file parallel.h
+/// \brief Helpers for running independent tasks on multiple threads.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "common.h"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+
+NAMESPACE_UTILITY_BEG
+
+/// \brief number of worker threads in use
+///
+/// \param _tasknum number of tasks, no more workers than tasks are created
+inline size_t getWorkerNum(const size_t _tasknum) {
+
+	size_t workernum = std::thread::hardware_concurrency();
+
+	if (0 == workernum) workernum = 1;
+
+	return std::max(static_cast<size_t>(1), std::min(workernum, _tasknum));
+}
+
+/// \brief run _func(i) for each i in [0, _tasknum) on a group of worker threads
+///
+/// Tasks are fetched dynamically, thus tasks of unbalanced sizes are fine.
+/// The caller must guarantee that different tasks do not write the same data.
+template<typename F>
+void parallelFor(const size_t _tasknum, F _func) {
+
+	size_t workernum = getWorkerNum(_tasknum);
+
+	if (1 >= workernum) { // run in the calling thread
+
+		for (size_t i = 0; i < _tasknum; ++i) _func(i);
+
+		return;
+	}
+
+	std::atomic<size_t> next(0);
+
+	std::vector<std::thread> workers;
+
+	for (size_t w = 0; w < workernum; ++w) {
+
+		workers.push_back(std::thread([&]() {
+
+			size_t i;
+
+			while ((i = next.fetch_add(1)) < _tasknum) {
+
+				_func(i);
+			}
+		}));
+	}
+
+	for (auto& worker : workers) worker.join();
+
+	return;
+}
+
+NAMESPACE_UTILITY_END
+
+#endif // _PARALLEL_H
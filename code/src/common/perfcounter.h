@@ -0,0 +1,472 @@
+#ifndef _PERFCOUNTER_H
+#define _PERFCOUNTER_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file perfcounter.h
+/// \brief Hardware performance counters around the build, search, update and scheduling loops.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "common.h"
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <initializer_list>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+NAMESPACE_UTILITY_BEG
+
+/// \brief name of an operation of a class template instance, e.g., getPerfName("RBTree", {32, 10}, "build") for "RBTree<32,10>::build"
+inline std::string getPerfName(const char* _class, std::initializer_list<long long> _params, const char* _op) {
+
+	std::string name(_class);
+
+	name += "<";
+
+	for (auto param : _params) {
+
+		if ('<' != name.back()) name += ",";
+
+		name += std::to_string(param);
+	}
+
+	return name + ">::" + _op;
+}
+
+/// \brief A set of hardware counters for a named operation, e.g., "RBTree<32,10>::build".
+///
+/// Each counter is started and stopped around a loop, and accumulates the events and the number of operations over the runs,
+/// which are reported per operation, e.g., cycles per lookup.
+/// The counters are opened by perf_event_open for the calling thread in user space, which is allowed with perf_event_paranoid up to 2.
+/// Where an event is not supported (e.g., in a virtual machine), it is reported as n/a, and the time stamp counter is always read,
+/// thus without any counter the report falls back to rdtsc (or the steady clock on other than x86).
+///
+/// The counters are opened per thread, thus get() returns the counter of the calling thread, and reportAll() sums up the counters of the same name.
+/// When a thread exits, e.g., a worker of parallelFor(), its counters are added to the totals of their names and closed,
+/// thus the number of counters (and of their file descriptors) is bounded by the threads alive rather than by the threads ever started.
+///
+/// The counters are disabled by default, and enabled by setting the environment variable IPLOOKUP_PERF (to anything but 0) or by setEnabled(),
+/// so that start() and stop() cost nothing but a branch in a normal run.
+class PerfCounter{
+
+public:
+
+	/// \brief events counted
+	enum Event {
+
+		CYCLES = 0,
+
+		INSTRUCTIONS,
+
+		L1D_MISSES,
+
+		LLC_MISSES,
+
+		DTLB_MISSES,
+
+		BRANCH_MISSES,
+
+		EVENT_NUM
+	};
+
+private:
+
+	std::string mName; ///< name of the operation
+
+	int mFd[EVENT_NUM]; ///< file descriptors of the counters, -1 if not supported
+
+	bool mSupported[EVENT_NUM]; ///< whether the counters are supported
+
+	bool mOpened; ///< whether the counters have been opened
+
+	uint64 mBegin[EVENT_NUM]; ///< counts at start()
+
+	uint64 mCount[EVENT_NUM]; ///< counts accumulated
+
+	uint64 mTscBegin; ///< time stamp counter at start()
+
+	uint64 mTsc; ///< time stamp counter accumulated
+
+	size_t mOpNum; ///< number of operations accumulated
+
+	size_t mRunNum; ///< number of runs
+
+	bool mRunning; ///< between start() and stop()
+
+	/// \brief switch of all the counters
+	static bool& enabled() {
+
+		static bool on = nullptr != getenv("IPLOOKUP_PERF") && 0 != strcmp(getenv("IPLOOKUP_PERF"), "0");
+
+		return on;
+	}
+
+	/// \brief counters of the threads alive
+	static std::vector<PerfCounter*>& registry() {
+
+		static std::vector<PerfCounter*> counters;
+
+		return counters;
+	}
+
+	/// \brief counts of the threads exited, one counter per name
+	static std::map<std::string, std::unique_ptr<PerfCounter> >& totals() {
+
+		static std::map<std::string, std::unique_ptr<PerfCounter> > counters;
+
+		return counters;
+	}
+
+	/// \brief counters of a thread, added to the totals and freed when the thread exits
+	struct LocalCounters{
+
+		std::map<std::string, PerfCounter*> counters; ///< counter of each name
+
+		~LocalCounters() {
+
+			std::lock_guard<std::mutex> guard(registryLock());
+
+			std::vector<PerfCounter*>& alive = registry();
+
+			for (auto& local : counters) {
+
+				std::unique_ptr<PerfCounter>& total = totals()[local.first];
+
+				if (nullptr == total) total.reset(new PerfCounter(local.first));
+
+				total->add(*local.second);
+
+				alive.erase(std::find(alive.begin(), alive.end(), local.second));
+
+				delete local.second; // closes the file descriptors
+			}
+		}
+	};
+
+	/// \brief lock of the registry and the totals
+	static std::mutex& registryLock() {
+
+		static std::mutex lock;
+
+		return lock;
+	}
+
+	/// \brief time stamp counter, or nanoseconds of the steady clock
+	static uint64 readTsc() {
+
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	/// \brief open a counter of the calling thread in user space
+	///
+	/// \return file descriptor, or -1 if not supported
+	static int openEvent(const uint32 _type, const uint64 _config) {
+
+		struct perf_event_attr attr;
+
+		memset(&attr, 0, sizeof(attr));
+
+		attr.size = sizeof(attr);
+
+		attr.type = _type;
+
+		attr.config = _config;
+
+		attr.disabled = 1;
+
+		attr.exclude_kernel = 1;
+
+		attr.exclude_hv = 1;
+
+		// the counters are multiplexed if there are more events than hardware counters, thus read the times for scaling
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	/// \brief open all the counters, once
+	void open() {
+
+		const uint64 cache = PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+
+		mFd[CYCLES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+
+		mFd[INSTRUCTIONS] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+
+		mFd[L1D_MISSES] = openEvent(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache);
+
+		mFd[LLC_MISSES] = openEvent(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cache);
+
+		mFd[DTLB_MISSES] = openEvent(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cache);
+
+		mFd[BRANCH_MISSES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+		for (int i = 0; i < EVENT_NUM; ++i) {
+
+			mSupported[i] = -1 != mFd[i];
+		}
+
+		mOpened = true;
+
+		return;
+	}
+
+	/// \brief read a counter, scaled up if it was multiplexed
+	uint64 readEvent(const int _event) const {
+
+		uint64 value[3]; // count, time enabled, time running
+
+		if (-1 == mFd[_event] || sizeof(value) != read(mFd[_event], value, sizeof(value))) return 0;
+
+		if (0 == value[2]) return 0;
+
+		if (value[1] == value[2]) return value[0];
+
+		return static_cast<uint64>(static_cast<double>(value[0]) * value[1] / value[2]);
+	}
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _name name of the operation
+	PerfCounter(const std::string& _name) : mName(_name), mOpened(false), mTscBegin(0), mTsc(0), mOpNum(0), mRunNum(0), mRunning(false) {
+
+		for (int i = 0; i < EVENT_NUM; ++i) {
+
+			mFd[i] = -1;
+
+			mSupported[i] = false;
+
+			mBegin[i] = 0;
+
+			mCount[i] = 0;
+		}
+	}
+
+	/// \brief dtor
+	~PerfCounter() {
+
+		for (int i = 0; i < EVENT_NUM; ++i) {
+
+			if (-1 != mFd[i]) close(mFd[i]);
+		}
+	}
+
+	PerfCounter(const PerfCounter&) = delete;
+
+	PerfCounter& operator= (const PerfCounter&) = delete;
+
+	/// \brief counter of an operation in the calling thread, created at the first call
+	static PerfCounter& get(const std::string& _name) {
+
+		static thread_local LocalCounters local;
+
+		PerfCounter*& counter = local.counters[_name];
+
+		if (nullptr == counter) {
+
+			counter = new PerfCounter(_name);
+
+			std::lock_guard<std::mutex> guard(registryLock());
+
+			registry().push_back(counter);
+		}
+
+		return *counter;
+	}
+
+	/// \brief enable or disable all the counters
+	static void setEnabled(const bool _enabled) {
+
+		enabled() = _enabled;
+	}
+
+	/// \brief whether the counters are enabled
+	static bool isEnabled() {
+
+		return enabled();
+	}
+
+	/// \brief start counting
+	void start() {
+
+		if (!enabled()) return;
+
+		if (!mOpened) open();
+
+		for (int i = 0; i < EVENT_NUM; ++i) {
+
+			if (-1 == mFd[i]) continue;
+
+			mBegin[i] = readEvent(i);
+
+			ioctl(mFd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+
+		mRunning = true;
+
+		mTscBegin = readTsc();
+
+		return;
+	}
+
+	/// \brief stop counting
+	///
+	/// \param _opnum number of operations since start()
+	void stop(const size_t _opnum) {
+
+		if (!enabled() || !mRunning) return;
+
+		mTsc += readTsc() - mTscBegin;
+
+		for (int i = 0; i < EVENT_NUM; ++i) {
+
+			if (-1 == mFd[i]) continue;
+
+			ioctl(mFd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+			mCount[i] += readEvent(i) - mBegin[i];
+		}
+
+		mOpNum += _opnum;
+
+		++mRunNum;
+
+		mRunning = false;
+
+		return;
+	}
+
+	/// \brief add the counts of another counter, e.g., of the same operation in another thread
+	void add(const PerfCounter& _counter) {
+
+		for (int i = 0; i < EVENT_NUM; ++i) {
+
+			mSupported[i] = mSupported[i] || _counter.mSupported[i];
+
+			mCount[i] += _counter.mCount[i];
+		}
+
+		mTsc += _counter.mTsc;
+
+		mOpNum += _counter.mOpNum;
+
+		mRunNum += _counter.mRunNum;
+
+		return;
+	}
+
+	/// \brief whether the counter of an event is supported
+	bool isSupported(const int _event) const {
+
+		return mSupported[_event];
+	}
+
+	/// \brief count of an event accumulated, 0 if not supported
+	uint64 getCount(const int _event) const {
+
+		return mCount[_event];
+	}
+
+	/// \brief time stamp counter accumulated
+	uint64 getTsc() const {
+
+		return mTsc;
+	}
+
+	/// \brief number of operations accumulated
+	size_t getOpNum() const {
+
+		return mOpNum;
+	}
+
+	/// \brief print the counts per operation
+	void report() const {
+
+		static const char* names[EVENT_NUM] = {"cycles", "instructions", "L1d misses", "LLC misses", "dTLB misses", "branch misses"};
+
+		double opnum = std::max(static_cast<size_t>(1), mOpNum);
+
+		std::cerr << mName << "--run num: " << mRunNum << " op num: " << mOpNum << "\n";
+
+		std::cerr << std::fixed << std::setprecision(2) << "\ttsc/op: " << mTsc / opnum;
+
+		for (int i = 0; i < EVENT_NUM; ++i) {
+
+			std::cerr << " " << names[i] << "/op: ";
+
+			if (isSupported(i)) std::cerr << mCount[i] / opnum;
+			else std::cerr << "n/a";
+		}
+
+		if (isSupported(CYCLES) && isSupported(INSTRUCTIONS) && 0 != mCount[CYCLES]) {
+
+			std::cerr << " IPC: " << static_cast<double>(mCount[INSTRUCTIONS]) / mCount[CYCLES];
+		}
+
+		std::cerr << std::defaultfloat << std::endl;
+
+		return;
+	}
+
+	/// \brief print all the counters used, summed up over the threads alive and exited in the order of names
+	static void reportAll() {
+
+		if (!enabled()) return;
+
+		std::map<std::string, std::unique_ptr<PerfCounter> > sums;
+
+		{
+			std::lock_guard<std::mutex> guard(registryLock());
+
+			std::vector<PerfCounter*> counters(registry());
+
+			for (auto& total : totals()) counters.push_back(total.second.get());
+
+			for (auto counter : counters) {
+
+				std::unique_ptr<PerfCounter>& sum = sums[counter->mName];
+
+				if (nullptr == sum) sum.reset(new PerfCounter(counter->mName));
+
+				sum->add(*counter);
+			}
+		}
+
+		std::cerr << "-----Performance counters.\n";
+
+		for (auto& sum : sums) {
+
+			if (0 != sum.second->mRunNum) sum.second->report();
+		}
+
+		return;
+	}
+};
+
+NAMESPACE_UTILITY_END
+
+#endif // _PERFCOUNTER_H
@@ -6,6 +6,10 @@
 #include <chrono>
 #include <algorithm>
 #include <sstream>
+#include <functional>
+#include <vector>
+#include <cmath>
+#include <unordered_map>
 
 
 NAMESPACE_UTILITY_BEG
@@ -28,7 +32,7 @@ struct PairLessCmp1st{
 ///
 /// \param _msg message to print
 /// \param code indicate warning level
-void printMsg(const std::string& _msg, const int code = 0) {
+inline void printMsg(const std::string& _msg, const int code = 0) {
 
 #ifdef _PRINT_MSG_ENABLE
 	std::string errMsg;
@@ -75,7 +79,7 @@ void strToUInt(const std::string& _str, const size_t& _beg, const size_t& _end,
 ///
 /// \param _uint ipv4 address
 /// \param _pos offset
-uint32 getBitValue(const uint32& _uint, const size_t& _pos) {
+inline uint32 getBitValue(const uint32& _uint, const size_t& _pos) {
 		
 	static const uint32 odd = 1;
 
@@ -86,7 +90,7 @@ uint32 getBitValue(const uint32& _uint, const size_t& _pos) {
 /// 
 /// \param _uint ipv6 address
 /// \param _pos offset
-uint32 getBitValue(const MyUint128& _uint, const size_t& _pos) {
+inline uint32 getBitValue(const MyUint128& _uint, const size_t& _pos) {
 	// not allowe to declare 128-bit unsigned integer constant, thus we must directly compute 
 
 	return _uint.getBitValue(_pos); 
@@ -98,7 +102,7 @@ uint32 getBitValue(const MyUint128& _uint, const size_t& _pos) {
 /// \param _uint inpv4 address
 /// \param _stride number of bits to be retrieved
 /// \param _pos start position
-uint32 getBitsValue(const uint32& _uint, const uint32 _begBit, const uint32 _endBit) {
+inline uint32 getBitsValue(const uint32& _uint, const uint32 _begBit, const uint32 _endBit) {
 
 	uint32 mask = 0;
 
@@ -113,7 +117,7 @@ uint32 getBitsValue(const uint32& _uint, const uint32 _begBit, const uint32 _end
 /// \brief get the value of bits for ipv6
 ///
 /// \note we assume that _endBit - BegBit + 1 < 32, thus the result is less than std::numeric_limits<uint32>::max()
-uint32 getBitsValue(const MyUint128& _uint, const uint32 _begBit, const uint32 _endBit) {
+inline uint32 getBitsValue(const MyUint128& _uint, const uint32 _begBit, const uint32 _endBit) {
 
 	return _uint.getBitsValue(_begBit, _endBit);
 }
@@ -124,7 +128,7 @@ uint32 getBitsValue(const MyUint128& _uint, const uint32 _begBit, const uint32 _
 /// \param _line input sttring line, containing prefix and length
 /// \param _prefix store the prefix retrieved from _line
 /// \param _length sotre the prefix length retrieved from _length
-void retrieveInfo(const std::string& _line, ipv4_type& _prefix, uint8& _length) {
+inline void retrieveInfo(const std::string& _line, ipv4_type& _prefix, uint8& _length) {
 
 	// prefix, in xx.xx.xx.xx format
 	size_t pos1 = _line.find_first_of(" ");
@@ -178,7 +182,7 @@ void retrieveInfo(const std::string& _line, ipv4_type& _prefix, uint8& _length)
 /// \param _line input sttring line, containing prefix and length
 /// \param _prefix store the prefix retrieved from _line
 /// \param _length sotre the prefix length retrieved from _length
-void retrieveInfo(const std::string& _line, ipv4_type& _prefix, uint8& _length, bool& _isAnnounce) {
+inline void retrieveInfo(const std::string& _line, ipv4_type& _prefix, uint8& _length, bool& _isAnnounce) {
 
 	// prefix, in xx.xx.xx.xx format
 	size_t pos1 = _line.find_first_of(" ");
@@ -190,8 +194,8 @@ void retrieveInfo(const std::string& _line, ipv4_type& _prefix, uint8& _length,
 
 	std::string length = _line.substr(pos1 + 1, pos2 - pos1 - 1);
 
-	// isAnnounce
-	size_t pos3 = _line.find_first_of("\n", pos2 + 1);
+	// isAnnounce, possibly followed by a nexthop
+	size_t pos3 = _line.find_first_of(" \n", pos2 + 1);
 
 	std::string isAnnounce = _line.substr(pos2 + 1, pos3 - pos2 - 1);
 
@@ -254,7 +258,7 @@ void retrieveInfo(const std::string& _line, ipv4_type& _prefix, uint8& _length,
 /// \param _line input string line, containing prefix and length
 /// \param _prefix store the prefix retrieved from _line
 /// \param _length sotre the prefix length retrieved from _length
-void retrieveInfo(const std::string& _line, ipv6_type& _prefix, uint8& _length) {
+inline void retrieveInfo(const std::string& _line, ipv6_type& _prefix, uint8& _length) {
 
 	_prefix = 0;
 
@@ -394,7 +398,7 @@ void retrieveInfo(const std::string& _line, ipv6_type& _prefix, uint8& _length)
 /// \param _line input string line, containing prefix and length
 /// \param _prefix store the prefix retrieved from _line
 /// \param _length sotre the prefix length retrieved from _length
-void retrieveInfo(const std::string& _line, ipv6_type& _prefix, uint8& _length, bool& _isAnnounce) {
+inline void retrieveInfo(const std::string& _line, ipv6_type& _prefix, uint8& _length, bool& _isAnnounce) {
 
 	_prefix = 0;
 
@@ -410,8 +414,8 @@ void retrieveInfo(const std::string& _line, ipv6_type& _prefix, uint8& _length,
 
 	std::string length = _line.substr(pos1 + 1, pos2 - pos1 - 1);
 
-	// isAnnounce
-	size_t pos3 = _line.find_first_of("\n", pos2 + 1);
+	// isAnnounce, possibly followed by a nexthop
+	size_t pos3 = _line.find_first_of(" \n", pos2 + 1);
 
 	std::string isAnnounce = _line.substr(pos2 + 1, pos3 - pos2 - 1);
 
@@ -636,6 +640,284 @@ void generateSearchRequest(const std::string& _bgptable, const size_t _searchnum
 }
 
 
+/// \brief generate search requests with locality
+///
+/// The destinations are taken from the prefixes in the BGP table, as in generateSearchRequest.
+/// For a Zipf stream (_pattern = 1), the destinations are ranked in a random order and the i-th one is requested with a probability in proportion to 1 / i^_skew.
+/// For a flow-local stream (_pattern = 2), 1024 flows are active at a time, each request belongs to one of them chosen at random, 
+/// and a flow ends with a probability 1 / _skew after each request, i.e., a flow has _skew requests on average, then a new flow to a random destination starts.
+///
+/// \param _skew exponent of Zipf distribution, or mean length of a flow
+/// \param _seed seed of the random generator, taken from the clock if 0
+template<int W>
+void generateSkewedRequest(const std::string& _bgptable, const size_t _searchnum, const std::string& _reqFile, const int _pattern, const double _skew, unsigned _seed = 0) {
+
+	typedef typename choose_ip_type<W>::ip_type ip_type;
+
+	// step 1: collect destinations
+	std::ifstream fin(_bgptable, std::ios_base::binary);
+
+	std::string line;
+
+	ip_type prefix;
+
+	uint8 length;
+
+	std::vector<ip_type> dests;
+
+	while (getline(fin, line)) {
+
+		utility::retrieveInfo(line, prefix, length);
+
+		dests.push_back(prefix);
+	}
+
+	fin.close();
+
+	assert(!dests.empty());
+
+	if (0 == _seed) _seed = std::chrono::system_clock::now().time_since_epoch().count();
+
+	std::default_random_engine generator(_seed);
+
+	std::shuffle(dests.begin(), dests.end(), generator);
+
+	// step 2: draw requests
+	std::ofstream fout(_reqFile, std::ios_base::binary);
+
+	if (1 == _pattern) { // Zipf
+
+		std::vector<double> weights(dests.size());
+
+		for (size_t i = 0; i < dests.size(); ++i) {
+
+			weights[i] = 1 / std::pow(static_cast<double>(i + 1), _skew);
+		}
+
+		std::discrete_distribution<size_t> distribution(weights.begin(), weights.end());
+
+		for (size_t i = 0; i < _searchnum; ++i) {
+
+			fout << dests[distribution(generator)] << "\n";
+		}
+	}
+	else { // flow-local
+
+		assert(_skew >= 1);
+
+		static const size_t FLOWNUM = 1024; // number of active flows
+
+		std::uniform_int_distribution<size_t> destDistribution(0, dests.size() - 1);
+
+		std::uniform_int_distribution<size_t> flowDistribution(0, FLOWNUM - 1);
+
+		std::bernoulli_distribution endDistribution(1 / _skew);
+
+		std::vector<size_t> flows(FLOWNUM);
+
+		for (auto& flow : flows) {
+
+			flow = destDistribution(generator);
+		}
+
+		for (size_t i = 0; i < _searchnum; ++i) {
+
+			size_t& flow = flows[flowDistribution(generator)];
+
+			fout << dests[flow] << "\n";
+
+			if (endDistribution(generator)) flow = destDistribution(generator);
+		}
+	}
+
+	fout.close();
+
+	return;
+}
+
+/// \brief read a batch of lookup requests, an address per line as written by generateSearchRequest
+///
+/// \param _batch requests read, cleared first
+/// \param _size at most _size requests are read
+/// \return false if no request is left
+template<typename T>
+bool readRequestBatch(std::istream& _fin, std::vector<T>& _batch, const size_t _size = SEARCHBATCH) {
+
+	_batch.clear();
+
+	std::string line;
+
+	T prefix;
+
+	while (_batch.size() < _size && getline(_fin, line)) {
+
+		std::stringstream ss(line);
+
+		ss >> prefix;
+
+		_batch.push_back(prefix);
+	}
+
+	return !_batch.empty();
+}
+
+
+/// \brief interning table of nexthops
+///
+/// The nexthops (or peer IDs) written by the analyzer are arbitrary 32-bit values.
+/// They are mapped to dense small integers in the order of first appearance, starting from BASE,
+/// so that the IDs of a table and its updates agree. The nodes keep 32-bit nexthops, while RMPTree sizes its nodes in memory
+/// with the bytes an ID needs (see getByteNum). In FSTree and RFSTree, a nexthop shares a union with a child pointer, so their entries do not shrink.
+/// The IDs below BASE are left to the prefix lengths standing for the nexthops absent from a file (see retrieveNexthop), 0 included, which stands for no prefix in the indexes.
+///
+/// \note The table is not synchronized. intern() must not run from concurrent build() or update() calls,
+/// thus the driver and the test programs build and update the indexes one after another.
+class NexthopTable{
+
+public:
+
+	static const uint32 BASE = 129; ///< first ID, after the prefix lengths 0 to 128
+
+private:
+
+	std::unordered_map<uint32, uint32> mIds; ///< dense ID of each nexthop
+
+	std::vector<uint32> mNexthops; ///< nexthop of each dense ID minus one
+
+public:
+
+	/// \brief table shared by all the indexes, so that build() and update() agree on the IDs
+	static NexthopTable& global() {
+
+		static NexthopTable table;
+
+		return table;
+	}
+
+	/// \brief dense ID of a nexthop, a new one is allocated on first appearance
+	uint32 intern(const uint32 _nexthop) {
+
+		auto it = mIds.find(_nexthop);
+
+		if (mIds.end() != it) return it->second;
+
+		uint32 id = BASE + static_cast<uint32>(mNexthops.size());
+
+		mNexthops.push_back(_nexthop);
+
+		mIds[_nexthop] = id;
+
+		return id;
+	}
+
+	/// \brief nexthop of a dense ID
+	uint32 getNexthop(const uint32 _id) const {
+
+		return mNexthops[_id - BASE];
+	}
+
+	/// \brief number of distinct nexthops
+	size_t size() const {
+
+		return mNexthops.size();
+	}
+
+	/// \brief number of bits for storing a dense ID, the prefix lengths included
+	int getBitNum() const {
+
+		int bits = 1;
+
+		while ((static_cast<size_t>(1) << bits) < BASE + mNexthops.size()) ++bits;
+
+		return bits;
+	}
+
+	/// \brief number of bytes for storing a dense ID in a node, e.g., 1 for up to 127 distinct nexthops
+	size_t getByteNum() const {
+
+		return (getBitNum() + 7) / 8;
+	}
+
+	/// \brief print the number of distinct nexthops
+	void report() const {
+
+		std::cerr << "distinct nexthop num: " << mNexthops.size() << " bits per nexthop: " << getBitNum() << " bytes per nexthop: " << getByteNum() << std::endl;
+
+		return;
+	}
+};
+
+/// \brief nexthop of a prefix in a table or update line
+///
+/// The line is "prefix length type/announce [nexthop]". The nexthop in the fourth field, if any, is interned by the global NexthopTable.
+/// Otherwise, the nexthop is represented by the prefix length (for test only), as before, which is below the interned IDs,
+/// thus a table and its updates may differ in giving the field.
+inline uint32 retrieveNexthop(const std::string& _line, const uint8 _length) {
+
+	size_t pos = 0;
+
+	for (int i = 0; i < 3; ++i) {
+
+		pos = _line.find_first_of(" ", pos);
+
+		if (std::string::npos == pos) return _length;
+
+		pos = _line.find_first_not_of(" ", pos);
+
+		if (std::string::npos == pos) return _length;
+	}
+
+	if (!isdigit(_line[pos])) return _length;
+
+	return NexthopTable::global().intern(static_cast<uint32>(strtoul(_line.c_str() + pos, nullptr, 10)));
+}
+
+
+/// \brief a route of a table, parsed from a line "prefix length type [nexthop]"
+template<int W>
+struct Route{
+
+	typename choose_ip_type<W>::ip_type prefix; ///< prefix
+
+	uint8 length; ///< prefix length
+
+	uint32 nexthop; ///< interned nexthop, or the length if not given (see retrieveNexthop)
+};
+
+/// \brief parse a table once, so that several indexes can be built from the routes
+///
+/// \param _table routes in the order of the lines, including */0 if any
+template<int W>
+void loadTable(const std::string& _fn, std::vector<Route<W> >& _table) {
+
+	std::ifstream fin(_fn, std::ios_base::binary);
+
+	if (!fin) {
+
+		std::cerr << "cannot open " << _fn << "\n";
+
+		exit(1);
+	}
+
+	_table.clear();
+
+	std::string line;
+
+	Route<W> route;
+
+	while (getline(fin, line)) {
+
+		retrieveInfo(line, route.prefix, route.length);
+
+		route.nexthop = retrieveNexthop(line, route.length);
+
+		_table.push_back(route);
+	}
+
+	return;
+}
+
+
 NAMESPACE_UTILITY_END
 
 #endif
@@ -0,0 +1,44 @@
+#include "driver.h"
+
+int main(int argc, char** argv){
+
+	if (argc < 2) {
+
+		std::cerr << "This program takes at least one parameter:\n";
+
+		std::cerr << "The 1st parameter specifies the config file, - for none. See driver.h for the directives.\n";
+
+		std::cerr << "The remaining parameters (optional) specify more directives, each one starting with its keyword, e.g., engine RBTree<32,10> pipeline ran 16.\n";
+
+		std::cerr << "The engines are:\n";
+
+		Driver().listEngines();
+
+		exit(0);
+	}
+
+	Driver driver;
+
+	if (std::string("-") != argv[1]) driver.load(argv[1]);
+
+	// split the remaining parameters into directives at the keywords
+	std::vector<std::string> args;
+
+	for (int i = 2; i < argc; ++i) {
+
+		if (Driver::isKeyword(argv[i]) && !args.empty()) {
+
+			driver.parse(args);
+
+			args.clear();
+		}
+
+		args.push_back(argv[i]);
+	}
+
+	driver.parse(args);
+
+	driver.run();
+
+	return 0;
+}
@@ -0,0 +1,611 @@
+#ifndef _DRIVER_H
+#define _DRIVER_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file driver.h
+/// \brief Definition of the experiment driver.
+///
+/// Run the engines listed in a config on the pipelines, sweeps and benchmarks requested, building each index only once.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "engine.h"
+#include "../common/parallel.h"
+#include "../common/perfcounter.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <sstream>
+#include <algorithm>
+
+
+/// \brief Driver of the experiments.
+///
+/// A config is a list of directives, one per line in a config file or given on the command line, where '#' starts a comment:
+///
+///     table <file>                          table to be indexed, in the format build() reads (required)
+///     output <prefix>                       prefix of the files written (required)
+///     engine <name>                         engine in the registry, e.g., RBTree<32,10>, repeated for more engines (at least one)
+///     requests <num>                        number of search requests, 1048576 by default
+///     pipeline <lin|ran|cir> [stagenum] [ranpolicy] [banknum]
+///                                           pipeline to be simulated, repeated for more pipelines, lin ran 16 cir 16 by default
+///     sweep <lambda|burst|queue|policy> <v1,v2,...>
+///                                           values of a parameter of the schedulers, the points of the grid are run on all the pipelines
+///     update <file> [lin|ran|cir] [stagenum]
+///                                           updates replayed after the pipelines, in the given one or the last one
+///     bench <repeat>                        time the lookups of all the requests in memory, repeated so many times,
+///                                           untraced and traced by each tracer (see tracer.h), to show the cost of the tracing
+///     accesslog                             log the memory accesses of the lookups for cachesim
+///
+/// Each engine is built once from the table parsed once, then scattered to each pipeline in a mapping of its own (see StageMap),
+/// and the traces of all the pipelines are generated in one pass over the requests, then loaded into memory for all the points of the sweep.
+/// The updates are replayed last, since they change the index, in the mapping of the pipeline if it is scattered already.
+/// The results of the points are written to <prefix>_results.txt, and those of the benchmarks to <prefix>_bench.txt.
+class Driver{
+
+private:
+
+	/// \brief a pipeline to be simulated
+	struct Pipeline{
+
+		int pipestyle; ///< 0, 1 or 2 for linear, random or circular pipeline
+
+		int stagenum; ///< number of pipe stages, ignored for a linear pipeline
+
+		int ranpolicy; ///< placement policy of a random pipeline
+
+		int banknum; ///< number of memory banks per stage
+	};
+
+	std::string mTableFile; ///< table
+
+	std::string mPrefix; ///< prefix of the files written
+
+	std::vector<std::string> mEngines; ///< names of the engines
+
+	size_t mRequestNum; ///< number of search requests
+
+	std::vector<Pipeline> mPipelines; ///< pipelines
+
+	std::vector<double> mLambdas; ///< sweep of the arriving probability
+
+	std::vector<int> mBurstSizes; ///< sweep of the burst size
+
+	std::vector<int> mQueueSizes; ///< sweep of the queue size
+
+	std::vector<int> mQueuePolicies; ///< sweep of the queue policy
+
+	std::string mUpdateFile; ///< updates, empty if none
+
+	int mUpdateStyle; ///< pipeline of the updates, -1 for the last one
+
+	int mUpdateStageNum; ///< number of stages of the pipeline of the updates
+
+	int mBenchRepeat; ///< number of passes of the benchmark, 0 for none
+
+	bool mAccessLog; ///< whether the memory accesses are logged
+
+	EngineRegistry mRegistry; ///< pre-instantiated engines
+
+	/// \brief parse a pipeline style
+	static int parseStyle(const std::string& _style) {
+
+		for (int i = 0; i < 3; ++i) {
+
+			if (_style == PIPESTYLES[i]) return i;
+		}
+
+		std::cerr << "unknown pipeline " << _style << "\n";
+
+		exit(1);
+	}
+
+	/// \brief parse comma-separated values
+	template<typename T>
+	static std::vector<T> parseList(const std::string& _list) {
+
+		std::vector<T> values;
+
+		std::stringstream ss(_list);
+
+		std::string item;
+
+		while (getline(ss, item, ',')) {
+
+			std::stringstream iss(item);
+
+			T value;
+
+			iss >> value;
+
+			values.push_back(value);
+		}
+
+		return values;
+	}
+
+	/// \brief check if the number of stages of a random or circular pipeline is instantiated
+	static void checkStageNum(const int _stagenum) {
+
+		if (std::find(std::begin(STAGENUMS), std::end(STAGENUMS), _stagenum) == std::end(STAGENUMS)) {
+
+			std::cerr << "stage number " << _stagenum << " is not instantiated, use one of";
+
+			for (auto stagenum : STAGENUMS) std::cerr << " " << stagenum;
+
+			std::cerr << "\n";
+
+			exit(1);
+		}
+
+		return;
+	}
+
+	/// \brief name of an engine usable in file names, e.g., RBTree_32_10
+	static std::string getTag(const std::string& _name) {
+
+		std::string tag;
+
+		for (auto c : _name) {
+
+			if ('<' == c || ',' == c) tag += '_';
+			else if ('>' != c && ' ' != c) tag += c;
+		}
+
+		return tag;
+	}
+
+	/// \brief points of the sweep for a pipeline
+	void addPoints(const Pipeline& _pipeline, const int _stagenum, const TraceBuffer* _trace, std::vector<SchedPoint>& _points) const {
+
+		bool isSweep = mLambdas.size() + mBurstSizes.size() + mQueueSizes.size() + mQueuePolicies.size() > 0;
+
+		SchedParam defaults;
+
+		std::vector<double> lambdas(mLambdas.empty() ? std::vector<double>(1, defaults.lambda) : mLambdas);
+
+		std::vector<int> burstsizes(mBurstSizes.empty() ? std::vector<int>(1, defaults.burstsize) : mBurstSizes);
+
+		std::vector<int> queuesizes(mQueueSizes.empty() ? std::vector<int>(1, defaults.queuesize) : mQueueSizes);
+
+		std::vector<int> queuepolicies(mQueuePolicies.empty() ? std::vector<int>(1, defaults.queuepolicy) : mQueuePolicies);
+
+		for (auto lambda : lambdas) {
+
+			for (auto burstsize : burstsizes) {
+
+				for (auto queuesize : queuesizes) {
+
+					for (auto queuepolicy : queuepolicies) {
+
+						SchedPoint point;
+
+						point.pipestyle = _pipeline.pipestyle;
+
+						point.stagenum = _stagenum;
+
+						point.param.lambda = lambda;
+
+						point.param.burstsize = burstsize;
+
+						point.param.queuesize = queuesize;
+
+						point.param.queuepolicy = queuepolicy;
+
+						point.param.banknum = _pipeline.banknum;
+
+						point.param.eventDriven = isSweep;
+
+						point.param.report = !isSweep;
+
+						point.trace = _trace;
+
+						_points.push_back(point);
+					}
+				}
+			}
+		}
+
+		return;
+	}
+
+	/// \brief run an engine
+	void run(Engine* _engine, Workload& _workload, std::ofstream& _results, std::ofstream& _bench) const {
+
+		std::string tag = getTag(_engine->getName());
+
+		std::cerr << "==========Engine " << _engine->getName() << ".\n";
+
+		// step 1: build the index
+		std::cerr << "-----Create the index.\n";
+
+		_engine->build(_workload);
+
+		if (mAccessLog) _engine->generateAccessLog(_workload, mPrefix + "_" + tag + "_acc.log");
+
+		// step 2: benchmark the lookups
+		if (mBenchRepeat > 0) {
+
+			std::cerr << "-----Benchmark the lookups.\n";
+
+			double lookupnum = static_cast<double>(mRequestNum);
+
+			double nullBest = 0; // best time of the plain search, to which the tracers are compared
+
+			// the plain search first, then the lookups traced, see tracer.h
+			for (int tracer = 0; tracer < 3; ++tracer) {
+
+				uint64 checksum = 0;
+
+				double best = 0, total = 0;
+
+				for (int i = 0; i < mBenchRepeat; ++i) {
+
+					double elapsed = _engine->benchmark(_workload, tracer, checksum);
+
+					best = (0 == i ? elapsed : std::min(best, elapsed));
+
+					total += elapsed;
+				}
+
+				if (0 == tracer) nullBest = best;
+
+				std::cerr << TRACERS[tracer] << " tracer lookup num: " << mRequestNum << " best Mlps: " << lookupnum / best / 1e6 << " mean Mlps: " << lookupnum * mBenchRepeat / total / 1e6
+					<< " slowdown: " << best / nullBest << " checksum: " << checksum << std::endl;
+
+				_bench << _engine->getName() << " " << TRACERS[tracer] << " " << mRequestNum << " " << mBenchRepeat << " " << lookupnum / best / 1e6 << " " << lookupnum * mBenchRepeat / total / 1e6
+					<< " " << best / nullBest << "\n";
+			}
+		}
+
+		// step 3: scatter to each pipeline in a mapping of its own, and generate all the traces in one pass, loaded into memory once for all the points
+		std::deque<StageMap> maps;
+
+		std::vector<const Pipeline*> scattered; // pipelines scattered, in the order of the mappings
+
+		std::vector<int> stagenums; // numbers of stages of the pipelines scattered
+
+		std::vector<TraceOutput> outputs;
+
+		for (auto& pipeline : mPipelines) {
+
+			if (!_engine->isSupported(pipeline.pipestyle)) {
+
+				std::cerr << "-----" << PIPESTYLES[pipeline.pipestyle] << " pipeline is not supported by " << _engine->getName() << ", skipped.\n";
+
+				continue;
+			}
+
+			int stagenum = 0 == pipeline.pipestyle ? _engine->getStepNum() : pipeline.stagenum;
+
+			std::cerr << "-----Scatter to " << PIPESTYLES[pipeline.pipestyle] << " pipeline with " << stagenum << " stages.\n";
+
+			maps.push_back(StageMap());
+
+			_engine->scatterToPipeline(maps.back(), pipeline.pipestyle, stagenum, pipeline.ranpolicy, pipeline.banknum);
+
+			scattered.push_back(&pipeline);
+
+			stagenums.push_back(stagenum);
+
+			std::string traceFile = mPrefix + "_" + tag + "_" + PIPESTYLES[pipeline.pipestyle] + "_" + std::to_string(stagenum) + ".dat";
+
+			outputs.push_back(TraceOutput(&maps.back(), traceFile, stagenum));
+		}
+
+		std::deque<TraceBuffer> traces;
+
+		std::vector<SchedPoint> points;
+
+		if (!outputs.empty()) {
+
+			std::cerr << "-----Generate the traces of " << outputs.size() << " pipelines.\n";
+
+			_engine->generateTrace(_workload, outputs);
+		}
+
+		for (size_t i = 0; i < outputs.size(); ++i) {
+
+			traces.push_back(TraceBuffer());
+
+			traces.back().load(outputs[i].traceFile);
+
+			addPoints(*scattered[i], stagenums[i], &traces.back(), points);
+		}
+
+		// step 4: schedule
+		if (!points.empty()) {
+
+			std::cerr << "-----Schedule " << points.size() << " points on " << (points[0].param.report ? 1 : utility::getWorkerNum(points.size())) << " threads.\n";
+
+			if (points[0].param.report) { // a single point per pipeline, with the reports in order
+
+				for (auto& point : points) _engine->searchRun(point);
+			}
+			else {
+
+				utility::parallelFor(points.size(), [&points, _engine](const size_t i) {
+
+					_engine->searchRun(points[i]);
+				});
+			}
+		}
+
+		for (auto& point : points) {
+
+			_results << _engine->getName() << " " << PIPESTYLES[point.pipestyle] << " " << point.stagenum << " " << point.param.lambda << " " << point.param.burstsize << " "
+				<< point.param.queuesize << " " << point.param.queuepolicy << " " << point.slotnum << " " << point.usage << " " << point.avgQueueLength << " "
+				<< point.maxQueueLength << " " << point.lossRate << " " << point.blockingProb << " " << point.p99Latency << " " << point.p999Latency << "\n";
+		}
+
+		// step 5: update, which changes the index
+		if (!mUpdateFile.empty()) {
+
+			const Pipeline* last = scattered.empty() ? nullptr : scattered.back(); // last pipeline scattered
+
+			int pipestyle = -1 == mUpdateStyle ? (nullptr == last ? 0 : last->pipestyle) : mUpdateStyle;
+
+			int stagenum = 0 == pipestyle ? _engine->getStepNum() : (-1 == mUpdateStyle ? (nullptr == last ? 0 : last->stagenum) : mUpdateStageNum);
+
+			if (!_engine->isSupported(pipestyle)) {
+
+				std::cerr << "-----Updates in " << PIPESTYLES[pipestyle] << " pipeline are not supported by " << _engine->getName() << ", skipped.\n";
+			}
+			else {
+
+				// the mapping of a pipeline scattered above, or a new one
+				StageMap* map = nullptr;
+
+				for (size_t i = 0; i < scattered.size(); ++i) {
+
+					if (scattered[i]->pipestyle == pipestyle && stagenums[i] == stagenum) map = &maps[i];
+				}
+
+				if (nullptr == map) {
+
+					maps.push_back(StageMap());
+
+					map = &maps.back();
+
+					_engine->scatterToPipeline(*map, pipestyle, stagenum, 0, 1);
+				}
+
+				std::cerr << "-----Update in " << PIPESTYLES[pipestyle] << " pipeline.\n";
+
+				if (!_engine->update(_workload, *map, pipestyle, stagenum)) std::cerr << "updates are not supported by " << _engine->getName() << ", skipped.\n";
+			}
+		}
+
+		return;
+	}
+
+public:
+
+	/// \brief ctor
+	Driver() : mRequestNum(1024 * 1024), mUpdateStyle(-1), mUpdateStageNum(16), mBenchRepeat(0), mAccessLog(false) {
+
+		registerRBTreeEngines(mRegistry);
+
+		registerRPTreeEngines(mRegistry);
+
+		registerRFSTreeEngines(mRegistry);
+
+		registerRMPTreeEngines(mRegistry);
+	}
+
+	/// \brief print the names of the engines
+	void listEngines() const {
+
+		mRegistry.list();
+
+		return;
+	}
+
+	/// \brief parse a directive
+	///
+	/// \param _args keyword and arguments
+	void parse(const std::vector<std::string>& _args) {
+
+		if (_args.empty()) return;
+
+		const std::string& key = _args[0];
+
+		auto arg = [&_args, &key](const size_t _idx) -> const std::string& {
+
+			if (_idx >= _args.size()) {
+
+				std::cerr << "missing argument of " << key << "\n";
+
+				exit(1);
+			}
+
+			return _args[_idx];
+		};
+
+		if ("table" == key) {
+
+			mTableFile = arg(1);
+		}
+		else if ("output" == key) {
+
+			mPrefix = arg(1);
+		}
+		else if ("engine" == key) {
+
+			mEngines.push_back(arg(1));
+		}
+		else if ("requests" == key) {
+
+			mRequestNum = static_cast<size_t>(atoll(arg(1).c_str()));
+		}
+		else if ("pipeline" == key) {
+
+			Pipeline pipeline;
+
+			pipeline.pipestyle = parseStyle(arg(1));
+
+			pipeline.stagenum = _args.size() > 2 ? atoi(_args[2].c_str()) : 16;
+
+			pipeline.ranpolicy = _args.size() > 3 ? atoi(_args[3].c_str()) : 0;
+
+			pipeline.banknum = _args.size() > 4 ? atoi(_args[4].c_str()) : 1;
+
+			if (0 != pipeline.pipestyle) checkStageNum(pipeline.stagenum);
+
+			mPipelines.push_back(pipeline);
+		}
+		else if ("sweep" == key) {
+
+			const std::string& param = arg(1);
+
+			if ("lambda" == param) mLambdas = parseList<double>(arg(2));
+			else if ("burst" == param) mBurstSizes = parseList<int>(arg(2));
+			else if ("queue" == param) mQueueSizes = parseList<int>(arg(2));
+			else if ("policy" == param) mQueuePolicies = parseList<int>(arg(2));
+			else {
+
+				std::cerr << "unknown parameter of sweep " << param << "\n";
+
+				exit(1);
+			}
+		}
+		else if ("update" == key) {
+
+			mUpdateFile = arg(1);
+
+			mUpdateStyle = _args.size() > 2 ? parseStyle(_args[2]) : -1;
+
+			mUpdateStageNum = _args.size() > 3 ? atoi(_args[3].c_str()) : 16;
+
+			if (mUpdateStyle > 0) checkStageNum(mUpdateStageNum);
+		}
+		else if ("bench" == key) {
+
+			mBenchRepeat = atoi(arg(1).c_str());
+		}
+		else if ("accesslog" == key) {
+
+			mAccessLog = true;
+		}
+		else {
+
+			std::cerr << "unknown directive " << key << "\n";
+
+			exit(1);
+		}
+
+		return;
+	}
+
+	/// \brief parse a config file, a directive per line
+	void load(const std::string& _fn) {
+
+		std::ifstream fin(_fn, std::ios_base::binary);
+
+		if (!fin) {
+
+			std::cerr << "cannot open " << _fn << "\n";
+
+			exit(1);
+		}
+
+		std::string line;
+
+		while (getline(fin, line)) {
+
+			line = line.substr(0, line.find('#'));
+
+			std::stringstream ss(line);
+
+			std::vector<std::string> args;
+
+			std::string word;
+
+			while (ss >> word) args.push_back(word);
+
+			parse(args);
+		}
+
+		return;
+	}
+
+	/// \brief check if a word starts a directive
+	static bool isKeyword(const std::string& _word) {
+
+		static const char* const KEYWORDS[] = {"table", "output", "engine", "requests", "pipeline", "sweep", "update", "bench", "accesslog"};
+
+		return std::find(std::begin(KEYWORDS), std::end(KEYWORDS), _word) != std::end(KEYWORDS);
+	}
+
+	/// \brief run all the engines
+	void run() {
+
+		if (mTableFile.empty() || mPrefix.empty() || mEngines.empty()) {
+
+			std::cerr << "table, output and at least one engine are required\n";
+
+			exit(1);
+		}
+
+		if (mPipelines.empty()) { // as the test programs
+
+			parse({"pipeline", "lin"});
+
+			parse({"pipeline", "ran", "16"});
+
+			parse({"pipeline", "cir", "16"});
+		}
+
+		// check the names first, so that a wrong name fails before any work
+		for (auto& name : mEngines) {
+
+			if (!mRegistry.contains(name)) {
+
+				std::cerr << "unknown engine " << name << ", the engines are:\n";
+
+				mRegistry.list();
+
+				exit(1);
+			}
+		}
+
+		Workload workload(mTableFile, mUpdateFile, mPrefix, mRequestNum);
+
+		std::ofstream results(mPrefix + "_results.txt", std::ios_base::binary);
+
+		results << "engine pipeline stages lambda burst queue policy slots usage avg_queue max_queue loss_rate blocking p99_latency p999_latency\n";
+
+		std::ofstream bench;
+
+		if (mBenchRepeat > 0) {
+
+			bench.open(mPrefix + "_bench.txt", std::ios_base::binary);
+
+			bench << "engine tracer lookups repeat best_mlps mean_mlps slowdown\n";
+		}
+
+		for (auto& name : mEngines) {
+
+			Engine* engine = mRegistry.create(name);
+
+			run(engine, workload, results, bench);
+
+			delete engine; // free the index before building the next one
+		}
+
+		std::cerr << "-----Results are written to " << mPrefix << "_results.txt\n";
+
+		utility::NexthopTable::global().report();
+
+		utility::PerfCounter::reportAll();
+
+		return;
+	}
+};
+
+#endif // _DRIVER_H
@@ -0,0 +1,506 @@
+#ifndef _ENGINE_H
+#define _ENGINE_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file engine.h
+/// \brief Common interface of the lookup engines run by the experiment driver.
+///
+/// An engine wraps an instance of a tree template behind virtual functions, so that the driver runs any of them the same way.
+/// The instances are pre-instantiated in a translation unit per tree (e.g., rbtengine.cpp), so that the trees compile in parallel,
+/// and are listed in a registry by name.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+#include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/accesslog.h"
+#include "../scheduler/linsched.h"
+#include "../scheduler/ransched.h"
+#include "../scheduler/cirsched.h"
+#include "../tree/stagemap.h"
+#include "../tree/tracer.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
+
+
+static const int STAGENUMS[] = {8, 16, 24, 32}; // numbers of stages of random and circular pipelines instantiated by the engines
+
+/// \brief names of the pipeline styles, indexed by the pipestyle of scatterToPipeline()
+static const char* const PIPESTYLES[] = {"lin", "ran", "cir"};
+
+/// \brief names of the tracers timed by the benchmark, indexed by the _tracer of benchmark(), see tracer.h
+static const char* const TRACERS[] = {"null", "buffer", "stage"};
+
+
+/// \brief Inputs shared by all the engines of a run.
+///
+/// Each input is parsed or generated on the first use and kept for the other engines,
+/// i.e., the table is parsed once per address family, and the requests are generated and loaded once per address family.
+class Workload{
+
+private:
+
+	/// \brief inputs of an address family
+	template<int W>
+	struct Family{
+
+		std::vector<utility::Route<W> > table; ///< parsed table
+
+		std::string reqFile; ///< file of the requests, empty if not generated yet
+
+		std::vector<typename choose_ip_type<W>::ip_type> requests; ///< requests loaded into memory
+
+		bool parsed; ///< whether the table is parsed
+
+		Family() : parsed(false) {}
+	};
+
+	std::string mTableFile; ///< file of the table
+
+	std::string mUpdateFile; ///< file of the updates, empty if none
+
+	std::string mPrefix; ///< prefix of the files written
+
+	size_t mRequestNum; ///< number of requests generated
+
+	Family<32> mIPv4; ///< IPv4 inputs
+
+	Family<128> mIPv6; ///< IPv6 inputs
+
+	/// \brief inputs of an address family
+	template<int W>
+	Family<W>& getFamily();
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _tableFile file of the table
+	/// \param _updateFile file of the updates, empty if none
+	/// \param _prefix prefix of the files written, e.g., the requests
+	/// \param _requestNum number of requests generated
+	Workload(const std::string& _tableFile, const std::string& _updateFile, const std::string& _prefix, const size_t _requestNum) :
+		mTableFile(_tableFile), mUpdateFile(_updateFile), mPrefix(_prefix), mRequestNum(_requestNum) {}
+
+	/// \brief parsed table
+	template<int W>
+	const std::vector<utility::Route<W> >& getTable() {
+
+		Family<W>& family = getFamily<W>();
+
+		if (!family.parsed) {
+
+			std::cerr << "-----Parse the table for " << (32 == W ? "IPv4" : "IPv6") << ".\n";
+
+			utility::loadTable<W>(mTableFile, family.table);
+
+			family.parsed = true;
+		}
+
+		return family.table;
+	}
+
+	/// \brief file of the requests, see generateSearchRequest
+	template<int W>
+	const std::string& getReqFile() {
+
+		Family<W>& family = getFamily<W>();
+
+		if (family.reqFile.empty()) {
+
+			std::cerr << "-----Generate search requests for " << (32 == W ? "IPv4" : "IPv6") << ".\n";
+
+			family.reqFile = mPrefix + (32 == W ? "_req_v4.dat" : "_req_v6.dat");
+
+			utility::generateSearchRequest<W>(mTableFile, mRequestNum, family.reqFile);
+		}
+
+		return family.reqFile;
+	}
+
+	/// \brief requests loaded into memory
+	template<int W>
+	const std::vector<typename choose_ip_type<W>::ip_type>& getRequests() {
+
+		Family<W>& family = getFamily<W>();
+
+		if (family.requests.empty()) {
+
+			std::ifstream fin(getReqFile<W>(), std::ios_base::binary);
+
+			std::vector<typename choose_ip_type<W>::ip_type> batch;
+
+			while (utility::readRequestBatch(fin, batch)) family.requests.insert(family.requests.end(), batch.begin(), batch.end());
+		}
+
+		return family.requests;
+	}
+
+	/// \brief file of the updates, empty if none
+	const std::string& getUpdateFile() const {
+
+		return mUpdateFile;
+	}
+};
+
+template<>
+inline Workload::Family<32>& Workload::getFamily<32>() {
+
+	return mIPv4;
+}
+
+template<>
+inline Workload::Family<128>& Workload::getFamily<128>() {
+
+	return mIPv6;
+}
+
+
+/// \brief a scheduling run of a trace and its results
+struct SchedPoint{
+
+	int pipestyle; ///< 0, 1 or 2 for linear, random or circular pipeline
+
+	int stagenum; ///< number of pipe stages
+
+	SchedParam param; ///< parameters of the run
+
+	const TraceBuffer* trace; ///< traces shared by all the points of a pipeline
+
+	size_t slotnum; ///< number of time slots in total
+
+	double usage; ///< usage ratio
+
+	double avgQueueLength; ///< average queue length
+
+	size_t maxQueueLength; ///< maximum queue length
+
+	double lossRate; ///< dropped over offered
+
+	double blockingProb; ///< probability that an arrival finds a full queue
+
+	uint64 p99Latency; ///< 99th percentile of latency
+
+	uint64 p999Latency; ///< 99.9th percentile of latency
+
+	SchedPoint() : pipestyle(0), stagenum(0), trace(nullptr), slotnum(0), usage(0), avgQueueLength(0), maxQueueLength(0), lossRate(0), blockingProb(0), p99Latency(0), p999Latency(0) {}
+};
+
+
+/// \brief Interface of a lookup engine.
+class Engine{
+
+public:
+
+	/// \brief dtor
+	virtual ~Engine() {}
+
+	/// \brief name in the registry, e.g., "RBTree<32,10>"
+	virtual const std::string& getName() const = 0;
+
+	/// \brief 32 or 128 for IPv4 or IPv6
+	virtual int getWidth() const = 0;
+
+	/// \brief number of stages of a linear pipeline, i.e., at most so many search steps
+	virtual int getStepNum() const = 0;
+
+	/// \brief check if a pipeline style is supported, 0, 1 or 2 for linear, random or circular pipeline
+	virtual bool isSupported(const int _pipestyle) const = 0;
+
+	/// \brief build the index from the parsed table
+	virtual void build(Workload& _workload) = 0;
+
+	/// \brief log the memory accesses of the lookups, see generateAccessLog
+	virtual void generateAccessLog(Workload& _workload, const std::string& _logFile) = 0;
+
+	/// \brief scatter the nodes to a pipeline, kept in a mapping apart from those of the other pipelines
+	virtual void scatterToPipeline(StageMap& _map, const int _pipestyle, const int _stagenum, const int _ranpolicy, const int _banknum) = 0;
+
+	/// \brief write the traces of the requests in several pipelines, searching each request once
+	virtual void generateTrace(Workload& _workload, const std::vector<TraceOutput>& _outputs) = 0;
+
+	/// \brief run the scheduler of a point and fill in its results
+	virtual void searchRun(SchedPoint& _point) const = 0;
+
+	/// \brief replay the updates in a pipeline, the new nodes are placed in its mapping
+	///
+	/// \return false if the updates are not supported
+	virtual bool update(Workload& _workload, StageMap& _map, const int _pipestyle, const int _stagenum) = 0;
+
+	/// \brief look up all the requests in memory once
+	///
+	/// \param _tracer 0, 1 or 2 for the lookups traced by NullTracer (i.e., the plain search), BufferTracer or StageTracer
+	/// \param _checksum sum of the nexthops and the steps traced, so that the lookups are not optimized away
+	/// \return elapsed seconds
+	virtual double benchmark(Workload& _workload, const int _tracer, uint64& _checksum) = 0;
+};
+
+
+/// \brief Engine wrapping a tree, for the tree templates sharing the interface of RBTree.
+///
+/// \param T type of the tree
+/// \param W 32 or 128 for IPv4 or IPv6
+/// \param SL at most SL search steps for a request, i.e., the number of stages of a linear pipeline
+template<typename T, int W, int SL>
+class TreeEngine : public Engine{
+
+protected:
+
+	std::string mName; ///< name in the registry
+
+	T* mTree; ///< index
+
+	/// \brief run a scheduler and collect its results
+	template<typename S>
+	static void runSched(SchedPoint& _point) {
+
+		S* sched = new S();
+
+		sched->searchRun(*_point.trace, _point.param);
+
+		_point.slotnum = sched->getSlotNum();
+
+		_point.usage = sched->getUsageRatio();
+
+		_point.avgQueueLength = sched->getAvgQueueLength();
+
+		_point.maxQueueLength = sched->getMaxQueueLength();
+
+		_point.lossRate = sched->getSource().getLossRate();
+
+		_point.blockingProb = sched->getSource().getBlockingProb();
+
+		_point.p99Latency = sched->getLatencyStat().getLatency().getPercentile(0.99);
+
+		_point.p999Latency = sched->getLatencyStat().getLatency().getPercentile(0.999);
+
+		delete sched;
+
+		return;
+	}
+
+	/// \brief run a point in a random or circular pipeline with K stages
+	template<int K>
+	static void runSched(SchedPoint& _point) {
+
+		if (2 == _point.pipestyle) runSched<CirSched<SL, K> >(_point);
+		else runSched<RanSched<SL, K> >(_point);
+
+		return;
+	}
+
+public:
+
+	/// \brief ctor
+	TreeEngine(const std::string& _name) : mName(_name), mTree(new T()) {}
+
+	/// \brief dtor
+	~TreeEngine() {
+
+		delete mTree;
+	}
+
+	const std::string& getName() const {
+
+		return mName;
+	}
+
+	int getWidth() const {
+
+		return W;
+	}
+
+	int getStepNum() const {
+
+		return SL;
+	}
+
+	void build(Workload& _workload) {
+
+		mTree->build(_workload.getTable<W>());
+
+		return;
+	}
+
+	void generateAccessLog(Workload& _workload, const std::string& _logFile) {
+
+		utility::generateAccessLog<W>(*mTree, _workload.getReqFile<W>(), _logFile);
+
+		return;
+	}
+
+	void scatterToPipeline(StageMap& _map, const int _pipestyle, const int _stagenum, const int _ranpolicy, const int _banknum) {
+
+		mTree->scatterToPipeline(_map, _pipestyle, _stagenum, _ranpolicy, _banknum);
+
+		return;
+	}
+
+	void generateTrace(Workload& _workload, const std::vector<TraceOutput>& _outputs) {
+
+		mTree->generateTrace(_workload.getReqFile<W>(), _outputs);
+
+		return;
+	}
+
+	void searchRun(SchedPoint& _point) const {
+
+		if (0 == _point.pipestyle) {
+
+			runSched<LinSched<SL> >(_point);
+
+			return;
+		}
+
+		switch (_point.stagenum) {
+
+		case 8: runSched<8>(_point); break;
+
+		case 16: runSched<16>(_point); break;
+
+		case 24: runSched<24>(_point); break;
+
+		case 32: runSched<32>(_point); break;
+
+		default: std::cerr << "stage number " << _point.stagenum << " is not instantiated.\n"; exit(1);
+		}
+
+		return;
+	}
+
+	double benchmark(Workload& _workload, const int _tracer, uint64& _checksum) {
+
+		const auto& requests = _workload.getRequests<W>();
+
+		std::vector<int> trace; // kept over the lookups, as in generateTrace
+
+		BufferTracer<W + 1> buffer; // no more steps than the bits of an address
+
+		auto start = std::chrono::steady_clock::now();
+
+		switch (_tracer) {
+
+		case 0: {
+
+			NullTracer tracer;
+
+			utility::PerfCounter& counter = utility::PerfCounter::get(mName + "::search"); // e.g., "RBTree<32,10>::search"
+
+			counter.start();
+
+			for (auto& ip : requests) _checksum += mTree->search(ip, tracer);
+
+			counter.stop(requests.size());
+
+			break;
+		}
+
+		case 1:
+
+			for (auto& ip : requests) {
+
+				buffer.clear();
+
+				_checksum += mTree->search(ip, buffer) + buffer.size();
+			}
+
+			break;
+
+		case 2:
+
+			for (auto& ip : requests) {
+
+				trace.clear();
+
+				StageTracer tracer(trace);
+
+				_checksum += mTree->search(ip, tracer) + trace.size();
+			}
+
+			break;
+		}
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+};
+
+
+/// \brief Registry of the pre-instantiated engines, by name.
+class EngineRegistry{
+
+private:
+
+	typedef Engine* (*Factory)(const std::string& _name);
+
+	std::vector<std::pair<std::string, Factory> > mFactories; ///< factories in the order of registration
+
+	/// \brief create an engine of type E
+	template<typename E>
+	static Engine* create(const std::string& _name) {
+
+		return new E(_name);
+	}
+
+public:
+
+	/// \brief register an engine of type E
+	template<typename E>
+	void add(const std::string& _name) {
+
+		mFactories.push_back(std::make_pair(_name, &create<E>));
+
+		return;
+	}
+
+	/// \brief check if a name is registered
+	bool contains(const std::string& _name) const {
+
+		for (auto& factory : mFactories) {
+
+			if (factory.first == _name) return true;
+		}
+
+		return false;
+	}
+
+	/// \brief create an engine by name
+	///
+	/// \return nullptr if the name is not registered
+	Engine* create(const std::string& _name) const {
+
+		for (auto& factory : mFactories) {
+
+			if (factory.first == _name) return factory.second(_name);
+		}
+
+		return nullptr;
+	}
+
+	/// \brief print the names of the engines
+	void list() const {
+
+		for (auto& factory : mFactories) std::cerr << "\t" << factory.first << "\n";
+
+		return;
+	}
+};
+
+
+// registration of the engines, one function per translation unit
+void registerRBTreeEngines(EngineRegistry& _registry);
+
+void registerRPTreeEngines(EngineRegistry& _registry);
+
+void registerRFSTreeEngines(EngineRegistry& _registry);
+
+void registerRMPTreeEngines(EngineRegistry& _registry);
+
+#endif // _ENGINE_H
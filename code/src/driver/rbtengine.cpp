@@ -0,0 +1,36 @@
+#include "engine.h"
+#include "../tree/rbtree.h"
+
+
+/// \brief engine of RBTree<W, U>
+template<int W, int U>
+class RBTreeEngine : public TreeEngine<RBTree<W, U>, W, W - U + 1>{
+
+public:
+
+	/// \brief ctor
+	RBTreeEngine(const std::string& _name) : TreeEngine<RBTree<W, U>, W, W - U + 1>(_name) {}
+
+	bool isSupported(const int) const {
+
+		return true;
+	}
+
+	bool update(Workload& _workload, StageMap& _map, const int _pipestyle, const int _stagenum) {
+
+		this->mTree->update(_workload.getUpdateFile(), _pipestyle, _stagenum, nullptr, &_map);
+
+		return true;
+	}
+};
+
+void registerRBTreeEngines(EngineRegistry& _registry) {
+
+	_registry.add<RBTreeEngine<32, 10> >("RBTree<32,10>");
+
+	_registry.add<RBTreeEngine<32, 16> >("RBTree<32,16>");
+
+	_registry.add<RBTreeEngine<128, 10> >("RBTree<128,10>");
+
+	return;
+}
@@ -0,0 +1,38 @@
+#include "engine.h"
+#include "../tree/rfstree.h"
+
+
+/// \brief engine of RFSTree<W, K, M, U>, a lookup takes at most K steps
+///
+/// Only EVEN (M = 2) is mapped to random and circular pipelines, and the updates are not supported.
+template<int W, int K, int M, int U>
+class RFSTreeEngine : public TreeEngine<RFSTree<W, K, M, U>, W, K>{
+
+public:
+
+	/// \brief ctor
+	RFSTreeEngine(const std::string& _name) : TreeEngine<RFSTree<W, K, M, U>, W, K>(_name) {}
+
+	bool isSupported(const int _pipestyle) const {
+
+		return 0 == _pipestyle || 2 == M;
+	}
+
+	bool update(Workload&, StageMap&, const int, const int) {
+
+		return false;
+	}
+};
+
+void registerRFSTreeEngines(EngineRegistry& _registry) {
+
+	_registry.add<RFSTreeEngine<32, 8, 0, 10> >("RFSTree<32,8,0,10>");
+
+	_registry.add<RFSTreeEngine<32, 8, 1, 10> >("RFSTree<32,8,1,10>");
+
+	_registry.add<RFSTreeEngine<32, 8, 2, 10> >("RFSTree<32,8,2,10>");
+
+	_registry.add<RFSTreeEngine<128, 16, 2, 10> >("RFSTree<128,16,2,10>");
+
+	return;
+}
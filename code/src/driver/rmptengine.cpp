@@ -0,0 +1,36 @@
+#include "engine.h"
+#include "../tree/rmptree.h"
+
+
+/// \brief engine of RMPTree<W, K, U>
+///
+/// Only random pipelines are supported, see RMPTree::scatterToPipeline.
+template<int W, int K, int U>
+class RMPTreeEngine : public TreeEngine<RMPTree<W, K, U>, W, W - U + 1>{
+
+public:
+
+	/// \brief ctor
+	RMPTreeEngine(const std::string& _name) : TreeEngine<RMPTree<W, K, U>, W, W - U + 1>(_name) {}
+
+	bool isSupported(const int _pipestyle) const {
+
+		return 1 == _pipestyle;
+	}
+
+	bool update(Workload& _workload, StageMap& _map, const int, const int _stagenum) {
+
+		this->mTree->update(_workload.getUpdateFile(), _stagenum, &_map);
+
+		return true;
+	}
+};
+
+void registerRMPTreeEngines(EngineRegistry& _registry) {
+
+	_registry.add<RMPTreeEngine<32, 2, 10> >("RMPTree<32,2,10>");
+
+	_registry.add<RMPTreeEngine<32, 4, 10> >("RMPTree<32,4,10>");
+
+	return;
+}
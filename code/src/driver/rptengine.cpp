@@ -0,0 +1,34 @@
+#include "engine.h"
+#include "../tree/rptree.h"
+
+
+/// \brief engine of RPTree<W, U>
+template<int W, int U>
+class RPTreeEngine : public TreeEngine<RPTree<W, U>, W, W - U + 1>{
+
+public:
+
+	/// \brief ctor
+	RPTreeEngine(const std::string& _name) : TreeEngine<RPTree<W, U>, W, W - U + 1>(_name) {}
+
+	bool isSupported(const int) const {
+
+		return true;
+	}
+
+	bool update(Workload& _workload, StageMap& _map, const int _pipestyle, const int _stagenum) {
+
+		this->mTree->update(_workload.getUpdateFile(), _pipestyle, _stagenum, &_map);
+
+		return true;
+	}
+};
+
+void registerRPTreeEngines(EngineRegistry& _registry) {
+
+	_registry.add<RPTreeEngine<32, 10> >("RPTree<32,10>");
+
+	_registry.add<RPTreeEngine<128, 10> >("RPTree<128,10>");
+
+	return;
+}
@@ -0,0 +1,29 @@
+#include "ingester.h"
+
+int main(int argc, char** argv){
+
+	if (argc < 4) {
+
+		std::cerr << "This program takes at least three parameters:\n";
+
+		std::cerr << "The 1st parameter specifies the output file of the merged updates.\n";
+
+		std::cerr << "The 2nd parameter specifies the address family, 0 for IPv4, 1 for IPv6 and 2 for both in separate files.\n";
+
+		std::cerr << "The remaining parameters specify the MRT update files, ties of timestamps are broken by their order.\n";
+
+		exit(0);
+	}
+
+	std::vector<std::string> files(argv + 3, argv + argc);
+
+	Ingester ingester(files);
+
+	ingester.parse();
+
+	ingester.write(argv[1], atoi(argv[2]));
+
+	ingester.report();
+
+	return 0;
+}
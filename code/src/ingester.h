@@ -0,0 +1,285 @@
+#ifndef _INGESTER_H
+#define _INGESTER_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file ingester.h
+/// \brief Definition of the ingester of multiple MRT update files.
+///
+/// Parse many MRT files in parallel and merge their updates into a single stream ordered by time.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "analyzer.h"
+#include "mrtreader.h"
+#include "common/common.h"
+#include "common/parallel.h"
+
+#include <vector>
+#include <queue>
+#include <tuple>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+
+
+/// \brief an update of a prefix, as kept in memory until the merge
+struct UpdateRecord{
+
+	uint32 time; ///< timestamp of the MRT entry, in seconds
+
+	uint8 afi; ///< AFI_IP or AFI_IP6
+
+	uint8 length; ///< prefix length
+
+	bool announce; ///< true for announce and false for withdraw
+
+	uint8 addr[16]; ///< prefix, in network order, only the first 4 bytes for IPv4
+};
+
+/// \brief Ingest the updates in multiple MRT files.
+///
+/// Each file is decompressed (by libbgpdump) and parsed by a worker thread on its own, into a list of compact records.
+/// The lists are then merged by timestamp. Updates with the same timestamp keep the order of the files as given, and then their order in the file,
+/// e.g., the files of a collector in chronological order followed by those of the next collector.
+/// All the records are held in memory until the merge, about 24 bytes per prefix.
+class Ingester{
+
+private:
+
+	std::vector<std::string> mFiles; ///< MRT files
+
+	std::vector<std::vector<UpdateRecord> > mRecords; ///< records of each file, sorted by time
+
+	double mParseElapsed; ///< wall-clock time for parsing, in seconds
+
+	double mMergeElapsed; ///< wall-clock time for merging, in seconds
+
+	/// \brief parse the updates in a file
+	void parse(const size_t _i) {
+
+		std::vector<UpdateRecord>& records = mRecords[_i];
+
+		if (!MrtReader::isCompressed(mFiles[_i])) {
+
+			parseMapped(_i);
+
+			return;
+		}
+
+		BGPDUMP* dump = bgpdump_open_dump(mFiles[_i].c_str());
+
+		if (nullptr == dump) {
+
+			std::cerr << "cannot open " << mFiles[_i] << "\n";
+
+			return;
+		}
+
+		BGPDUMP_ENTRY* entry = nullptr;
+
+		do {
+
+			entry = bgpdump_read_next(dump);
+
+			if (nullptr != entry) {
+
+				uint32 time = static_cast<uint32>(entry->time);
+
+				Analyzer::forEachUpdate(entry, [&records, time](const int _afi, const BGPDUMP_IP_ADDRESS* _addr, const int _length, const bool _announce) {
+
+					UpdateRecord record;
+
+					record.time = time;
+
+					record.afi = static_cast<uint8>(_afi);
+
+					record.length = static_cast<uint8>(_length);
+
+					record.announce = _announce;
+
+					memcpy(record.addr, _addr, AFI_IP == _afi ? 4 : 16);
+
+					records.push_back(record);
+				});
+
+				bgpdump_free_mem(entry);
+			}
+		} while (0 == dump->eof);
+
+		bgpdump_close_dump(dump);
+
+		sortRecords(records);
+
+		return;
+	}
+
+	/// \brief parse the updates in an uncompressed file through a memory mapping
+	void parseMapped(const size_t _i) {
+
+		std::vector<UpdateRecord>& records = mRecords[_i];
+
+		MrtReader reader;
+
+		if (!reader.open(mFiles[_i])) {
+
+			std::cerr << "cannot open " << mFiles[_i] << "\n";
+
+			return;
+		}
+
+		reader.forEach([&records](const MrtPrefix& _prefix) {
+
+			if (16 != _prefix.type && 17 != _prefix.type) return; // BGP4MP only
+
+			UpdateRecord record;
+
+			record.time = _prefix.time;
+
+			record.afi = _prefix.afi;
+
+			record.length = _prefix.length;
+
+			record.announce = _prefix.announce;
+
+			memcpy(record.addr, _prefix.addr, sizeof(record.addr));
+
+			records.push_back(record);
+		});
+
+		sortRecords(records);
+
+		return;
+	}
+
+	/// \brief sort the records of a file by time
+	static void sortRecords(std::vector<UpdateRecord>& _records) {
+
+		// an update file is written in time order, sort it just in case
+		auto earlier = [](const UpdateRecord& _a, const UpdateRecord& _b) { return _a.time < _b.time; };
+
+		if (!std::is_sorted(_records.begin(), _records.end(), earlier)) std::stable_sort(_records.begin(), _records.end(), earlier);
+
+		return;
+	}
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _files MRT files, compressed or not, in the order for breaking ties of timestamps
+	Ingester(const std::vector<std::string>& _files) : mFiles(_files), mRecords(_files.size()), mParseElapsed(0), mMergeElapsed(0) {}
+
+	/// \brief parse all the files, on as many worker threads as cores (at most one per file)
+	void parse() {
+
+		auto start = std::chrono::steady_clock::now();
+
+		utility::parallelFor(mFiles.size(), [this](size_t _i) { parse(_i); });
+
+		mParseElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		return;
+	}
+
+	/// \brief call _func(record) for each update in the order of time
+	template<typename F>
+	void merge(F _func) {
+
+		auto start = std::chrono::steady_clock::now();
+
+		// heads of the lists, (time, file, index in the file), the earliest on the top
+		typedef std::tuple<uint32, size_t, size_t> Head;
+
+		std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heads;
+
+		for (size_t i = 0; i < mRecords.size(); ++i) {
+
+			if (!mRecords[i].empty()) heads.push(Head(mRecords[i][0].time, i, 0));
+		}
+
+		while (!heads.empty()) {
+
+			Head head = heads.top();
+
+			heads.pop();
+
+			size_t file = std::get<1>(head), idx = std::get<2>(head);
+
+			_func(mRecords[file][idx]);
+
+			if (++idx < mRecords[file].size()) heads.push(Head(mRecords[file][idx].time, file, idx));
+		}
+
+		mMergeElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		return;
+	}
+
+	/// \brief write the merged updates in the update format ("prefix length 0/1")
+	///
+	/// \param _family 0 for IPv4, 1 for IPv6 and 2 for both, into _ofn with suffixes "_ipv4" and "_ipv6"
+	void write(const std::string& _ofn, const int _family = 0) {
+
+		PrefixWriter writer[2];
+
+		if (2 == _family) {
+
+			writer[0].open(_ofn + "_ipv4");
+
+			writer[1].open(_ofn + "_ipv6");
+		}
+		else {
+
+			writer[0].open(_ofn);
+		}
+
+		merge([&](const UpdateRecord& _record) {
+
+			int family = AFI_IP == _record.afi ? 0 : 1;
+
+			if (2 != _family && family != _family) return;
+
+			char prefix[BGPDUMP_ADDRSTRLEN];
+
+			inet_ntop(0 == family ? AF_INET : AF_INET6, _record.addr, prefix, sizeof(prefix));
+
+			writer[2 == _family ? family : 0].writeLine(prefix, _record.length, _record.announce ? " 1" : " 0");
+		});
+
+		return;
+	}
+
+	/// \brief number of updates in total
+	size_t getUpdateNum() const {
+
+		size_t num = 0;
+
+		for (auto& records : mRecords) {
+
+			num += records.size();
+		}
+
+		return num;
+	}
+
+	/// \brief print the numbers of updates and the time for parsing and merging
+	void report() const {
+
+		for (size_t i = 0; i < mFiles.size(); ++i) {
+
+			std::cerr << mFiles[i] << "--update num: " << mRecords[i].size() << std::endl;
+		}
+
+		std::cerr << "file num: " << mFiles.size() << " worker num: " << utility::getWorkerNum(mFiles.size()) << " update num: " << getUpdateNum() << std::endl;
+
+		std::cerr << "parse time (s): " << mParseElapsed << " merge time (s): " << mMergeElapsed << std::endl;
+
+		return;
+	}
+};
+
+#endif
@@ -0,0 +1,613 @@
+#ifndef _MRTREADER_H
+#define _MRTREADER_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file mrtreader.h
+/// \brief Definition of the zero-copy reader of uncompressed MRT files.
+///
+/// Decode the prefixes in the RIB dumps and BGP4MP updates straight out of a memory mapping of the file.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "common/common.h"
+
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/// \brief a prefix decoded from an MRT record, with the fields used by the index
+struct MrtPrefix{
+
+	uint32 time; ///< timestamp of the record, in seconds
+
+	uint16 type; ///< MRT type of the record, i.e., 12 (TABLE_DUMP), 13 (TABLE_DUMP_V2), 16 (BGP4MP) or 17 (BGP4MP_ET)
+
+	uint16 entry; ///< index among the RIB entries of the prefix, one per peer, 0 for updates
+
+	uint16 entryNum; ///< number of RIB entries of the prefix, 1 for updates, 0 for a RIB prefix without an entry (passed once)
+
+	uint16 pathLength; ///< number of ASes in the AS_PATH attribute (a set counts as one), 0xffff if absent
+
+	uint8 afi; ///< 1 for IPv4 and 2 for IPv6
+
+	uint8 length; ///< prefix length
+
+	bool announce; ///< true for a RIB entry or an announce, false for a withdraw
+
+	uint8 addr[16]; ///< prefix in network order, padded with zeros
+
+	uint8 peerAfi; ///< address family of the peer
+
+	uint8 peerIp[16]; ///< address of the peer in network order
+
+	uint32 peerAs; ///< AS of the peer
+};
+
+/// \brief Read the prefixes in an uncompressed MRT file through a memory mapping.
+///
+/// Unlike libbgpdump, nothing is copied or allocated per record: the records are decoded in place and each prefix is passed
+/// to a visitor in a structure on the stack. The supported records are TABLE_DUMP, the unicast RIBs and the peer index table of TABLE_DUMP_V2,
+/// and the BGP messages of BGP4MP and BGP4MP_ET, of which only the UPDATEs are decoded, including the MP_REACH_NLRI and MP_UNREACH_NLRI attributes.
+/// Other records are skipped, as are the malformed ones, which are counted.
+class MrtReader{
+
+private:
+
+	/// \brief a peer in the peer index table
+	struct Peer{
+
+		uint8 afi; ///< address family
+
+		uint8 ip[16]; ///< address
+
+		uint32 as; ///< AS
+	};
+
+	int mFd; ///< file descriptor
+
+	const uint8* mData; ///< mapping of the file
+
+	size_t mSize; ///< size of the file
+
+	std::vector<Peer> mPeers; ///< peer index table of TABLE_DUMP_V2
+
+	size_t mRecordNum; ///< number of records read
+
+	size_t mErrorNum; ///< number of malformed records
+
+	static uint16 read16(const uint8* _p) {
+
+		return static_cast<uint16>((_p[0] << 8) | _p[1]);
+	}
+
+	static uint32 read32(const uint8* _p) {
+
+		return (static_cast<uint32>(_p[0]) << 24) | (static_cast<uint32>(_p[1]) << 16) | (static_cast<uint32>(_p[2]) << 8) | _p[3];
+	}
+
+	/// \brief length of the AS path in a list of path attributes, counted as libbgpdump does
+	///
+	/// \param _asLen 2 or 4 bytes per AS
+	static uint16 getPathLength(const uint8* _p, const uint8* _end, const size_t _asLen) {
+
+		while (_p + 3 <= _end) {
+
+			uint8 flags = _p[0], attrType = _p[1];
+
+			size_t attrLen = (flags & 0x10) ? read16(_p + 2) : _p[2];
+
+			_p += (flags & 0x10) ? 4 : 3;
+
+			if (_p + attrLen > _end) break;
+
+			if (2 == attrType) { // AS_PATH
+
+				size_t num = 0;
+
+				const uint8* seg = _p;
+
+				while (seg + 2 <= _p + attrLen) {
+
+					// AS_SET and AS_CONFED_SET count as one, AS_SEQUENCE and AS_CONFED_SEQUENCE count each AS
+					num += (1 == seg[0] || 4 == seg[0]) ? 1 : seg[1];
+
+					seg += 2 + seg[1] * _asLen;
+				}
+
+				return static_cast<uint16>(std::min(num, static_cast<size_t>(0xfffe)));
+			}
+
+			_p += attrLen;
+		}
+
+		return 0xffff;
+	}
+
+	/// \brief decode a prefix in the NLRI encoding (length and the significant bytes)
+	///
+	/// \return false if the prefix exceeds the record
+	static bool readPrefix(const uint8*& _p, const uint8* _end, MrtPrefix& _prefix) {
+
+		if (_p >= _end) return false;
+
+		_prefix.length = *_p++;
+
+		if (_prefix.length > (1 == _prefix.afi ? 32 : 128)) return false;
+
+		size_t len = (_prefix.length + 7) / 8;
+
+		if (_p + len > _end) return false;
+
+		memset(_prefix.addr, 0, sizeof(_prefix.addr));
+
+		memcpy(_prefix.addr, _p, len);
+
+		_p += len;
+
+		return true;
+	}
+
+	/// \brief decode a list of prefixes of an address family and pass each one to _func
+	template<typename F>
+	static bool readPrefixes(const uint8* _p, const uint8* _end, const uint8 _afi, const bool _announce, MrtPrefix& _prefix, F& _func) {
+
+		_prefix.afi = _afi;
+
+		_prefix.announce = _announce;
+
+		while (_p < _end) {
+
+			if (!readPrefix(_p, _end, _prefix)) return false;
+
+			_func(static_cast<const MrtPrefix&>(_prefix));
+		}
+
+		return true;
+	}
+
+	/// \brief decode a TABLE_DUMP record
+	template<typename F>
+	bool readTableDump(const uint16 _subtype, const uint8* _p, const uint8* _end, MrtPrefix& _prefix, F& _func) {
+
+		if (1 != _subtype && 2 != _subtype) return true; // subtype is the AFI
+
+		size_t addrLen = 1 == _subtype ? 4 : 16;
+
+		if (_p + 4 + addrLen + 6 + addrLen + 4 > _end) return false;
+
+		_prefix.entryNum = 1;
+
+		_p += 4; // view and sequence
+
+		_prefix.afi = static_cast<uint8>(_subtype);
+
+		memset(_prefix.addr, 0, sizeof(_prefix.addr));
+
+		memcpy(_prefix.addr, _p, addrLen);
+
+		_p += addrLen;
+
+		_prefix.length = *_p;
+
+		if (_prefix.length > 8 * addrLen) return false;
+
+		_p += 6; // length, status and originated time
+
+		_prefix.peerAfi = _prefix.afi;
+
+		memset(_prefix.peerIp, 0, sizeof(_prefix.peerIp));
+
+		memcpy(_prefix.peerIp, _p, addrLen);
+
+		_p += addrLen;
+
+		_prefix.peerAs = read16(_p);
+
+		const uint8* attrEnd = _p + 4 + read16(_p + 2);
+
+		if (attrEnd > _end) return false;
+
+		_prefix.pathLength = getPathLength(_p + 4, attrEnd, 2);
+
+		_prefix.announce = true;
+
+		_func(static_cast<const MrtPrefix&>(_prefix));
+
+		return true;
+	}
+
+	/// \brief decode a TABLE_DUMP_V2 record
+	template<typename F>
+	bool readTableDumpV2(const uint16 _subtype, const uint8* _p, const uint8* _end, MrtPrefix& _prefix, F& _func) {
+
+		if (1 == _subtype) { // PEER_INDEX_TABLE
+
+			if (_p + 6 > _end) return false;
+
+			_p += 4; // collector BGP ID
+
+			_p += 2 + read16(_p); // view name
+
+			if (_p + 2 > _end) return false;
+
+			size_t peerNum = read16(_p);
+
+			_p += 2;
+
+			mPeers.assign(peerNum, Peer());
+
+			for (auto& peer : mPeers) {
+
+				if (_p + 5 > _end) return false;
+
+				uint8 peerType = *_p;
+
+				size_t addrLen = (peerType & 1) ? 16 : 4, asLen = (peerType & 2) ? 4 : 2;
+
+				_p += 5; // type and BGP ID
+
+				if (_p + addrLen + asLen > _end) return false;
+
+				peer.afi = (peerType & 1) ? 2 : 1;
+
+				memset(peer.ip, 0, sizeof(peer.ip));
+
+				memcpy(peer.ip, _p, addrLen);
+
+				_p += addrLen;
+
+				peer.as = 4 == asLen ? read32(_p) : read16(_p);
+
+				_p += asLen;
+			}
+
+			return true;
+		}
+
+		if (2 != _subtype && 4 != _subtype) return true; // RIB_IPV4_UNICAST and RIB_IPV6_UNICAST only
+
+		if (_p + 4 > _end) return false;
+
+		_p += 4; // sequence
+
+		_prefix.afi = 2 == _subtype ? 1 : 2;
+
+		_prefix.announce = true;
+
+		if (!readPrefix(_p, _end, _prefix)) return false;
+
+		if (_p + 2 > _end) return false;
+
+		size_t entryNum = read16(_p);
+
+		_p += 2;
+
+		_prefix.entryNum = static_cast<uint16>(entryNum);
+
+		if (0 == entryNum) { // passed once without a peer, as libbgpdump gives the prefix with no entry
+
+			_prefix.entry = 0;
+
+			_prefix.pathLength = 0xffff;
+
+			_prefix.peerAfi = 0;
+
+			memset(_prefix.peerIp, 0, sizeof(_prefix.peerIp));
+
+			_prefix.peerAs = 0;
+
+			_func(static_cast<const MrtPrefix&>(_prefix));
+		}
+
+		for (size_t i = 0; i < entryNum; ++i) {
+
+			if (_p + 8 > _end) return false;
+
+			size_t peerIdx = read16(_p);
+
+			_p += 6; // peer index and originated time
+
+			const uint8* attr = _p + 2;
+
+			_p = attr + read16(_p); // attributes
+
+			if (_p > _end) return false;
+
+			_prefix.pathLength = getPathLength(attr, _p, 4); // always 4-byte ASes in TABLE_DUMP_V2
+
+			_prefix.entry = static_cast<uint16>(i);
+
+			if (peerIdx < mPeers.size()) {
+
+				_prefix.peerAfi = mPeers[peerIdx].afi;
+
+				memcpy(_prefix.peerIp, mPeers[peerIdx].ip, sizeof(_prefix.peerIp));
+
+				_prefix.peerAs = mPeers[peerIdx].as;
+			}
+			else { // no peer index table
+
+				_prefix.peerAfi = 0;
+
+				memset(_prefix.peerIp, 0, sizeof(_prefix.peerIp));
+
+				_prefix.peerAs = 0;
+			}
+
+			_func(static_cast<const MrtPrefix&>(_prefix));
+		}
+
+		return true;
+	}
+
+	/// \brief decode a BGP4MP or BGP4MP_ET record
+	///
+	/// The same subtypes and prefixes as Analyzer::forEachUpdate are passed in the same order, i.e.,
+	/// withdrawn, MP_UNREACH_NLRI, NLRI (announced) and then MP_REACH_NLRI.
+	template<typename F>
+	bool readBgp4mp(const uint16 _type, const uint16 _subtype, const uint8* _p, const uint8* _end, MrtPrefix& _prefix, F& _func) {
+
+		if (17 == _type) _p += 4; // microseconds
+
+		// MESSAGE, MESSAGE_AS4, MESSAGE_LOCAL and MESSAGE_AS4_LOCAL
+		if (1 != _subtype && 4 != _subtype && 6 != _subtype && 7 != _subtype) return true;
+
+		size_t asLen = (4 == _subtype || 7 == _subtype) ? 4 : 2;
+
+		if (_p + 2 * asLen + 4 > _end) return false;
+
+		_prefix.peerAs = 4 == asLen ? read32(_p) : read16(_p);
+
+		_p += 2 * asLen + 2; // peer AS, local AS and interface index
+
+		uint16 afi = read16(_p);
+
+		_p += 2;
+
+		if (1 != afi && 2 != afi) return false;
+
+		size_t addrLen = 1 == afi ? 4 : 16;
+
+		if (_p + 2 * addrLen + 19 > _end) return false;
+
+		_prefix.peerAfi = static_cast<uint8>(afi);
+
+		memset(_prefix.peerIp, 0, sizeof(_prefix.peerIp));
+
+		memcpy(_prefix.peerIp, _p, addrLen);
+
+		_p += 2 * addrLen; // peer IP and local IP
+
+		// BGP message: marker, length and type
+		const uint8* msgEnd = _p + read16(_p + 16);
+
+		if (msgEnd > _end || 2 != _p[18]) return msgEnd <= _end; // not an UPDATE
+
+		_p += 19;
+
+		_prefix.entry = 0;
+
+		_prefix.entryNum = 1;
+
+		// withdrawn routes
+		if (_p + 2 > msgEnd) return false;
+
+		const uint8* withdrawEnd = _p + 2 + read16(_p);
+
+		if (withdrawEnd + 2 > msgEnd) return false;
+
+		if (!readPrefixes(_p + 2, withdrawEnd, 1, false, _prefix, _func)) return false;
+
+		_p = withdrawEnd;
+
+		// path attributes, looking for MP_REACH_NLRI and MP_UNREACH_NLRI
+		const uint8* attrEnd = _p + 2 + read16(_p);
+
+		if (attrEnd > msgEnd) return false;
+
+		_p += 2;
+
+		_prefix.pathLength = getPathLength(_p, attrEnd, asLen);
+
+		const uint8* reach = nullptr;
+
+		const uint8* reachEnd = nullptr;
+
+		while (_p < attrEnd) {
+
+			if (_p + 3 > attrEnd) return false;
+
+			uint8 flags = _p[0], attrType = _p[1];
+
+			size_t attrLen = (flags & 0x10) ? read16(_p + 2) : _p[2];
+
+			_p += (flags & 0x10) ? 4 : 3;
+
+			if (_p + attrLen > attrEnd) return false;
+
+			if (15 == attrType && attrLen >= 3 && 1 == _p[2]) { // MP_UNREACH_NLRI, unicast
+
+				uint16 mpAfi = read16(_p);
+
+				if ((1 == mpAfi || 2 == mpAfi) && !readPrefixes(_p + 3, _p + attrLen, static_cast<uint8>(mpAfi), false, _prefix, _func)) return false;
+			}
+			else if (14 == attrType && attrLen >= 5 && 1 == _p[2]) { // MP_REACH_NLRI, unicast, after the NLRI
+
+				reach = _p;
+
+				reachEnd = _p + attrLen;
+			}
+
+			_p += attrLen;
+		}
+
+		// announced routes
+		if (!readPrefixes(attrEnd, msgEnd, 1, true, _prefix, _func)) return false;
+
+		if (nullptr != reach) {
+
+			uint16 mpAfi = read16(reach);
+
+			const uint8* nlri = reach + 4 + reach[3] + 1; // AFI, SAFI, next hop and reserved
+
+			if (nlri > reachEnd) return false;
+
+			if ((1 == mpAfi || 2 == mpAfi) && !readPrefixes(nlri, reachEnd, static_cast<uint8>(mpAfi), true, _prefix, _func)) return false;
+		}
+
+		return true;
+	}
+
+public:
+
+	MrtReader() : mFd(-1), mData(nullptr), mSize(0), mRecordNum(0), mErrorNum(0) {}
+
+	~MrtReader() {
+
+		close();
+	}
+
+	/// \brief check if a file is compressed by gzip or bzip2, which cannot be mapped
+	static bool isCompressed(const std::string& _fn) {
+
+		unsigned char magic[3] = {0, 0, 0};
+
+		std::ifstream fin(_fn, std::ios_base::binary);
+
+		fin.read(reinterpret_cast<char*>(magic), sizeof(magic));
+
+		return (0x1f == magic[0] && 0x8b == magic[1]) || ('B' == magic[0] && 'Z' == magic[1] && 'h' == magic[2]);
+	}
+
+	/// \brief map a file
+	///
+	/// \return false if the file cannot be opened or mapped
+	bool open(const std::string& _fn) {
+
+		close();
+
+		mFd = ::open(_fn.c_str(), O_RDONLY);
+
+		if (mFd < 0) return false;
+
+		struct stat st;
+
+		if (0 != fstat(mFd, &st)) return false;
+
+		mSize = static_cast<size_t>(st.st_size);
+
+		if (0 == mSize) return true;
+
+		void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFd, 0);
+
+		if (MAP_FAILED == data) {
+
+			mSize = 0;
+
+			return false;
+		}
+
+		madvise(data, mSize, MADV_SEQUENTIAL);
+
+		mData = static_cast<const uint8*>(data);
+
+		return true;
+	}
+
+	/// \brief unmap the file
+	void close() {
+
+		if (nullptr != mData) munmap(const_cast<uint8*>(mData), mSize);
+
+		if (mFd >= 0) ::close(mFd);
+
+		mFd = -1;
+
+		mData = nullptr;
+
+		mSize = 0;
+
+		mPeers.clear();
+
+		return;
+	}
+
+	/// \brief decode all the records and call _func(const MrtPrefix&) for each prefix
+	///
+	/// The structure passed to _func is reused, thus it must be copied if kept.
+	template<typename F>
+	void forEach(F _func) {
+
+		size_t pos = 0;
+
+		MrtPrefix prefix;
+
+		memset(&prefix, 0, sizeof(prefix));
+
+		while (pos + 12 <= mSize) {
+
+			const uint8* p = mData + pos;
+
+			const uint8* end = p + 12 + read32(p + 8);
+
+			if (end > mData + mSize) { // truncated
+
+				mErrorNum++;
+
+				break;
+			}
+
+			prefix.time = read32(p);
+
+			prefix.type = read16(p + 4);
+
+			prefix.entry = 0;
+
+			uint16 subtype = read16(p + 6);
+
+			bool valid = true;
+
+			switch (prefix.type) {
+
+			case 12: valid = readTableDump(subtype, p + 12, end, prefix, _func); break;
+
+			case 13: valid = readTableDumpV2(subtype, p + 12, end, prefix, _func); break;
+
+			case 16: case 17: valid = readBgp4mp(prefix.type, subtype, p + 12, end, prefix, _func); break;
+
+			default: break;
+			}
+
+			if (!valid) mErrorNum++;
+
+			mRecordNum++;
+
+			pos = end - mData;
+		}
+
+		return;
+	}
+
+	/// \brief number of records read
+	size_t getRecordNum() const {
+
+		return mRecordNum;
+	}
+
+	/// \brief number of malformed records
+	size_t getErrorNum() const {
+
+		return mErrorNum;
+	}
+};
+
+#endif
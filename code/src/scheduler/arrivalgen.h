@@ -0,0 +1,348 @@
+#ifndef ARRIVALGEN_H
+#define ARRIVALGEN_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file arrivalgen.h
+/// \brief Definition of the arrival processes driving the schedulers.
+///
+/// Bernoulli, on-off (MMPP), Pareto-burst arrivals and replay of captured timestamps.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+#include "schedutil.h"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+
+/// \brief geometric distribution of the failures before a success in bernoulli trials, accepting a success probability of 1
+///
+/// std::geometric_distribution requires 0 < p < 1, whereas p is 1 for lambda = 1 or a mean sojourn of one slot, in which case 0 is drawn.
+class Geometric{
+
+private:
+
+	bool mCertain; ///< success in every trial, i.e., p >= 1
+
+	std::geometric_distribution<size_t> mDistribution; ///< distribution for p < 1
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _p success probability, in (0, 1]
+	Geometric(const double _p = 0.5) : mCertain(_p >= 1), mDistribution(_p >= 1 ? 0.5 : _p) {}
+
+	template<typename G>
+	size_t operator()(G& _generator) {
+
+		return mCertain ? 0 : mDistribution(_generator);
+	}
+};
+
+
+/// \brief generator of packet arrivals
+///
+/// Four processes are supported (see SchedParam::arrival):
+/// 0 (Bernoulli): burstsize packets arrive in a time slot with probability lambda, independently of the other slots.
+/// 1 (on-off): a two-state Markov-modulated process. The sojourn times in the on and off states are geometric with means meanon and meanoff slots.
+///   No packet arrives in the off state, whereas burstsize packets arrive with probability lambda * (meanon + meanoff) / meanon in an on slot,
+///   thus the mean rate equals the one of the Bernoulli process.
+/// 2 (Pareto): the slots of arrivals are the same as the Bernoulli process, while the number of packets arriving together
+///   follows a (discretized) Pareto distribution of shape paretoshape, with a mean of burstsize.
+/// 3 (replay): packets arrive at the timestamps read from a file, one timestamp (in seconds) per line.
+///   A time slot lasts slottime seconds, or is scaled so that the mean rate is lambda * burstsize if slottime is 0.
+///   The timestamps are replayed repeatedly if the trace file has fewer packets than the lookup traces.
+///
+/// The slot of next arrival is always known in advance, so that the idle slots can be skipped in event-driven mode.
+/// For the Bernoulli and Pareto processes, the gap is drawn at once from a geometric distribution in event-driven mode,
+/// and a trial is made in each slot otherwise, both in the same law.
+class ArrivalGen{
+
+private:
+
+	int mProcess; ///< arrival process
+
+	int mBurstSize; ///< number of packets arriving at the same time, or the mean for Pareto bursts
+
+	bool mEventDriven; ///< event-driven mode
+
+	std::default_random_engine mGenerator; ///< random generator
+
+	std::bernoulli_distribution mDistribution; ///< arrival in a slot
+
+	Geometric mGapDistribution; ///< number of failures before a success in bernoulli trials, i.e., idle slots between two arrivals
+
+	Geometric mOnGapDistribution; ///< idle slots between two arrivals in the on state
+
+	Geometric mOnDistribution; ///< sojourn time in the on state, minus one
+
+	Geometric mOffDistribution; ///< sojourn time in the off state, minus one
+
+	std::uniform_real_distribution<double> mUniform; ///< uniform distribution over [0, 1)
+
+	double mParetoShape; ///< shape of the Pareto distribution
+
+	double mParetoScale; ///< scale (minimum) of the Pareto distribution
+
+	size_t mStateEnd; ///< last slot of the on state
+
+	std::vector<size_t> mReplaySlot; ///< slots of arrivals in the trace file, in increasing order
+
+	std::vector<size_t> mReplayNum; ///< number of packets arriving in each of the slots
+
+	size_t mReplayIdx; ///< index of next arrival in the trace file
+
+	size_t mReplayOffset; ///< slots passed in the previous rounds of replay
+
+	size_t mNextArrival; ///< slot of next arrival
+
+	size_t mNextNum; ///< number of packets in next arrival
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _param parameters of the run, the seed is taken from the clock if _param.seed is 0
+	ArrivalGen(const SchedParam& _param) :
+		mProcess(_param.arrival),
+		mBurstSize(_param.burstsize),
+		mEventDriven(_param.eventDriven),
+		mGenerator(0 != _param.seed ? _param.seed : std::chrono::system_clock::now().time_since_epoch().count()),
+		mDistribution(_param.lambda),
+		mGapDistribution(_param.lambda),
+		mUniform(0.0, 1.0),
+		mParetoShape(_param.paretoshape),
+		mParetoScale(0),
+		mStateEnd(0),
+		mReplayIdx(0),
+		mReplayOffset(0),
+		mNextArrival(0),
+		mNextNum(0) {
+
+		assert(_param.lambda > 0 && _param.lambda <= 1);
+
+		switch (mProcess) {
+
+		case 1: { // on-off
+
+			assert(_param.meanon >= 1 && _param.meanoff >= 1);
+
+			double onProb = _param.lambda * (_param.meanon + _param.meanoff) / _param.meanon;
+
+			if (onProb > 1) {
+
+				std::cerr << "arrival probability in the on state is " << onProb << ", truncated to 1.\n";
+
+				onProb = 1;
+			}
+
+			mOnGapDistribution = Geometric(onProb);
+
+			mOnDistribution = Geometric(1 / _param.meanon);
+
+			mOffDistribution = Geometric(1 / _param.meanoff);
+
+			mStateEnd = mOnDistribution(mGenerator); // start in the on state, slot 0 included
+
+			mNextArrival = nextOnOff(1);
+
+			mNextNum = mBurstSize;
+
+			break;
+		}
+
+		case 2: // Pareto
+
+			assert(mParetoShape > 1);
+
+			// the mean of a Pareto distribution is shape * scale / (shape - 1)
+			mParetoScale = mBurstSize * (mParetoShape - 1) / mParetoShape;
+
+			if (mEventDriven) mNextArrival = 1 + mGapDistribution(mGenerator);
+
+			break;
+
+		case 3: // replay
+
+			loadReplay(_param);
+
+			mNextArrival = mReplaySlot[0];
+
+			mNextNum = mReplayNum[0];
+
+			mReplayIdx = 1;
+
+			break;
+
+		default: // Bernoulli
+
+			if (mEventDriven) mNextArrival = 1 + mGapDistribution(mGenerator);
+		}
+	}
+
+	/// \brief print the arrival process of a run
+	static void reportProcess(const SchedParam& _param) {
+
+		switch (_param.arrival) {
+
+		case 1: std::cerr << "arrival process: on-off, mean on: " << _param.meanon << " mean off: " << _param.meanoff << std::endl; break;
+
+		case 2: std::cerr << "arrival process: Pareto bursts, shape: " << _param.paretoshape << std::endl; break;
+
+		case 3: std::cerr << "arrival process: replay of " << _param.arrivalfile << std::endl; break;
+
+		default: std::cerr << "arrival process: Bernoulli" << std::endl;
+		}
+
+		return;
+	}
+
+	/// \brief read the timestamps and map them into time slots
+	void loadReplay(const SchedParam& _param) {
+
+		std::ifstream fin(_param.arrivalfile, std::ios_base::binary);
+
+		if (!fin) {
+
+			std::cerr << "cannot open " << _param.arrivalfile << "\n";
+
+			exit(1);
+		}
+
+		std::vector<double> timestamps;
+
+		double t;
+
+		while (fin >> t) {
+
+			timestamps.push_back(t);
+		}
+
+		assert(!timestamps.empty());
+
+		std::sort(timestamps.begin(), timestamps.end());
+
+		double span = timestamps.back() - timestamps.front();
+
+		double slottime = _param.slottime;
+
+		// scale the slot to the given rate, i.e., the packets span size / rate slots
+		if (0 == slottime) slottime = span > 0 ? span * _param.lambda * _param.burstsize / timestamps.size() : 1;
+
+		for (auto stamp : timestamps) {
+
+			size_t slot = 1 + static_cast<size_t>((stamp - timestamps.front()) / slottime);
+
+			if (!mReplaySlot.empty() && mReplaySlot.back() == slot) {
+
+				mReplayNum.back()++;
+			}
+			else {
+
+				mReplaySlot.push_back(slot);
+
+				mReplayNum.push_back(1);
+			}
+		}
+
+		return;
+	}
+
+	/// \brief slot of next arrival in the on-off process, no earlier than _slot
+	size_t nextOnOff(size_t _slot) {
+
+		while (true) {
+
+			if (_slot <= mStateEnd) { // in the on state
+
+				size_t slot = _slot + mOnGapDistribution(mGenerator);
+
+				if (slot <= mStateEnd) return slot;
+			}
+
+			// the on state ends before next arrival, go through an off state and a new on state
+			_slot = mStateEnd + 1 + mOffDistribution(mGenerator) + 1;
+
+			mStateEnd = _slot + mOnDistribution(mGenerator);
+		}
+	}
+
+	/// \brief number of packets in a Pareto burst
+	size_t drawPareto() {
+
+		double num = std::ceil(mParetoScale / std::pow(1 - mUniform(mGenerator), 1 / mParetoShape));
+
+		return num < 1e9 ? static_cast<size_t>(num) : static_cast<size_t>(1e9); // keep the tail finite
+	}
+
+	/// \brief number of packets arriving in a slot, called once per slot in increasing order, or at least for the slots of arrivals in event-driven mode
+	size_t arrive(const size_t _slot) {
+
+		size_t num = 0;
+
+		switch (mProcess) {
+
+		case 1: // on-off
+
+			if (_slot != mNextArrival) return 0;
+
+			mNextArrival = nextOnOff(_slot + 1);
+
+			return mBurstSize;
+
+		case 3: // replay
+
+			if (_slot != mNextArrival) return 0;
+
+			num = mNextNum;
+
+			if (mReplayIdx == mReplaySlot.size()) { // start another round right after the last slot
+
+				mReplayOffset += mReplaySlot.back();
+
+				mReplayIdx = 0;
+			}
+
+			mNextArrival = mReplayOffset + mReplaySlot[mReplayIdx];
+
+			mNextNum = mReplayNum[mReplayIdx];
+
+			mReplayIdx++;
+
+			return num;
+
+		default: // Bernoulli and Pareto
+
+			if (!mEventDriven) {
+
+				if (!mDistribution(mGenerator)) return 0;
+			}
+			else {
+
+				if (_slot != mNextArrival) return 0;
+
+				mNextArrival = _slot + 1 + mGapDistribution(mGenerator);
+			}
+
+			return 2 == mProcess ? drawPareto() : mBurstSize;
+		}
+	}
+
+	/// \brief slot of next arrival, only valid in event-driven mode
+	size_t getNextArrival() const {
+
+		return mNextArrival;
+	}
+};
+
+#endif
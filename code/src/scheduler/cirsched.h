@@ -16,22 +16,26 @@
 ///////////////////////////////////////////////////////////
 
 #include "../common/common.h"
+#include "schedutil.h"
+#include "arrivalgen.h"
 
 #include <string>
-#include <sstream>
-#include <queue>
+#include <chrono>
+#include <numeric>
 
 /// \brief Schedule lookup requests in a circular pipeline
 ///
 /// In a circular pipeline, a search request may start searching from any pipe stage (dependent on the location of the target subtrie) 
 /// and wrap around the pipeline to finsh the task.
 ///
+/// Each stage holds a single request per time slot, thus multiple ports or banks (see SchedParam) cause no difference,
+/// and only the stage of a step is taken from the traces.
+///
 /// \param W at most W search steps for a request
 /// \param K number of pipe stages
-/// \param S size of request queue per stage
 ///
 /// \note K >= W. That is, the number of pipe stages is no fewer than the height of the tree (the number of search steps)
-template<int W, int K, int S = QUEUESIZE>
+template<int W, int K>
 class CirSched{
 
 private:
@@ -44,62 +48,29 @@ private:
 
 	size_t mBusySlotNumAvg; ///< average number of busy time slots over all pipe stages
 
-	int mMaxQueueLength[K]; ///< maximum lengths of the request queues
+	size_t mMaxQueueLength[K]; ///< maximum lengths of the request queues
 
 	double mAvgQueueLength[K]; ///< average lengths of the request queues
 
-public:
-
-	/// \brief structure of request
-	struct Request{
-
-		int stagelist[W];
-
-		int stepnum;
-
-		int curstep;
-
-		Request() : curstep(0) {}
-	};
-
-	/// \brief structure of request queue 
-	struct ReqQue{
-
-		std::vector<Request*> mData; ///< payload
-
-		/// \brief check if queue is empty
-		bool isEmpty() {
-
-			return 0 == mData.size();
-		}
-
-		/// \brief check if queue is overflow
-		bool isOverflow() {
+	size_t mPendingNum; ///< number of requests in the queues or in the pipeline
 
-			return S < mData.size();
-		}
+	double mElapsed; ///< wall-clock time for the simulation, in seconds
 
-		/// \brief append a request to the end of the queue
-		void append(Request* _req) {
+	SchedParam mParam; ///< parameters of current run
 
-			mData.push_back(_req);
+	LatencyStat mLatencyStat; ///< latency of the completed requests
 
-			return;
-		}
+	size_t mDropNumStage[K]; ///< number of requests dropped at the queue of each pipe stage
 
-		/// \brief remove the head of request (which is assigned to the corresponding pipe stage)
-		void removeHead() {
+	ReqSource mSource; ///< source of requests
 
-			mData.erase(mData.begin());
-
-			return;
-		}
+public:
 
-		Request* getHead() {
+	/// \brief structure of request
+	typedef SchedRequest Request;
 
-			return mData[0];
-		}
-	};
+	/// \brief structure of request queue 
+	typedef RingQueue<Request*> ReqQue;
 
 	ReqQue mReqQue[K]; ///< queues of requests, one queue per stage
 
@@ -134,9 +105,9 @@ public:
 		}
 
 		/// \brief dispatch the completed request
-		void dispatch() {
+		void dispatch(ReqPool& _pool) {
 
-			delete mReq;
+			_pool.release(mReq);
 
 			mReq = nullptr;
 
@@ -160,7 +131,7 @@ public:
 
 	Stage mStage[K];
 
-	CirSched() : mSlotNum(0), mRequestNum(0), mBusySlotNumAvg(0) {
+	CirSched() : mSlotNum(0), mRequestNum(0), mBusySlotNumAvg(0), mPendingNum(0), mElapsed(0) {
 
 		for (int i = 0; i < K; ++i) {
 
@@ -176,6 +147,11 @@ public:
 
 			mAvgQueueLength[i] = 0;
 		}
+
+		for (int i = 0; i < K; ++i) {
+
+			mDropNumStage[i] = 0;
+		}
 	}
 
 
@@ -192,6 +168,131 @@ public:
 		return true;
 	}
 
+	/// \brief check if no request is in the queues, in the pipeline or held at the source
+	bool isIdle() const {
+
+		return 0 == mPendingNum && mSource.isIdle();
+	}
+
+	/// \brief queue the request in the stage at which the target root node is located
+	///
+	/// \return false if the queue is full, in which case the request is not queued
+	bool admit(Request* _req) {
+
+		int startStage = _req->stagelist[0] / mParam.banknum;
+
+		if (0 != mParam.queuepolicy && mReqQue[startStage].size() >= static_cast<size_t>(mParam.queuesize)) {
+
+			if (1 == mParam.queuepolicy) mDropNumStage[startStage]++;
+
+			return false;
+		}
+
+		mReqQue[startStage].append(_req);
+
+		++mPendingNum;
+
+		// collect max queue length
+		if (mReqQue[startStage].size() > mMaxQueueLength[startStage]) {
+
+			mMaxQueueLength[startStage] = mReqQue[startStage].size();
+		}
+
+		return true;
+	}
+
+	/// \brief number of requests in the queues or in the pipeline
+	size_t getPendingNum() const {
+
+		return mPendingNum;
+	}
+
+	/// \brief get ready for a run, with the statistics of the previous run cleared
+	void prepare(const SchedParam& _param) {
+
+		mParam = _param;
+
+		for (int i = 0; i < K; ++i) {
+
+			mReqQue[i] = ReqQue(mParam.queuesize);
+		}
+
+		mSource = ReqSource(mParam.queuepolicy);
+
+		mLatencyStat = LatencyStat();
+
+		for (int i = 0; i < K; ++i) {
+
+			mBusySlotNumStage[i] = 0;
+
+			mMaxQueueLength[i] = 0;
+
+			mAvgQueueLength[i] = 0;
+
+			mDropNumStage[i] = 0;
+		}
+
+		return;
+	}
+
+	/// \brief set current time slot
+	void advanceTo(const size_t _slot) {
+
+		mSlotNum = _slot;
+
+		return;
+	}
+
+	/// \brief run current time slot
+	///
+	/// \param _pool pool to which completed requests are released
+	/// \param _onFinish called for each completed request before it is released
+	template<typename F>
+	void step(ReqPool& _pool, F _onFinish) {
+
+		// collect average queue length	
+		for (int i = 0; i < K; ++i) {
+
+			mAvgQueueLength[i] += mReqQue[i].size();
+		}
+
+		// execute a search request
+		execute();
+
+		// dispatch completed requests
+		for (int i = 0; i < K; ++i) {
+
+			if (!mStage[i].isEmpty() && mStage[i].isFinished()) {
+
+				mStage[i].getReq()->finishSlot = mSlotNum;
+
+				mLatencyStat.record(mStage[i].getReq());
+
+				_onFinish(mStage[i].getReq());
+	
+				mStage[i].dispatch(_pool);
+
+				--mPendingNum;
+			}
+		}
+
+		// forward the request in each stage to the downstream stage
+		Request* preReq = mStage[K - 1].getReq();
+
+		Request* curReq;
+
+		for (int i = 0; i < K; ++i) {
+
+			curReq = mStage[i].getReq();
+
+			mStage[i].setReq(preReq);
+
+			preReq = curReq;			
+		}		
+
+		return;
+	}
+
 	/// \brief execute 
 	void execute() {
 	
@@ -221,139 +322,137 @@ public:
 	}
 
 	/// \brief a run of executing search requests
-	void searchRun(const std::string& _traceFile) {
+	void searchRun(const std::string& _traceFile, const SchedParam& _param = SchedParam()) {
 
-		// step 1: count number of traces
-		std::ifstream fin(_traceFile, std::ios_base::binary);
+		TraceBuffer trace;
 
-		std::string line;
+		trace.load(_traceFile);
 
-		size_t linenum = 0;
+		searchRun(trace, _param);
 
-		while (getline(fin, line)) linenum++;
+		return;
+	}
 
-		fin.close();
+	/// \brief a run of executing search requests on the traces in memory
+	///
+	/// In event-driven mode, the slot of next arrival is drawn from a geometric distribution and the idle slots are skipped.
+	///
+	/// \param _trace traces, which can be shared by concurrent runs
+	/// \param _param parameters of the run
+	void searchRun(const TraceBuffer& _trace, const SchedParam& _param = SchedParam()) {
 
-		mRequestNum = linenum;
+		// step 1: prepare
+		prepare(_param);
 
-		std::cerr << "linenum: " << linenum << std::endl;
+		mRequestNum = _trace.size();
+
+		if (mParam.report) std::cerr << "linenum: " << mRequestNum << std::endl;
+
+		auto admitReq = [this](Request* _req) { return admit(_req); };
 
 		// step 2: scheduling
-		// packet arrivals submit to bernoulli distribution
-		unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+		ArrivalGen arrival(mParam);
 
-		std::default_random_engine generator(seed);
+		// start simulation
+		auto start = std::chrono::steady_clock::now();
 
-		std::bernoulli_distribution distribution(LAMBDA);
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("CirSched", {W, K}, "searchRun"));
 
-		auto genreq = std::bind(distribution, generator);
+		counter.start();
 
-		// start simulation
-		std::ifstream fin2(_traceFile, std::ios_base::binary);
+		ReqPool pool;
 
-		std::string line2;
+		size_t nextReq = 0; // index of next arrival in the trace
 
 		mSlotNum = 0;
 		
-		while (linenum > 0 || !isAllQueueEmpty()) {
+		while (nextReq < mRequestNum || !isIdle()) {
 
-			mSlotNum++;
+			// nothing happens until next arrival, statistics of the skipped slots are all zeros
+			if (mParam.eventDriven && isIdle()) mSlotNum = arrival.getNextArrival() - 1;
 
-			if (genreq()) {
+			advanceTo(mSlotNum + 1);
 
-				for (int i = 0; i < BURSTSIZE; ++i) {
+			// requests held at the source go first
+			mSource.retry(admitReq);
 
-					if (linenum > 0) {
+			size_t arrivalNum = std::min(arrival.arrive(mSlotNum), mRequestNum - nextReq); // number of packets arriving in current slot, up to the requests left
 
-						getline(fin2, line2);
+			for (size_t i = 0; i < arrivalNum; ++i) {
 
-						std::stringstream ss(line2);
+				if (nextReq < mRequestNum) {
 
-						Request* newReq = new Request();
+					Request* newReq = pool.acquire(_trace, nextReq++, mSlotNum);
 
-						ss >> newReq->stepnum;
+					if (0 == newReq->stepnum) { // no need to be further processed
 
-						for (int j = 0; j < newReq->stepnum; ++j) {
+						pool.release(newReq);
+					}
+					else { // queue the request in the stage at which the target root node is located
 
-							ss >> newReq->stagelist[j];
-						}
+						mSource.offer(newReq, mSlotNum, pool, admitReq);
+					}
+				}
+			}
 
-			//			std::cerr << "\nnewReq: " << newReq->stepnum << " ";
-			//			for (int j = 0; j < newReq->stepnum; ++j) {
-			//				std::cerr << newReq->stagelist[j]<< " ";
-			//			}
-			//			std::cerr << std::endl;
+			step(pool, [](Request*) {});
+		}
 
-						if (0 == newReq->stepnum) { // no need to be further processed
+		mElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-							delete newReq;
+		counter.stop(mRequestNum);
+	
+		if (mParam.report) searchReport();
 
-							newReq = nullptr;
-						}
-						else { // queue the request in the stage at which the target root node is located
+		return;
+	}
 
-							int startStage = newReq->stagelist[0];
+	/// \brief latency of the completed requests
+	const LatencyStat& getLatencyStat() const {
 
-							mReqQue[startStage].append(newReq);
+		return mLatencyStat;
+	}
 
-							// collect max queue length
-							if (mReqQue[startStage].mData.size() > mMaxQueueLength[startStage]) {
+	/// \brief number of time slots in total
+	size_t getSlotNum() const {
 
-								mMaxQueueLength[startStage] = mReqQue[startStage].mData.size();
-							}
-						}
+		return mSlotNum;
+	}
 
-						--linenum;
-					}
-				}
-			}
+	/// \brief busy slots over total slots, averaged over all pipe stages
+	double getUsageRatio() const {
 
-			// collect average queue length	
-			for (int i = 0; i < K; ++i) {
+		return std::accumulate(mBusySlotNumStage, mBusySlotNumStage + K, 0.0) / K / mSlotNum;
+	}
 
-				mAvgQueueLength[i] += mReqQue[i].mData.size();
-			}
+	/// \brief average length of all the queues in total (per slot)
+	double getAvgQueueLength() const {
 
-			// execute a search request
-			execute();
+		return std::accumulate(mAvgQueueLength, mAvgQueueLength + K, 0.0) / mSlotNum;
+	}
 
-			// dispatch completed requests
-			for (int i = 0; i < K; ++i) {
+	/// \brief sum of the maximum lengths of the queues
+	size_t getMaxQueueLength() const {
 
-				if (!mStage[i].isEmpty() && mStage[i].isFinished()) {
-	
-					mStage[i].dispatch();
-				}
-			}
-	
-			// forward the request in each stage to the downstream stage
-			Request* preReq = mStage[K - 1].getReq();
-	
-			Request* curReq;
-	
-			for (int i = 0; i < K; ++i) {
-	
-				curReq = mStage[i].getReq();
-	
-				mStage[i].setReq(preReq);
-	
-				preReq = curReq;			
-			}		
-		}
-	
-		searchReport();
+		return std::accumulate(mMaxQueueLength, mMaxQueueLength + K, static_cast<size_t>(0));
+	}
 
-		return;
+	/// \brief statistics of drop and blocking
+	const ReqSource& getSource() const {
+
+		return mSource;
 	}
 
 	/// \breif print search report
 	void searchReport() {
 
-		std::cerr << "lamda: " << LAMBDA << std::endl;
+		std::cerr << "lamda: " << mParam.lambda << std::endl;
+
+		std::cerr << "burst size: " << mParam.burstsize << std::endl;
 
-		std::cerr << "burst size: " << BURSTSIZE << std::endl;
+		ArrivalGen::reportProcess(mParam);
 
-		std::cerr << "queue size: " << QUEUESIZE << std::endl; 
+		std::cerr << "queue size: " << mParam.queuesize << std::endl; 
 
 		std::cerr << "request num: " << mRequestNum << std::endl;
 
@@ -387,6 +486,20 @@ public:
 
 		std::cerr << "total max queue length: " << total_max_queue_length << std::endl;
 
+		mSource.report(mSlotNum, mParam.lambda * mParam.burstsize);
+
+		mLatencyStat.report();
+
+		if (1 == mParam.queuepolicy) {
+
+			for (int i = 0; i < K; ++i) {
+
+				std::cerr << "drop num for queue " << i << ": " << mDropNumStage[i] << std::endl;
+			}
+		}
+
+		std::cerr << "simulation time (s): " << mElapsed << " speed (slots/s): " << mSlotNum / mElapsed << std::endl;
+
 		return;
 	}
 
@@ -14,15 +14,21 @@
 ///////////////////////////////////////////////////////////
 
 #include "../common/common.h"
+#include "schedutil.h"
+#include "arrivalgen.h"
 
 #include <string>
-#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
 
 
 /// \brief schedule lookup tasks in a linear pipeline
 ///
 /// In a linear pipeline, each lookup task starts at the initial pipe stage and steps through the remaining pipe stages from left to right.
 /// Therefore, the throughput of a linear pipeline is one task per time slot.
+/// Tasks arriving faster than that (e.g., when driven by MultiSched) wait in an entry queue before the initial stage.
 /// 
 /// \param K number of pipe stages.
 template<int K>
@@ -37,19 +43,26 @@ private:
 	
 	size_t mBusySlotNumAvg; // average number of busy time slots over all pipe stages
 
-public:
+	double mElapsed; ///< wall-clock time for the simulation, in seconds
 
-	/// \brief structure of a task
-	struct Request{
+	SchedParam mParam; ///< parameters of current run
 
-		int stagelist[K]; ///< list of stages to be visited
-	
-		int stepnum; ///< number of steps in the task
+	LatencyStat mLatencyStat; ///< latency of the completed requests
 
-		int curstep; ///< index of step in execution 
+	size_t mPendingNum; ///< number of requests in the entry queue or in the pipeline
 
-		Request() : curstep(0) {}
-	};
+	size_t mMaxQueueLength; ///< maximum length of the entry queue
+
+	double mAvgQueueLength; ///< length of the entry queue accumulated over all time slots
+
+	ReqSource mSource; ///< source of requests
+
+public:
+
+	/// \brief structure of a task
+	typedef SchedRequest Request;
+
+	RingQueue<Request*> mEntryQue; ///< requests waiting for the initial stage
 
 	/// \brief structure of a scheduler
 	///
@@ -89,7 +102,7 @@ public:
 	Stage stages[K]; ///< one scheduler per stage
 
 	/// \brief default ctor
-	LinSched () : mSlotNum(0), mRequestNum(0), mBusySlotNumAvg(0){
+	LinSched () : mSlotNum(0), mRequestNum(0), mBusySlotNumAvg(0), mElapsed(0), mPendingNum(0), mMaxQueueLength(0), mAvgQueueLength(0) {
 
 		for (int i = 0; i < K; ++i) {
 
@@ -111,105 +124,302 @@ public:
 		return true;
 	}
 
-	/// \brief perform lookup 
+	/// \brief check if no request is in the entry queue, in the pipeline or held at the source
+	bool isIdle() const {
+
+		return 0 == mPendingNum && mSource.isIdle();
+	}
+
+	/// \brief number of requests in the entry queue or in the pipeline
+	size_t getPendingNum() const {
+
+		return mPendingNum;
+	}
+
+	/// \brief get ready for a run, with the statistics of the previous run cleared
+	void prepare(const SchedParam& _param) {
+
+		mParam = _param;
+
+		mEntryQue = RingQueue<Request*>(mParam.queuesize);
+
+		mSource = ReqSource(mParam.queuepolicy);
+
+		mLatencyStat = LatencyStat();
+
+		for (int i = 0; i < K; ++i) {
+
+			mBusySlotNumStage[i] = 0;
+		}
+
+		mMaxQueueLength = 0;
+
+		mAvgQueueLength = 0;
+
+		return;
+	}
+
+	/// \brief set current time slot
+	void advanceTo(const size_t _slot) {
+
+		mSlotNum = _slot;
+
+		return;
+	}
+
+	/// \brief append a request to the entry queue unless the queue is full
 	///
-	/// A new arrival comes at the beginning of each time slot.
-	void searchRun(const std::string& _traceFile) {
+	/// \return false if the queue is full, in which case the request is not queued
+	bool admit(Request* _req) {
 
-		// step 1: count number of traces 
-		std::ifstream fin(_traceFile, std::ios_base::binary);
+		if (0 != mParam.queuepolicy && mEntryQue.size() >= static_cast<size_t>(mParam.queuesize)) return false;
 
-		std::string line;
+		mEntryQue.append(_req);
 
-		size_t linenum = 0;
+		++mPendingNum;
 
-		while (getline(fin, line)) linenum++;
+		if (mEntryQue.size() > mMaxQueueLength) mMaxQueueLength = mEntryQue.size();
 
-		fin.close();
-		
-		mRequestNum = linenum;
+		return true;
+	}
 
-		// step 2: scheduling
-		std::ifstream fin2(_traceFile, std::ios_base::binary);
+	/// \brief run current time slot
+	///
+	/// \param _pool pool to which completed requests are released
+	/// \param _onFinish called for each completed request before it is released
+	template<typename F>
+	void step(ReqPool& _pool, F _onFinish) {
 
-		std::string line2;
+		// step 1: the head of the entry queue enters the initial stage
+		if (!mEntryQue.isEmpty()) {
 
-		mSlotNum = 0;
+			stages[0].req = mEntryQue.getHead();
 
-		while (linenum > 0 || !isEmpty()) {
+			mEntryQue.removeHead();
+		}
 
-			mSlotNum++;
-	
-			// step 1: here comes a new arrival
-			if (linenum > 0) {
+		mAvgQueueLength += mEntryQue.size();
 
-				getline(fin2, line2);
+		// step 2: performs one lookup step
+		for (int i = 0; i < K; ++i) {
 
-				std::stringstream ss(line2);
-		
-				Request* newReq = new Request();
+			Stage& curstage = stages[i];
 
-				ss >> newReq->stepnum;
-		
-				for (int i = 0; i < newReq->stepnum; ++i) {
+			if (curstage.exist()) { // exists a request 
 
-					ss >> newReq->stagelist[i];		
-				}				
+				curstage.execute();
+	
+				mBusySlotNumStage[i]++;
 
-				--linenum;
-				
-				// deliver it to the initial stage
-				if (0 == newReq->stepnum) {
+				if (curstage.isFinished()) {
 
-					delete newReq;
-				}
-				else {
+					curstage.req->finishSlot = mSlotNum;
 
-					stages[0].req = newReq; 
-				}
-			}	
+					mLatencyStat.record(curstage.req);
 
-			// step 2: performs one lookup step
-			for (int i = 0; i < K; ++i) {
+					_onFinish(curstage.req);
 
-				Stage& curstage = stages[i];
+					_pool.release(curstage.req);
 
-				if (curstage.exist()) { // exists a request 
+					curstage.req = nullptr;
 
-					curstage.execute();
+					--mPendingNum;
+				}
+			}
+		}
 		
-					mBusySlotNumStage[i]++;
+		// step 3: transfer
+		for (int i = K - 1; i >= 1; --i) {
 
-					if (curstage.isFinished()) {
+			if (nullptr != stages[i - 1].req) {
 
-						delete curstage.req;
+				stages[i].req = stages[i - 1].req;
+			}
+			else {
 
-						curstage.req = nullptr;
-					}
-				}
+				stages[i].req = nullptr;
 			}
-			
-			// step 3: transfer
-			for (int i = K - 1; i >= 1; --i) {
+		} 
 
-				if (nullptr != stages[i - 1].req) {
+		stages[0].req = nullptr;
 
-					stages[i].req = stages[i - 1].req;
-				}
-				else {
+		return;
+	}
+
+	/// \brief perform lookup in an event-driven manner
+	///
+	/// A request arriving at slot t with n steps occupies stage i at slot t + i (0 <= i < n), 
+	/// since no request ever waits in a linear pipeline. Thus the statistics are obtained without stepping the time slots.
+	void eventRun(const TraceBuffer& _trace) {
+
+		std::vector<size_t> stepNumCount(K + 1, 0); // number of requests with n steps
+
+		mSlotNum = 0;
+
+		for (size_t i = 0; i < mRequestNum; ++i) {
+
+			int stepnum = _trace.getStepNum(i);
+
+			assert(stepnum <= K);
+
+			stepNumCount[stepnum]++;
+
+			if (0 != stepnum) mLatencyStat.recordNoWait(stepnum);
+
+			// arrives at slot i + 1 and leaves at slot i + stepnum
+			size_t lastSlot = i + std::max(stepnum, 1);
+
+			if (lastSlot > mSlotNum) mSlotNum = lastSlot;
+		}
+
+		// stage i is busy for requests with more than i steps
+		size_t reqNum = 0;
+
+		for (int i = K - 1; i >= 0; --i) {
 
-					stages[i].req = nullptr;
+			reqNum += stepNumCount[i + 1];
+
+			mBusySlotNumStage[i] += reqNum;
+		}
+
+		return;
+	}
+
+	/// \brief perform lookup 
+	void searchRun(const std::string& _traceFile, const SchedParam& _param = SchedParam()) {
+
+		TraceBuffer trace;
+
+		trace.load(_traceFile);
+
+		searchRun(trace, _param);
+
+		return;
+	}
+
+	/// \brief perform lookup on the traces in memory
+	///
+	/// For the Bernoulli process (the default), a new arrival comes at the beginning of each time slot, thus lambda and burst size in the parameters are not used,
+	/// and in event-driven mode, statistics are computed per request instead of stepping each time slot, the results are identical.
+	/// Other arrival processes (see ArrivalGen) feed the entry queue, and the idle slots are skipped in event-driven mode.
+	///
+	/// \param _trace traces, which can be shared by concurrent runs
+	/// \param _param parameters of the run
+	void searchRun(const TraceBuffer& _trace, const SchedParam& _param = SchedParam()) {
+
+		// step 1: prepare
+		prepare(_param);
+
+		mRequestNum = _trace.size();
+
+		auto start = std::chrono::steady_clock::now();
+
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("LinSched", {K}, "searchRun"));
+
+		counter.start();
+
+		if (mParam.eventDriven && 0 == mParam.arrival) {
+
+			eventRun(_trace);
+
+			mElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			counter.stop(mRequestNum);
+
+			if (mParam.report) searchReport();
+
+			return;
+		}
+
+		// step 2: scheduling
+		ReqPool pool;
+
+		ArrivalGen arrival(mParam);
+
+		auto admitReq = [this](Request* _req) { return admit(_req); };
+
+		size_t nextReq = 0; // index of next arrival in the trace
+
+		mSlotNum = 0;
+
+		while (nextReq < mRequestNum || !isIdle()) {
+
+			// nothing happens until next arrival, statistics of the skipped slots are all zeros
+			if (0 != mParam.arrival && mParam.eventDriven && isIdle()) mSlotNum = arrival.getNextArrival() - 1;
+
+			advanceTo(mSlotNum + 1);
+
+			// requests held at the source go first
+			mSource.retry(admitReq);
+
+			size_t arrivalNum = std::min(0 == mParam.arrival ? 1 : arrival.arrive(mSlotNum), mRequestNum - nextReq); // number of packets arriving in current slot, up to the requests left
+	
+			for (size_t i = 0; i < arrivalNum; ++i) {
+
+				if (nextReq < mRequestNum) {
+
+					Request* newReq = pool.acquire(_trace, nextReq++, mSlotNum);
+
+					// deliver it to the initial stage
+					if (0 == newReq->stepnum) {
+
+						pool.release(newReq);
+					}
+					else {
+
+						mSource.offer(newReq, mSlotNum, pool, admitReq);
+					}
 				}
-			} 
+			}
 
-			stages[0].req = nullptr;
+			step(pool, [](Request*) {});
 		}		
+
+		mElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		counter.stop(mRequestNum);
 		
-		searchReport();
+		if (mParam.report) searchReport();
 
 		return;
 	}
 
+	/// \brief latency of the completed requests
+	const LatencyStat& getLatencyStat() const {
+
+		return mLatencyStat;
+	}
+
+	/// \brief number of time slots in total
+	size_t getSlotNum() const {
+
+		return mSlotNum;
+	}
+
+	/// \brief busy slots over total slots, averaged over all pipe stages
+	double getUsageRatio() const {
+
+		return std::accumulate(mBusySlotNumStage, mBusySlotNumStage + K, 0.0) / K / mSlotNum;
+	}
+
+	/// \brief average length of the entry queue (per slot)
+	double getAvgQueueLength() const {
+
+		return mAvgQueueLength / mSlotNum;
+	}
+
+	/// \brief maximum length of the entry queue
+	size_t getMaxQueueLength() const {
+
+		return mMaxQueueLength;
+	}
+
+	/// \brief statistics of drop and blocking
+	const ReqSource& getSource() const {
+
+		return mSource;
+	}
+
 	void searchReport() {
 
 		std::cerr << "request num: " << mRequestNum << std::endl;
@@ -230,6 +440,19 @@ public:
 		std::cerr << "busy slot num in average (per stage): " << mBusySlotNumAvg << std::endl;
 
 		std::cerr << "usage ratio: (busy slot/ total slot): " << static_cast<double>(mBusySlotNumAvg) / mSlotNum << std::endl;
+
+		if (0 != mParam.arrival) {
+
+			ArrivalGen::reportProcess(mParam);
+
+			std::cerr << "avg entry queue length (per slot): " << getAvgQueueLength() << " max: " << mMaxQueueLength << std::endl;
+
+			mSource.report(mSlotNum, mParam.lambda * mParam.burstsize);
+		}
+
+		mLatencyStat.report();
+
+		std::cerr << "simulation time (s): " << mElapsed << " speed (slots/s): " << mSlotNum / mElapsed << std::endl;
 	}
 
 
@@ -0,0 +1,415 @@
+#ifndef MULTISCHED_H
+#define MULTISCHED_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file multisched.h
+/// \brief Definition of the scheduler for multiple pipelines.
+///
+/// Dispatch lookup tasks to multiple pipelines working in parallel.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+#include "schedutil.h"
+#include "arrivalgen.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+/// \brief Dispatch lookup requests to multiple pipelines
+///
+/// N pipelines of the same kind share a source of requests. Each arrival is dispatched to one of the pipelines by a policy:
+/// 0 for round-robin, 1 for hashing on the destination, 2 for joining the shortest queue (JSQ) and 3 for subtree affinity.
+/// As the traces do not carry the destination addresses, the list of stages visited by a request (its path in the tree) is hashed instead.
+/// For subtree affinity, a request is dispatched by the stage at which its first step is performed, i.e., requests searching the same subtree share a pipeline.
+///
+/// Requests may complete out of order across the pipelines (and within a circular or random pipeline).
+/// A completion is counted as reordered if a later arrival has completed in an earlier time slot.
+///
+/// \param P scheduler of a single pipeline, i.e., LinSched, CirSched or RanSched
+template<typename P>
+class MultiSched{
+
+private:
+
+	size_t mSlotNum; ///< number of time slots in total
+
+	size_t mRequestNum; ///< number of requests
+
+	int mPolicy; ///< dispatch policy
+
+	std::vector<P*> mPipe; ///< pipelines
+
+	std::vector<size_t> mDispatchNum; ///< number of requests dispatched to each pipeline
+
+	std::vector<size_t> mFinishNum; ///< number of requests completed by each pipeline
+
+	size_t mNextPipe; ///< next pipeline for round-robin
+
+	size_t mReorderNum; ///< number of completions out of order
+
+	size_t mMaxSeq; ///< maximum seq of the requests completed in the previous time slots, plus one
+
+	size_t mMaxSeqCur; ///< maximum seq of the requests completed in current time slot, plus one
+
+	double mElapsed; ///< wall-clock time for the simulation, in seconds
+
+	SchedParam mParam; ///< parameters of current run
+
+	LatencyStat mLatencyStat; ///< latency of the completed requests
+
+	ReqSource mSource; ///< source of requests
+
+public:
+
+	/// \brief structure of request
+	typedef SchedRequest Request;
+
+	/// \brief ctor
+	///
+	/// \param _pipeNum number of pipelines
+	/// \param _policy dispatch policy
+	MultiSched(const int _pipeNum, const int _policy = 0) : mSlotNum(0), mRequestNum(0), mPolicy(_policy), mPipe(_pipeNum, nullptr), mDispatchNum(_pipeNum, 0), mFinishNum(_pipeNum, 0),
+		mNextPipe(0), mReorderNum(0), mMaxSeq(0), mMaxSeqCur(0), mElapsed(0) {
+
+		assert(_pipeNum > 0);
+
+		for (auto& pipe : mPipe) {
+
+			pipe = new P();
+		}
+	}
+
+	/// \brief dtor
+	~MultiSched() {
+
+		for (auto pipe : mPipe) {
+
+			delete pipe;
+		}
+	}
+
+	/// \brief number of pipelines
+	int getPipeNum() const {
+
+		return static_cast<int>(mPipe.size());
+	}
+
+	/// \brief get a pipeline
+	const P& getPipe(const int _i) const {
+
+		return *mPipe[_i];
+	}
+
+	/// \brief check if no request is in the pipelines or held at the source
+	bool isIdle() const {
+
+		for (auto pipe : mPipe) {
+
+			if (!pipe->isIdle()) return false;
+		}
+
+		return mSource.isIdle();
+	}
+
+	/// \brief choose a pipeline for a request by the dispatch policy
+	size_t choose(const Request* _req) const {
+
+		const size_t pipeNum = mPipe.size();
+
+		switch (mPolicy) {
+
+		case 1: { // hash on the destination, FNV-1a over the stage list
+
+			uint32 hash = 2166136261u;
+
+			for (int i = 0; i < _req->stepnum; ++i) {
+
+				hash = (hash ^ static_cast<uint32>(_req->stagelist[i])) * 16777619u;
+			}
+
+			return hash % pipeNum;
+		}
+
+		case 2: { // join the shortest queue, the lowest index wins a tie
+
+			size_t best = 0;
+
+			for (size_t i = 1; i < pipeNum; ++i) {
+
+				if (mPipe[i]->getPendingNum() < mPipe[best]->getPendingNum()) best = i;
+			}
+
+			return best;
+		}
+
+		case 3: // subtree affinity
+
+			return (_req->stagelist[0] / mParam.banknum) % pipeNum;
+
+		default: // round-robin
+
+			return mNextPipe;
+		}
+	}
+
+	/// \brief dispatch a request to the pipeline chosen by the policy
+	///
+	/// \return false if the queue of the chosen pipeline is full, in which case the request is not dispatched
+	bool admit(Request* _req) {
+
+		size_t i = choose(_req);
+
+		if (!mPipe[i]->admit(_req)) return false;
+
+		mDispatchNum[i]++;
+
+		if (0 == mPolicy) mNextPipe = (mNextPipe + 1) % mPipe.size();
+
+		return true;
+	}
+
+	/// \brief a run of executing search requests
+	void searchRun(const std::string& _traceFile, const SchedParam& _param = SchedParam()) {
+
+		TraceBuffer trace;
+
+		trace.load(_traceFile);
+
+		searchRun(trace, _param);
+
+		return;
+	}
+
+	/// \brief a run of executing search requests on the traces in memory
+	///
+	/// All the pipelines step through the same time slots. In event-driven mode, the idle slots are skipped.
+	///
+	/// \param _trace traces, which can be shared by concurrent runs
+	/// \param _param parameters of the run
+	void searchRun(const TraceBuffer& _trace, const SchedParam& _param = SchedParam()) {
+
+		// step 1: prepare
+		mParam = _param;
+
+		mRequestNum = _trace.size();
+
+		mSource = ReqSource(mParam.queuepolicy);
+
+		mDispatchNum.assign(mPipe.size(), 0);
+
+		mFinishNum.assign(mPipe.size(), 0);
+
+		mNextPipe = 0;
+
+		mReorderNum = 0;
+
+		mMaxSeq = 0;
+
+		mMaxSeqCur = 0;
+
+		mLatencyStat = LatencyStat();
+
+		// also clears the busy slots and the queue lengths of the pipelines
+		for (auto pipe : mPipe) {
+
+			pipe->prepare(mParam);
+		}
+
+		auto admitReq = [this](Request* _req) { return admit(_req); };
+
+		// step 2: scheduling
+		ArrivalGen arrival(mParam);
+
+		// start simulation
+		auto start = std::chrono::steady_clock::now();
+
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("MultiSched", {static_cast<long long>(mPipe.size())}, "searchRun"));
+
+		counter.start();
+
+		ReqPool pool;
+
+		size_t nextReq = 0; // index of next arrival in the trace
+
+		mSlotNum = 0;
+
+		while (nextReq < mRequestNum || !isIdle()) {
+
+			// nothing happens until next arrival, statistics of the skipped slots are all zeros
+			if (mParam.eventDriven && isIdle()) mSlotNum = arrival.getNextArrival() - 1;
+
+			mSlotNum++;
+
+			for (auto pipe : mPipe) {
+
+				pipe->advanceTo(mSlotNum);
+			}
+
+			// requests held at the source go first
+			mSource.retry(admitReq);
+
+			size_t arrivalNum = std::min(arrival.arrive(mSlotNum), mRequestNum - nextReq); // number of packets arriving in current slot, up to the requests left
+
+			for (size_t i = 0; i < arrivalNum; ++i) {
+
+				if (nextReq < mRequestNum) {
+
+					Request* newReq = pool.acquire(_trace, nextReq++, mSlotNum);
+
+					if (0 == newReq->stepnum) { // no need to be further processed
+
+						pool.release(newReq);
+					}
+					else {
+
+						mSource.offer(newReq, mSlotNum, pool, admitReq);
+					}
+				}
+			}
+
+			// run the pipelines
+			for (size_t i = 0; i < mPipe.size(); ++i) {
+
+				mPipe[i]->step(pool, [this, i](Request* _req) {
+
+					mFinishNum[i]++;
+
+					mLatencyStat.record(_req);
+
+					if (_req->seq + 1 < mMaxSeq) mReorderNum++;
+
+					if (_req->seq + 1 > mMaxSeqCur) mMaxSeqCur = _req->seq + 1;
+				});
+			}
+
+			mMaxSeq = mMaxSeqCur;
+		}
+
+		mElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		counter.stop(mRequestNum);
+
+		if (mParam.report) searchReport();
+
+		return;
+	}
+
+	/// \brief latency of the completed requests, over all the pipelines
+	const LatencyStat& getLatencyStat() const {
+
+		return mLatencyStat;
+	}
+
+	/// \brief number of time slots in total
+	size_t getSlotNum() const {
+
+		return mSlotNum;
+	}
+
+	/// \brief number of completed requests, over all the pipelines
+	size_t getFinishNum() const {
+
+		size_t finishNum = 0;
+
+		for (auto num : mFinishNum) {
+
+			finishNum += num;
+		}
+
+		return finishNum;
+	}
+
+	/// \brief number of completed requests per slot, over all the pipelines
+	double getThroughput() const {
+
+		return static_cast<double>(getFinishNum()) / mSlotNum;
+	}
+
+	/// \brief maximum over mean of the numbers of requests dispatched to the pipelines, 1 for a perfect balance
+	double getImbalance() const {
+
+		size_t maxNum = *std::max_element(mDispatchNum.begin(), mDispatchNum.end());
+
+		size_t sumNum = 0;
+
+		for (auto num : mDispatchNum) {
+
+			sumNum += num;
+		}
+
+		return 0 == sumNum ? 1.0 : static_cast<double>(maxNum) * mDispatchNum.size() / sumNum;
+	}
+
+	/// \brief number of completions out of order
+	size_t getReorderNum() const {
+
+		return mReorderNum;
+	}
+
+	/// \brief statistics of drop and blocking
+	const ReqSource& getSource() const {
+
+		return mSource;
+	}
+
+	/// \brief print search report
+	void searchReport() {
+
+		std::cerr << "lamda: " << mParam.lambda << std::endl;
+
+		std::cerr << "burst size: " << mParam.burstsize << std::endl;
+
+		ArrivalGen::reportProcess(mParam);
+
+		std::cerr << "queue size: " << mParam.queuesize << std::endl;
+
+		std::cerr << "pipeline num: " << mPipe.size() << std::endl;
+
+		switch (mPolicy) {
+
+		case 1: std::cerr << "dispatch policy: hash on destination" << std::endl; break;
+
+		case 2: std::cerr << "dispatch policy: join the shortest queue" << std::endl; break;
+
+		case 3: std::cerr << "dispatch policy: subtree affinity" << std::endl; break;
+
+		default: std::cerr << "dispatch policy: round-robin" << std::endl;
+		}
+
+		std::cerr << "request num: " << mRequestNum << std::endl;
+
+		std::cerr << "slot num: " << mSlotNum << std::endl;
+
+		for (size_t i = 0; i < mPipe.size(); ++i) {
+
+			std::cerr << "pipeline " << i << "--dispatched: " << mDispatchNum[i] << " completed: " << mFinishNum[i] << " usage ratio: " << mPipe[i]->getUsageRatio()
+				<< " avg queue length (per slot): " << mPipe[i]->getAvgQueueLength() << std::endl;
+		}
+
+		std::cerr << "throughput (req/slot): " << getThroughput() << std::endl;
+
+		std::cerr << "imbalance (max/mean dispatched): " << getImbalance() << std::endl;
+
+		size_t finishNum = getFinishNum();
+
+		std::cerr << "reordered num: " << mReorderNum << " ratio: " << (0 == finishNum ? 0.0 : static_cast<double>(mReorderNum) / finishNum) << std::endl;
+
+		mSource.report(mSlotNum, mParam.lambda * mParam.burstsize);
+
+		mLatencyStat.report();
+
+		std::cerr << "simulation time (s): " << mElapsed << " speed (slots/s): " << mSlotNum / mElapsed << std::endl;
+
+		return;
+	}
+};
+
+
+#endif
@@ -15,21 +15,45 @@
 
 
 #include "../common/common.h"
+#include "schedutil.h"
+#include "arrivalgen.h"
 
 #include <string>
-#include <sstream>
+#include <chrono>
+#include <random>
 #include <queue>
+#include <vector>
+#include <numeric>
 
 /// \brief Schedule lookup requests in a random pipeline
 ///
 /// In a random pipeline, a search request jump over all the pipestages to perform the IP lookup task.
+/// During each time slot, a pipe stage serves one of the requests targeting it, chosen by the arbitration policy (the earliest arrival by default).
+/// Since later requests may finish first, the results are put back in order by a reorder buffer.
+/// The memory of a stage may be split into banks with multiple ports (see SchedParam), each bank then serves the earliest arrivals targeting it, one per port.
 ///
 /// \param W at most W search steps for a request
 /// \param K number of pipe stages
-/// \param S size of request queue 
-template<int W, int K, int S = QUEUESIZE>
+template<int W, int K>
 class RanSched{
 
+public:
+
+	/// \brief structure of a requeset
+	typedef SchedRequest Request;
+
+	/// \brief order of requests in a wait list, the one with the smallest priority value on the top
+	struct ServeLater{
+
+		bool operator()(const Request* _a, const Request* _b) const {
+
+			return _a->prio > _b->prio;
+		}
+	};
+
+	/// \brief requests targeting the same memory bank
+	typedef std::priority_queue<Request*, std::vector<Request*>, ServeLater> WaitList;
+
 private:
 
 	size_t mSlotNum;  // number of time slots in total
@@ -40,234 +64,415 @@ private:
 	
 	size_t mBusySlotNumAvg; // average number of busy time slots over all pipe stages
 
-	bool mIsUsed[K]; ///< a pipe stage is occupied during the time slot
-
-	int mMaxQueueLength; ///< maximum length of the request queue
+	size_t mMaxQueueLength; ///< maximum length of the request queue
 
 	double mAvgQueueLength; ///< average length of the request queue
 
-public:
+	size_t mQueueLength; ///< number of requests in the queue
 
-	/// \brief structure of a requeset
-	struct Request{
+	std::vector<Request*> mGranted; ///< requests served in current time slot
 
-		int stagelist[W]; ///< list of stages
+	int mGrantedNum; ///< number of requests served in current time slot
 
-		int stepnum; ///< number of steps
+	double mElapsed; ///< wall-clock time for the simulation, in seconds
 
-		int curstep; ///< current step (start numbering from 0)
+	SchedParam mParam; ///< parameters of current run
 
-		Request() : curstep (0) {}
+	LatencyStat mLatencyStat; ///< latency of the completed requests
 
-		int getTargetStage() {
+	std::vector<int> mActiveBank; ///< banks with a non-empty wait list, in no particular order
 
-			return stagelist[curstep];
-		}
+	int mActiveBankNum; ///< number of banks with a non-empty wait list
 
-		bool isFinished() {
+	size_t mDropNumStage[K]; ///< number of dropped requests, counted by their first target stages
 
-			return stepnum == curstep;
-		}
+	ReqSource mSource; ///< source of requests
 
-		void toNext() {
+	ReorderBuffer mReorder; ///< reorder buffer releasing the results in the order of admission
 
-			curstep++;
-		}
+	std::default_random_engine mGenerator; ///< random generator for the random arbitration
 
-	};
+	/// The request queue is indexed by target bank, one wait list per memory bank (banknum per pipe stage).
+	/// A request is in the wait list of its current target bank.
+	std::vector<WaitList> mWaitList;
 
-	/// \brief request queue
-	struct ReqQue {
+public:
 
-		std::vector<Request*> mData; ///< payload
-		
-		/// \brief check if queue is empty
-		bool isEmpty() {
+	/// \brief default ctor
+	RanSched() : mSlotNum(0), mRequestNum(0), mBusySlotNumAvg(0), mMaxQueueLength(0), mAvgQueueLength(0), mQueueLength(0), mGrantedNum(0), mElapsed(0), mActiveBankNum(0) {
+
+		for (int i = 0; i < K; ++i) {
 
-			return 0 == mData.size();
+			mBusySlotNumStage[i] = 0;
 		}
 
-		/// \brief check if queue is overflow
-		bool isOverflow() {
+		for (int i = 0; i < K; ++i) {
 
-			return S < mData.size();
+			mDropNumStage[i] = 0;
 		}
+	}		
+	
+	/// \brief check if queue is empty
+	bool isEmpty() const {
+
+		return 0 == mQueueLength;
+	}
+
+	/// \brief check if no request is in the queue or held at the source
+	bool isIdle() const {
+
+		return isEmpty() && mSource.isIdle();
+	}
+
+	/// \brief append a request to the queue unless the queue is full
+	///
+	/// \return false if the queue is full, in which case the request is not queued
+	bool admit(Request* _req) {
 
-		/// \brief append a request to the end of the queue
-		void append(Request* _req) {
+		if (0 != mParam.queuepolicy && mQueueLength >= static_cast<size_t>(mParam.queuesize)) {
 
-			mData.push_back(_req);
+			if (1 == mParam.queuepolicy) mDropNumStage[_req->getTargetStage() / mParam.banknum]++;
 
-			return;			
+			return false;
 		}
-	};
 
-	ReqQue mReqQue; ///< queue of requests
+		mReorder.admit(_req);
 
-	/// \brief default ctor
-	RanSched() : mSlotNum(0), mRequestNum(0), mBusySlotNumAvg(0), mMaxQueueLength(0), mAvgQueueLength(0) {
+		append(_req);
 
-		for (int i = 0; i < K; ++i) {
+		// collect max length of the queue
+		if (mQueueLength > mMaxQueueLength) {
 
-			mBusySlotNumStage[i] = 0;
+			mMaxQueueLength = mQueueLength;
 		}
 
-		for (int i = 0; i < K; ++i) {
+		return true;
+	}
+
+	/// \brief put a request into the wait list of its target bank
+	///
+	/// The priority of the request is given by the arbitration policy. 
+	/// For shortest remaining steps first, ties are broken by the order of arrival.
+	void wait(Request* _req) {
+
+		switch (mParam.arbitration) {
+
+		case 1: _req->prio = (static_cast<uint64>(_req->stepnum - _req->curstep) << 40) | _req->seq; break;
+
+		case 2: _req->prio = mGenerator(); break;
 
-			mIsUsed[i] = false;
+		default: _req->prio = _req->seq;
 		}
-	}		
-	
+
+		int targetBank = _req->getTargetStage();
+
+		if (mWaitList[targetBank].empty()) mActiveBank[mActiveBankNum++] = targetBank;
+
+		mWaitList[targetBank].push(_req);
+
+		return;
+	}
+
+	/// \brief append a request to the queue
+	void append(Request* _req) {
+
+		wait(_req);
+
+		++mQueueLength;
+
+		return;
+	}
+
 	/// \brief execute a search request on each pipe stage
+	///
+	/// Each bank serves up to portnum heads of its wait list, which are exactly the requests picked by a scan over the whole queue by the arbitration policy.
+	/// Only the banks with waiting requests are visited, and each grant pops a priority queue, thus the cost is at most O(K * banknum * portnum * log Q) for a queue of length Q.
+	/// Requests targeting different banks of a stage never conflict.
 	void execute() {
-	
-		// reset status of each pipe stage to unused	
-		for (int i = 0; i < K; ++i) {
 
-			mIsUsed[i] = false;
-		}
+		mGrantedNum = 0;
 
-		for (int i = 0; i < mReqQue.mData.size(); ++i) {
+		for (int i = mActiveBankNum - 1; i >= 0; --i) {
 
-			int targetStage = mReqQue.mData[i]->getTargetStage();
+			int bank = mActiveBank[i];
 
-			if (false == mIsUsed[targetStage]) {
-		
-				// used 	
-				mIsUsed[targetStage] = true;
-		
-				mBusySlotNumStage[targetStage]++; 		
+			for (int j = 0; j < mParam.portnum && !mWaitList[bank].empty(); ++j) {
+
+				mGranted[mGrantedNum++] = mWaitList[bank].top();
 
-				// point to next target stage
-				mReqQue.mData[i]->toNext();
+				mWaitList[bank].pop();
+
+				mBusySlotNumStage[bank / mParam.banknum]++;
 			}
-		} 
+
+			if (mWaitList[bank].empty()) mActiveBank[i] = mActiveBank[--mActiveBankNum]; // the last one has been visited
+		}
+
+		// point to next target stage, after all the stages have made their choices
+		for (int i = 0; i < mGrantedNum; ++i) {
+
+			mGranted[i]->toNext();
+		}
+
+		return;
 	}
 
 	/// \brief dispatch requests from the queue after finishing the search task
-	void dispatch() {
-	
-		int initialSize = mReqQue.mData.size();
-	
-		for (int i = initialSize - 1; i >= 0; --i) {
+	///
+	/// Unfinished requests served in current slot are moved to the wait lists of their next target stages.
+	///
+	/// \param _pool pool to which completed requests are released
+	/// \param _onFinish called for each completed request before it is released
+	template<typename F>
+	void dispatch(ReqPool& _pool, F _onFinish) {
+
+		for (int i = 0; i < mGrantedNum; ++i) {
 
-			if (mReqQue.mData[i]->isFinished()) {
+			if (mGranted[i]->isFinished()) {
 
-				delete mReqQue.mData[i];
+				mGranted[i]->finishSlot = mSlotNum;
 
-				mReqQue.mData[i] = nullptr;
+				mLatencyStat.record(mGranted[i]);
 
-				mReqQue.mData.erase(mReqQue.mData.begin() + i);
+				mReorder.complete(mGranted[i]);
+
+				_onFinish(mGranted[i]);
+
+				_pool.release(mGranted[i]);
+
+				--mQueueLength;
+			}
+			else {
+
+				wait(mGranted[i]);
 			}
 		}
 
+		mGrantedNum = 0;
+
 		return;
 	}
 
-	/// \brief a run of executing search requests
-	void searchRun(const std::string& _traceFile) {
+	/// \brief number of requests in the queue
+	size_t getPendingNum() const {
+
+		return mQueueLength;
+	}
+
+	/// \brief get ready for a run, with the statistics of the previous run cleared
+	void prepare(const SchedParam& _param) {
 
-		// step 1: count number of traces
-		std::ifstream fin(_traceFile, std::ios_base::binary);
+		assert(_param.portnum >= 1 && _param.banknum >= 1);
 
-		std::string line;
+		mParam = _param;
 
-		size_t linenum = 0;
+		mWaitList = std::vector<WaitList>(K * mParam.banknum);
 
-		while (getline(fin, line)) linenum++;
+		mActiveBank.assign(K * mParam.banknum, 0);
 
-		fin.close();	
+		mActiveBankNum = 0;
 
-		mRequestNum = linenum;
+		mGranted.assign(K * mParam.banknum * mParam.portnum, nullptr);
 
+		mGenerator.seed(0 != mParam.seed ? mParam.seed : std::chrono::system_clock::now().time_since_epoch().count());
+
+		mSource = ReqSource(mParam.queuepolicy);
+
+		mReorder = ReorderBuffer();
+
+		mLatencyStat = LatencyStat();
+
+		for (int i = 0; i < K; ++i) {
+
+			mBusySlotNumStage[i] = 0;
+
+			mDropNumStage[i] = 0;
+		}
+
+		mMaxQueueLength = 0;
+
+		mAvgQueueLength = 0;
+
+		return;
+	}
+
+	/// \brief set current time slot
+	void advanceTo(const size_t _slot) {
+
+		mSlotNum = _slot;
+
+		return;
+	}
+
+	/// \brief run current time slot
+	///
+	/// \param _pool pool to which completed requests are released
+	/// \param _onFinish called for each completed request before it is released
+	template<typename F>
+	void step(ReqPool& _pool, F _onFinish) {
+
+		// collect avg length of the requets queue
+		mAvgQueueLength += mQueueLength;
+
+		// scheduling and executes a search step
+		execute();
 		
-		// step 2: scheduling
-		// packet arrivals submit to bernoulli distribution
-		unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+		// dispatch requests that are finished
+		dispatch(_pool, _onFinish);
 
-		std::default_random_engine generator(seed);
-	
-		std::bernoulli_distribution distribution(LAMBDA); // LAMBDA is a consexpr
+		return;
+	}
 
-		auto genreq = std::bind(distribution, generator);
+	/// \brief a run of executing search requests
+	void searchRun(const std::string& _traceFile, const SchedParam& _param = SchedParam()) {
+
+		TraceBuffer trace;
+
+		trace.load(_traceFile);
+
+		searchRun(trace, _param);
+
+		return;
+	}
+
+	/// \brief a run of executing search requests on the traces in memory
+	///
+	/// In event-driven mode, the slot of next arrival is drawn from a geometric distribution and the idle slots are skipped.
+	///
+	/// \param _trace traces, which can be shared by concurrent runs
+	/// \param _param parameters of the run
+	void searchRun(const TraceBuffer& _trace, const SchedParam& _param = SchedParam()) {
+
+		// step 1: prepare
+		prepare(_param);
+
+		mRequestNum = _trace.size();
+		
+		auto admitReq = [this](Request* _req) { return admit(_req); };
+
+		// step 2: scheduling
+		ArrivalGen arrival(mParam);
 	
 		// start simulation
-		std::ifstream fin2(_traceFile, std::ios_base::binary);
+		auto start = std::chrono::steady_clock::now();
+
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("RanSched", {W, K}, "searchRun"));
+
+		counter.start();
+
+		ReqPool pool;
 
-		std::string line2;
+		size_t nextReq = 0; // index of next arrival in the trace
 
 		mSlotNum = 0; 
 
-		while (linenum > 0 || !mReqQue.isEmpty()) {
+		while (nextReq < mRequestNum || !isIdle()) {
 
-			mSlotNum++;
+			// nothing happens until next arrival, statistics of the skipped slots are all zeros
+			if (mParam.eventDriven && isIdle()) mSlotNum = arrival.getNextArrival() - 1;
+
+			advanceTo(mSlotNum + 1);
+
+			// requests held at the source go first
+			mSource.retry(admitReq);
 		
 			// generate requests
-			if (genreq()) { 
+			size_t arrivalNum = std::min(arrival.arrive(mSlotNum), mRequestNum - nextReq); // number of packets arriving in current slot, up to the requests left
 
-				for (int i = 0; i < BURSTSIZE; ++i) {
+			for (size_t i = 0; i < arrivalNum; ++i) {
 
-					if (linenum > 0) {
+				if (nextReq < mRequestNum) {
 
-						// generate a request and insert into the queue
-						getline(fin2, line2);
+					// generate a request and insert into the queue
+					Request* newReq = pool.acquire(_trace, nextReq++, mSlotNum);
 
-						std::stringstream ss(line2);
+					if (0 == newReq->stepnum) {
+						
+						pool.release(newReq);
+					}
+					else {
+				
+						mSource.offer(newReq, mSlotNum, pool, admitReq);
+					}
+				}
+			}	
 
-						Request* newReq = new Request();
+			step(pool, [](Request*) {});
+		}
 
-						ss >> newReq->stepnum;
+		mElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-						for (int j = 0; j < newReq->stepnum; ++j) {
+		counter.stop(mRequestNum);
 
-							ss >> newReq->stagelist[j];
-						}						
+		if (mParam.report) searchReport();
+	}
 
-//						std::cerr << "queue size: " << mReqQue.mData.size() << std::endl;
+	
+	/// \brief latency of the completed requests
+	const LatencyStat& getLatencyStat() const {
 
-						if (0 == newReq->stepnum) {
-							
-							delete newReq;
-						}
-						else {
-					
-							mReqQue.append(newReq);
+		return mLatencyStat;
+	}
 
-							// collect max length of the queue
-							if (mReqQue.mData.size() > mMaxQueueLength) {
-	
-								mMaxQueueLength = mReqQue.mData.size();
-							}
-						}
+	/// \brief number of time slots in total
+	size_t getSlotNum() const {
 
-	
-						--linenum;
-					}
-				}	
-			}
+		return mSlotNum;
+	}
 
-			// collect avg length of the requets queue
-			mAvgQueueLength += mReqQue.mData.size();
+	/// \brief busy slots over total slots, averaged over all pipe stages
+	///
+	/// With multiple ports or banks, busy slots are counted in memory accesses and the capacity of a stage is portnum * banknum accesses per slot.
+	double getUsageRatio() const {
 
-			// scheduling and executes a search step
-			execute();
-			
-			// dispatch requests that are finished
-			dispatch();
-		}
+		return std::accumulate(mBusySlotNumStage, mBusySlotNumStage + K, 0.0) / K / mSlotNum / (mParam.portnum * mParam.banknum);
+	}
+
+	/// \brief average length of the request queue (per slot)
+	double getAvgQueueLength() const {
 
-		searchReport();
+		return mAvgQueueLength / mSlotNum;
+	}
+
+	/// \brief maximum length of the request queue
+	size_t getMaxQueueLength() const {
+
+		return mMaxQueueLength;
+	}
+
+	/// \brief statistics of drop and blocking
+	const ReqSource& getSource() const {
+
+		return mSource;
+	}
+
+	/// \brief statistics of putting the results back in order
+	const ReorderBuffer& getReorderBuffer() const {
+
+		return mReorder;
 	}
 
-	
 	/// \brief print search report
 	void searchReport() {
 
-		std::cerr << "lamda: " << LAMBDA << std::endl;
+		std::cerr << "lamda: " << mParam.lambda << std::endl;
+
+		std::cerr << "burst size: " << mParam.burstsize << std::endl;
 
-		std::cerr << "burst size: " << BURSTSIZE << std::endl;
+		ArrivalGen::reportProcess(mParam);
 
-		std::cerr << "queue size: " << QUEUESIZE << std::endl; 
+		std::cerr << "queue size: " << mParam.queuesize << std::endl; 
+
+		std::cerr << "memory per stage: " << mParam.banknum << " bank(s) of " << mParam.portnum << " port(s)" << std::endl;
+
+		switch (mParam.arbitration) {
+
+		case 1: std::cerr << "arbitration: shortest remaining steps first" << std::endl; break;
+
+		case 2: std::cerr << "arbitration: random" << std::endl; break;
+
+		default: std::cerr << "arbitration: oldest first" << std::endl;
+		}
 
 		std::cerr << "request num: " << mRequestNum << std::endl;
 
@@ -286,11 +491,27 @@ public:
 
 		std::cerr << "busy slot num in average (per stage): " << mBusySlotNumAvg << std::endl;
 
-		std::cerr << "usage ratio: (busy slot/ total slot): " << static_cast<double>(mBusySlotNumAvg) / mSlotNum << std::endl;
+		std::cerr << "usage ratio: (busy slot/ total slot): " << static_cast<double>(mBusySlotNumAvg) / mSlotNum / (mParam.portnum * mParam.banknum) << std::endl;
 
 		std::cerr << "max queue length: " << mMaxQueueLength << std::endl;
 
 		std::cerr << "avg queue length (per slot): " << mAvgQueueLength / mSlotNum << std::endl;
+
+		mSource.report(mSlotNum, mParam.lambda * mParam.burstsize);
+
+		mLatencyStat.report();
+
+		mReorder.report();
+
+		if (1 == mParam.queuepolicy) {
+
+			for (int i = 0; i < K; ++i) {
+
+				std::cerr << "drop num for stage " << i << ": " << mDropNumStage[i] << std::endl;
+			}
+		}
+
+		std::cerr << "simulation time (s): " << mElapsed << " speed (slots/s): " << mSlotNum / mElapsed << std::endl;
 	}
 };
 
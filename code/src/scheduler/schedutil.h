@@ -0,0 +1,834 @@
+#ifndef SCHEDUTIL_H
+#define SCHEDUTIL_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file schedutil.h
+/// \brief Building blocks shared by the schedulers.
+///
+/// Parameters of a run, a trace buffer holding all the lookup traces, a pool of requests, a ring-buffer queue,
+/// the source of requests applying the policy for full queues, the latency histograms and a reorder buffer.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+#include "../common/perfcounter.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+
+/// \brief parameters of a scheduling run
+///
+/// The defaults are given in common.h.
+struct SchedParam{
+
+	double lambda; ///< packet arriving probability per time slot, in (0, 1]
+
+	int burstsize; ///< number of packets arriving at the same time
+
+	int queuesize; ///< size of a request queue
+
+	int queuepolicy; ///< 0: unbounded queues, 1: tail drop on a full queue, 2: backpressure, hold arrivals at the source while the queue is full
+
+	bool eventDriven; ///< jump over the idle slots instead of stepping each of them
+
+	bool report; ///< print the search report after a run
+
+	int portnum; ///< number of ports of a memory bank, i.e., accesses served by a bank per time slot
+
+	int banknum; ///< number of memory banks per pipe stage, the traces give stage * banknum + bank for each step
+
+	int arbitration; ///< policy for the requests contending for a stage in a random pipeline, 0: oldest first, 1: shortest remaining steps first, 2: random
+
+	int arrival; ///< arrival process, 0: Bernoulli, 1: on-off, 2: Pareto bursts, 3: replay of timestamps (see ArrivalGen)
+
+	double meanon; ///< mean number of slots in the on state of the on-off process
+
+	double meanoff; ///< mean number of slots in the off state of the on-off process
+
+	double paretoshape; ///< shape of the Pareto distribution of burst sizes, greater than 1
+
+	std::string arrivalfile; ///< file of timestamps to be replayed
+
+	double slottime; ///< duration of a time slot in seconds for replay, 0 for scaling the timestamps to the rate lambda * burstsize
+
+	unsigned seed; ///< seed of the random generators, 0 for a seed taken from the clock
+
+	SchedParam() : lambda(LAMBDA), burstsize(BURSTSIZE), queuesize(QUEUESIZE), queuepolicy(0), eventDriven(false), report(true), portnum(1), banknum(1), arbitration(0),
+		arrival(0), meanon(100), meanoff(100), paretoshape(1.5), slottime(0), seed(0) {}
+};
+
+
+/// \brief lookup traces loaded into memory
+///
+/// Each line of a trace file is "stepnum stage_0 stage_1 ... stage_{stepnum-1}".
+/// Stage lists of all the traces are stored back to back in a flat array.
+class TraceBuffer{
+
+private:
+
+	std::vector<int> mStages; ///< stage lists of all traces
+
+	std::vector<size_t> mOffset; ///< offset of the i-th stage list in mStages, mOffset[size()] == mStages.size()
+
+public:
+
+	/// \brief ctor
+	TraceBuffer() : mOffset(1, 0) {}
+
+	/// \brief load traces from a file
+	void load(const std::string& _traceFile) {
+
+		mStages.clear();
+
+		mOffset.assign(1, 0);
+
+		std::ifstream fin(_traceFile, std::ios_base::binary);
+
+		std::string line;
+
+		while (getline(fin, line)) {
+
+			const char* p = line.c_str();
+
+			char* end = nullptr;
+
+			long stepnum = strtol(p, &end, 10);
+
+			p = end;
+
+			for (long i = 0; i < stepnum; ++i) {
+
+				mStages.push_back(static_cast<int>(strtol(p, &end, 10)));
+
+				p = end;
+			}
+
+			mOffset.push_back(mStages.size());
+		}
+
+		return;
+	}
+
+	/// \brief number of traces
+	size_t size() const {
+
+		return mOffset.size() - 1;
+	}
+
+	/// \brief number of steps in the i-th trace
+	int getStepNum(const size_t _idx) const {
+
+		return static_cast<int>(mOffset[_idx + 1] - mOffset[_idx]);
+	}
+
+	/// \brief stage list of the i-th trace
+	const int* getStageList(const size_t _idx) const {
+
+		return mStages.data() + mOffset[_idx];
+	}
+};
+
+
+/// \brief structure of a request
+///
+/// The stage list points into a TraceBuffer, which must outlive the request.
+struct SchedRequest{
+
+	const int* stagelist; ///< list of stages to be visited
+
+	int stepnum; ///< number of steps
+
+	int curstep; ///< current step (start numbering from 0)
+
+	size_t seq; ///< arrival order, a smaller value means an earlier arrival
+
+	size_t arriveSlot; ///< time slot in which the request arrives
+
+	size_t finishSlot; ///< time slot in which the last step is done
+
+	uint64 prio; ///< priority in the arbitration of a stage, a smaller value is served first
+
+	size_t order; ///< order of admission, given by the reorder buffer
+
+	SchedRequest() : stagelist(nullptr), stepnum(0), curstep(0), seq(0), arriveSlot(0), finishSlot(0), prio(0), order(0) {}
+
+	/// \brief target stage of current step
+	int getTargetStage() const {
+
+		return stagelist[curstep];
+	}
+
+	/// \brief check if all the steps are done
+	bool isFinished() const {
+
+		return stepnum == curstep;
+	}
+
+	/// \brief one step further
+	void toNext() {
+
+		curstep++;
+	}
+};
+
+
+/// \brief pool of requests
+///
+/// Released requests are recycled, thus no memory is allocated once the pool has warmed up.
+class ReqPool{
+
+private:
+
+	std::deque<SchedRequest> mStorage; ///< payload, a deque never moves existing elements when growing
+
+	std::vector<SchedRequest*> mFree; ///< released requests
+
+public:
+
+	/// \brief get a request for the i-th trace in the buffer
+	///
+	/// \param _trace traces
+	/// \param _idx index of the trace
+	/// \param _slot time slot of arrival
+	SchedRequest* acquire(const TraceBuffer& _trace, const size_t _idx, const size_t _slot) {
+
+		SchedRequest* req = nullptr;
+
+		if (mFree.empty()) {
+
+			mStorage.push_back(SchedRequest());
+
+			req = &mStorage.back();
+		}
+		else {
+
+			req = mFree.back();
+
+			mFree.pop_back();
+		}
+
+		req->stagelist = _trace.getStageList(_idx);
+
+		req->stepnum = _trace.getStepNum(_idx);
+
+		req->curstep = 0;
+
+		req->seq = _idx; // traces arrive in order
+
+		req->arriveSlot = _slot;
+
+		req->finishSlot = 0;
+
+		return req;
+	}
+
+	/// \brief give a request back to the pool
+	void release(SchedRequest* _req) {
+
+		mFree.push_back(_req);
+
+		return;
+	}
+};
+
+
+/// \brief FIFO queue based on a ring buffer
+///
+/// The capacity is a power of two, starting from the size given in the ctor.
+/// A full buffer doubles its capacity, bounds on the queue length are enforced by the schedulers (see ReqSource).
+template<typename T>
+class RingQueue{
+
+private:
+
+	std::vector<T> mData; ///< payload
+
+	size_t mHead; ///< position of the head
+
+	size_t mSize; ///< number of elements
+
+	size_t mMask; ///< capacity - 1
+
+	/// \brief double the capacity, elements are rearranged to start from position 0
+	void grow() {
+
+		std::vector<T> data(mData.size() * 2);
+
+		for (size_t i = 0; i < mSize; ++i) {
+
+			data[i] = mData[(mHead + i) & mMask];
+		}
+
+		mData.swap(data);
+
+		mHead = 0;
+
+		mMask = mData.size() - 1;
+
+		return;
+	}
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _capacity initial capacity, rounded up to a power of two
+	RingQueue(const size_t _capacity = QUEUESIZE) : mHead(0), mSize(0) {
+
+		size_t capacity = 1;
+
+		while (capacity < _capacity) capacity <<= 1;
+
+		mData.resize(capacity);
+
+		mMask = capacity - 1;
+	}
+
+	/// \brief check if queue is empty
+	bool isEmpty() const {
+
+		return 0 == mSize;
+	}
+
+	/// \brief number of elements
+	size_t size() const {
+
+		return mSize;
+	}
+
+	/// \brief append an element to the end of the queue
+	void append(const T& _elem) {
+
+		if (mSize == mData.size()) grow();
+
+		mData[(mHead + mSize) & mMask] = _elem;
+
+		++mSize;
+
+		return;
+	}
+
+	/// \brief get the head of the queue
+	T& getHead() {
+
+		return mData[mHead];
+	}
+
+	/// \brief remove the head of the queue
+	void removeHead() {
+
+		mHead = (mHead + 1) & mMask;
+
+		--mSize;
+
+		return;
+	}
+
+	/// \brief the i-th element counted from the head
+	T& operator[](const size_t _idx) {
+
+		return mData[(mHead + _idx) & mMask];
+	}
+
+	/// \brief remove the elements satisfying a predicate, keeping the order of the rest
+	///
+	/// \param _pred called once per element, in order from the head
+	template<typename F>
+	void removeIf(F _pred) {
+
+		size_t kept = 0;
+
+		for (size_t i = 0; i < mSize; ++i) {
+
+			T& elem = mData[(mHead + i) & mMask];
+
+			if (!_pred(elem)) {
+
+				mData[(mHead + kept) & mMask] = elem;
+
+				++kept;
+			}
+		}
+
+		mSize = kept;
+
+		return;
+	}
+};
+
+
+
+/// \brief source of requests, which applies the policy for full queues
+///
+/// Arrivals are offered to the scheduler through an admission function, which returns false if the target queue is full.
+/// For tail drop, a rejected request is dropped.
+/// For backpressure, a rejected request is held at the source in a FIFO, so are the requests arriving after it.
+/// The held requests are offered again at the beginning of the next time slot.
+class ReqSource{
+
+private:
+
+	int mPolicy; ///< policy for full queues, see SchedParam::queuepolicy
+
+	RingQueue<SchedRequest*> mHeld; ///< requests held at the source
+
+	size_t mOfferedNum; ///< number of requests offered to the scheduler
+
+	size_t mLastOfferSlot; ///< time slot of the last arrival
+
+	size_t mDropNum; ///< number of requests dropped
+
+	size_t mBlockedNum; ///< number of requests finding a full queue on arrival
+
+	size_t mMaxHeldNum; ///< maximum number of requests held at the source
+
+	double mAvgHeldNum; ///< number of held requests accumulated over all time slots
+
+public:
+
+	/// \brief ctor
+	ReqSource(const int _policy = 0) : mPolicy(_policy), mOfferedNum(0), mLastOfferSlot(0), mDropNum(0), mBlockedNum(0), mMaxHeldNum(0), mAvgHeldNum(0) {}
+
+	/// \brief offer the held requests again, called once per time slot before new arrivals
+	template<typename F>
+	void retry(F _admit) {
+
+		while (!mHeld.isEmpty() && _admit(mHeld.getHead())) {
+
+			mHeld.removeHead();
+		}
+
+		mAvgHeldNum += mHeld.size();
+
+		return;
+	}
+
+	/// \brief offer a new arrival
+	///
+	/// \param _req request, with at least one step
+	/// \param _slot current time slot
+	/// \param _pool pool to which the dropped requests are released
+	/// \param _admit admission function of the scheduler
+	template<typename F>
+	void offer(SchedRequest* _req, const size_t _slot, ReqPool& _pool, F _admit) {
+
+		++mOfferedNum;
+
+		mLastOfferSlot = _slot;
+
+		switch (mPolicy) {
+
+		case 1: // tail drop
+
+			if (!_admit(_req)) {
+
+				++mBlockedNum;
+
+				++mDropNum;
+
+				_pool.release(_req);
+			}
+
+			break;
+
+		case 2: // backpressure, keep the order of arrivals
+
+			if (!mHeld.isEmpty() || !_admit(_req)) {
+
+				++mBlockedNum;
+
+				mHeld.append(_req);
+
+				if (mHeld.size() > mMaxHeldNum) mMaxHeldNum = mHeld.size();
+			}
+
+			break;
+
+		default: // unbounded
+
+			_admit(_req);
+		}
+
+		return;
+	}
+
+	/// \brief check if no request is held at the source
+	bool isIdle() const {
+
+		return mHeld.isEmpty();
+	}
+
+	/// \brief print statistics of the source
+	///
+	/// The measured offered load is taken over the slots up to the last arrival, whereas the carried load is over all the slots.
+	///
+	/// \param _slotnum number of time slots in total
+	/// \param _offeredLoad nominal offered load, lambda * burst size
+	void report(const size_t _slotnum, const double _offeredLoad) const {
+
+		switch (mPolicy) {
+
+		case 1: std::cerr << "queue policy: tail drop" << std::endl; break;
+
+		case 2: std::cerr << "queue policy: backpressure" << std::endl; break;
+
+		default: std::cerr << "queue policy: unbounded" << std::endl;
+		}
+
+		std::cerr << "offered load (req/slot): " << _offeredLoad << " measured: " << (0 == mLastOfferSlot ? 0.0 : static_cast<double>(mOfferedNum) / mLastOfferSlot) << std::endl;
+
+		std::cerr << "carried load (req/slot): " << static_cast<double>(mOfferedNum - mDropNum) / _slotnum << std::endl;
+
+		std::cerr << "drop num: " << mDropNum << " loss rate: " << (0 == mOfferedNum ? 0.0 : static_cast<double>(mDropNum) / mOfferedNum) << std::endl;
+
+		std::cerr << "blocking probability: " << (0 == mOfferedNum ? 0.0 : static_cast<double>(mBlockedNum) / mOfferedNum) << std::endl;
+
+		if (2 == mPolicy) {
+
+			std::cerr << "held at source--avg (per slot): " << mAvgHeldNum / _slotnum << " max: " << mMaxHeldNum << std::endl;
+		}
+
+		return;
+	}
+
+	/// \brief number of requests offered to the scheduler
+	size_t getOfferedNum() const {
+
+		return mOfferedNum;
+	}
+
+	/// \brief number of requests dropped
+	size_t getDropNum() const {
+
+		return mDropNum;
+	}
+
+	/// \brief dropped over offered
+	double getLossRate() const {
+
+		return 0 == mOfferedNum ? 0.0 : static_cast<double>(mDropNum) / mOfferedNum;
+	}
+
+	/// \brief probability that an arrival finds a full queue
+	double getBlockingProb() const {
+
+		return 0 == mOfferedNum ? 0.0 : static_cast<double>(mBlockedNum) / mOfferedNum;
+	}
+};
+
+
+
+/// \brief histogram of latencies in time slots
+///
+/// Buckets are log-linear as in an HDR histogram: values below 2^P are counted exactly, 
+/// larger values are counted in buckets keeping the P most significant bits, i.e., a relative error below 2^(1-P).
+/// Recording a value is O(1) in amortized sense and percentiles are computed by a scan over the buckets.
+class LatencyHist{
+
+private:
+
+	static const int P = 7; ///< bits of precision
+
+	static const uint64 SUB = static_cast<uint64>(1) << P; ///< number of exact buckets
+
+	static const uint64 HALF = SUB >> 1; ///< number of buckets for each power of two above SUB
+
+	std::vector<uint64> mCount; ///< count of each bucket
+
+	uint64 mTotal; ///< number of values
+
+	uint64 mMax; ///< maximum value
+
+	double mSum; ///< sum of values
+
+	/// \brief index of the bucket for a value
+	static size_t getBucket(const uint64 _value) {
+
+		if (_value < SUB) return static_cast<size_t>(_value);
+
+		int shift = 1;
+
+		while ((_value >> shift) >= SUB) ++shift;
+
+		return static_cast<size_t>(SUB + (shift - 1) * HALF + ((_value >> shift) - HALF));
+	}
+
+	/// \brief largest value in a bucket
+	static uint64 getUpperBound(const size_t _bucket) {
+
+		if (_bucket < SUB) return _bucket;
+
+		uint64 shift = (_bucket - SUB) / HALF + 1;
+
+		uint64 sub = (_bucket - SUB) % HALF + HALF;
+
+		return ((sub + 1) << shift) - 1;
+	}
+
+public:
+
+	/// \brief ctor
+	LatencyHist() : mCount(SUB, 0), mTotal(0), mMax(0), mSum(0) {}
+
+	/// \brief record a value
+	void record(const uint64 _value) {
+
+		size_t bucket = getBucket(_value);
+
+		if (bucket >= mCount.size()) mCount.resize(bucket + 1, 0);
+
+		mCount[bucket]++;
+
+		mTotal++;
+
+		mSum += _value;
+
+		if (_value > mMax) mMax = _value;
+
+		return;
+	}
+
+	/// \brief number of values
+	uint64 getTotal() const {
+
+		return mTotal;
+	}
+
+	/// \brief maximum value
+	uint64 getMax() const {
+
+		return mMax;
+	}
+
+	/// \brief mean value
+	double getMean() const {
+
+		return 0 == mTotal ? 0.0 : mSum / mTotal;
+	}
+
+	/// \brief the smallest value v such that a fraction _q of values are no larger than v, up to the precision of the buckets
+	uint64 getPercentile(const double _q) const {
+
+		if (0 == mTotal) return 0;
+
+		uint64 rank = static_cast<uint64>(std::ceil(_q * mTotal));
+
+		if (rank < 1) rank = 1;
+
+		uint64 accum = 0;
+
+		for (size_t i = 0; i < mCount.size(); ++i) {
+
+			accum += mCount[i];
+
+			if (accum >= rank) return std::min(getUpperBound(i), mMax);
+		}
+
+		return mMax;
+	}
+
+	/// \brief print mean, p50, p99, p99.9 and max
+	void report(const std::string& _name) const {
+
+		std::cerr << _name << " (slots)--mean: " << getMean() << " p50: " << getPercentile(0.5) << " p99: " << getPercentile(0.99) 
+			<< " p99.9: " << getPercentile(0.999) << " max: " << getMax() << std::endl;
+
+		return;
+	}
+};
+
+
+/// \brief latency of the completed requests
+///
+/// The latency of a request spans from its arrival to the completion of its last step, both inclusive.
+/// The service time is the number of steps, the rest of the latency is spent in waiting (in a queue, at the source or for a busy stage).
+class LatencyStat{
+
+private:
+
+	LatencyHist mLatency; ///< latency
+
+	LatencyHist mQueueing; ///< queueing delay
+
+	LatencyHist mService; ///< service time
+
+public:
+
+	/// \brief record a completed request
+	void record(const SchedRequest* _req) {
+
+		uint64 latency = _req->finishSlot - _req->arriveSlot + 1;
+
+		mLatency.record(latency);
+
+		mQueueing.record(latency - _req->stepnum);
+
+		mService.record(_req->stepnum);
+
+		return;
+	}
+
+	/// \brief record a request served without waiting, with its number of steps
+	void recordNoWait(const int _stepnum) {
+
+		mLatency.record(_stepnum);
+
+		mQueueing.record(0);
+
+		mService.record(_stepnum);
+
+		return;
+	}
+
+	/// \brief histogram of latency
+	const LatencyHist& getLatency() const {
+
+		return mLatency;
+	}
+
+	/// \brief histogram of queueing delay
+	const LatencyHist& getQueueing() const {
+
+		return mQueueing;
+	}
+
+	/// \brief histogram of service time
+	const LatencyHist& getService() const {
+
+		return mService;
+	}
+
+	/// \brief print all the histograms
+	void report() const {
+
+		mLatency.report("latency");
+
+		mQueueing.report("queueing delay");
+
+		mService.report("service time");
+
+		return;
+	}
+};
+
+
+/// \brief reorder buffer releasing the results in the order of admission
+///
+/// An entry is allocated when a request is admitted, and is released once the request and all the earlier ones are completed.
+/// The depth is the number of completed requests held in the buffer, sampled at each completion, which gives the size of the buffer.
+/// The extra latency is the time spent in the buffer, from the completion to the release.
+class ReorderBuffer{
+
+private:
+
+	/// \brief an entry of the buffer
+	struct Entry{
+
+		bool done; ///< the request is completed
+
+		size_t arriveSlot; ///< time slot in which the request arrives
+
+		size_t finishSlot; ///< time slot in which the request is completed
+
+		Entry(const size_t _arriveSlot) : done(false), arriveSlot(_arriveSlot), finishSlot(0) {}
+	};
+
+	std::deque<Entry> mEntries; ///< entries from the oldest request not yet released
+
+	size_t mBase; ///< order of the oldest request not yet released
+
+	size_t mHeldNum; ///< number of completed requests held in the buffer
+
+	LatencyHist mDepth; ///< number of completed requests held in the buffer
+
+	LatencyHist mExtraLatency; ///< slots from completion to release
+
+	LatencyHist mLatency; ///< latency including the time in the buffer
+
+public:
+
+	/// \brief ctor
+	ReorderBuffer() : mBase(0), mHeldNum(0) {}
+
+	/// \brief allocate an entry for an admitted request
+	void admit(SchedRequest* _req) {
+
+		_req->order = mBase + mEntries.size();
+
+		mEntries.push_back(Entry(_req->arriveSlot));
+
+		return;
+	}
+
+	/// \brief record a completed request and release the results in order
+	void complete(const SchedRequest* _req) {
+
+		Entry& entry = mEntries[_req->order - mBase];
+
+		entry.done = true;
+
+		entry.finishSlot = _req->finishSlot;
+
+		++mHeldNum;
+
+		mDepth.record(mHeldNum);
+
+		// release the completed requests from the oldest one, all in current slot
+		while (!mEntries.empty() && mEntries.front().done) {
+
+			mExtraLatency.record(_req->finishSlot - mEntries.front().finishSlot);
+
+			mLatency.record(_req->finishSlot - mEntries.front().arriveSlot + 1);
+
+			mEntries.pop_front();
+
+			++mBase;
+
+			--mHeldNum;
+		}
+
+		return;
+	}
+
+	/// \brief histogram of the number of completed requests held in the buffer
+	const LatencyHist& getDepth() const {
+
+		return mDepth;
+	}
+
+	/// \brief histogram of the slots from completion to release
+	const LatencyHist& getExtraLatency() const {
+
+		return mExtraLatency;
+	}
+
+	/// \brief histogram of latency including the time in the buffer
+	const LatencyHist& getLatency() const {
+
+		return mLatency;
+	}
+
+	/// \brief print all the histograms
+	void report() const {
+
+		std::cerr << "reorder buffer depth--mean: " << mDepth.getMean() << " p99: " << mDepth.getPercentile(0.99) << " p99.9: " << mDepth.getPercentile(0.999) 
+			<< " max: " << mDepth.getMax() << std::endl;
+
+		mExtraLatency.report("reorder delay");
+
+		mLatency.report("in-order latency");
+
+		return;
+	}
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "snapshot.h"
+
+int main(int argc, char** argv){
+
+	if (argc < 6) {
+
+		std::cerr << "This program takes at least five parameters:\n";
+
+		std::cerr << "The 1st parameter specifies the base table, e.g., converted from a bview by the analyzer.\n";
+
+		std::cerr << "The 2nd parameter specifies the address family, 0 for IPv4 and 1 for IPv6.\n";
+
+		std::cerr << "The 3rd parameter specifies the interval between snapshots, in seconds.\n";
+
+		std::cerr << "The 4th parameter specifies the prefix of the snapshot files, each one is suffixed by its time.\n";
+
+		std::cerr << "The remaining parameters specify the MRT update files.\n";
+
+		exit(0);
+	}
+
+	std::vector<std::string> files(argv + 5, argv + argc);
+
+	SnapshotGenerator generator(atoi(argv[2]));
+
+	generator.load(argv[1]);
+
+	generator.run(files, static_cast<uint32>(atoi(argv[3])), argv[4]);
+
+	return 0;
+}
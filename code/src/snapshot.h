@@ -0,0 +1,247 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file snapshot.h
+/// \brief Definition of the generator of RIB snapshots.
+///
+/// Replay the updates onto a base table and write the table as it stands at regular intervals.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "ingester.h"
+
+#include <set>
+#include <string>
+
+
+/// \brief Generate snapshots of a table over a day of updates.
+///
+/// The base table (e.g., converted from a bview by the analyzer) is loaded into an ordered set of prefixes,
+/// and the updates merged by the ingester are applied in the order of time, the same way as update() of the trees does,
+/// i.e., an announce inserts the prefix and a withdraw removes it, whatever the peer.
+/// A snapshot is written in the table format each time the updates pass a multiple of the interval,
+/// into a file named by the output prefix and the time of the snapshot, e.g., snap_1477972800.
+/// A snapshot at time t contains all the updates before t, and the last one is taken after all the updates.
+class SnapshotGenerator{
+
+private:
+
+	/// \brief a prefix, ordered by address and then length
+	struct PrefixKey{
+
+		uint64 hi; ///< first 64 bits of the address
+
+		uint64 lo; ///< last 64 bits of the address
+
+		uint8 length; ///< prefix length
+
+		bool operator< (const PrefixKey& _a) const {
+
+			if (hi != _a.hi) return hi < _a.hi;
+
+			if (lo != _a.lo) return lo < _a.lo;
+
+			return length < _a.length;
+		}
+	};
+
+	int mFamily; ///< 0 for IPv4 and 1 for IPv6
+
+	std::set<PrefixKey> mTable; ///< current table
+
+	size_t mAnnounceNum; ///< number of announces applied
+
+	size_t mWithdrawNum; ///< number of withdraws applied
+
+	size_t mMissNum; ///< number of withdraws of absent prefixes
+
+	size_t mSnapshotNum; ///< number of snapshots written
+
+	/// \brief make a key from an address in network order
+	static PrefixKey getKey(const uint8* _addr, const uint8 _length) {
+
+		PrefixKey key = {0, 0, _length};
+
+		for (int i = 0; i < 8; ++i) {
+
+			key.hi = (key.hi << 8) | _addr[i];
+
+			key.lo = (key.lo << 8) | _addr[i + 8];
+		}
+
+		return key;
+	}
+
+	/// \brief write the current table
+	void write(const std::string& _ofn) {
+
+		PrefixWriter writer;
+
+		writer.open(_ofn);
+
+		uint8 addr[16];
+
+		char prefix[BGPDUMP_ADDRSTRLEN];
+
+		for (auto& key : mTable) {
+
+			for (int i = 0; i < 8; ++i) {
+
+				addr[i] = static_cast<uint8>(key.hi >> (56 - 8 * i));
+
+				addr[i + 8] = static_cast<uint8>(key.lo >> (56 - 8 * i));
+			}
+
+			inet_ntop(0 == mFamily ? AF_INET : AF_INET6, addr, prefix, sizeof(prefix));
+
+			writer.writeLine(prefix, key.length, " BGPDUMP_TYPE_TABLE_DUMP_V2");
+		}
+
+		++mSnapshotNum;
+
+		std::cerr << "snapshot " << _ofn << "--prefix num: " << mTable.size() << " announce num: " << mAnnounceNum << " withdraw num: " << mWithdrawNum << std::endl;
+
+		return;
+	}
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _family 0 for IPv4 and 1 for IPv6
+	SnapshotGenerator(const int _family = 0) : mFamily(_family), mAnnounceNum(0), mWithdrawNum(0), mMissNum(0), mSnapshotNum(0) {}
+
+	/// \brief load the base table, in the table format ("prefix length ...")
+	void load(const std::string& _fn) {
+
+		std::ifstream fin(_fn, std::ios_base::binary);
+
+		if (!fin) {
+
+			std::cerr << "cannot open " << _fn << "\n";
+
+			exit(1);
+		}
+
+		std::string line;
+
+		uint8 addr[16];
+
+		while (getline(fin, line)) {
+
+			size_t pos1 = line.find_first_of(" ");
+
+			if (std::string::npos == pos1) continue;
+
+			memset(addr, 0, sizeof(addr));
+
+			if (1 != inet_pton(0 == mFamily ? AF_INET : AF_INET6, line.substr(0, pos1).c_str(), addr)) continue;
+
+			mTable.insert(getKey(addr, static_cast<uint8>(atoi(line.c_str() + pos1 + 1))));
+		}
+
+		std::cerr << "base table " << _fn << "--prefix num: " << mTable.size() << std::endl;
+
+		return;
+	}
+
+	/// \brief apply an update
+	void apply(const UpdateRecord& _record) {
+
+		if ((0 == mFamily ? AFI_IP : AFI_IP6) != _record.afi) return;
+
+		uint8 addr[16];
+
+		memset(addr, 0, sizeof(addr));
+
+		memcpy(addr, _record.addr, 0 == mFamily ? 4 : 16);
+
+		if (_record.announce) {
+
+			++mAnnounceNum;
+
+			mTable.insert(getKey(addr, _record.length));
+		}
+		else {
+
+			++mWithdrawNum;
+
+			if (0 == mTable.erase(getKey(addr, _record.length))) ++mMissNum;
+		}
+
+		return;
+	}
+
+	/// \brief apply the updates in MRT files and write the snapshots
+	///
+	/// \param _files MRT update files, see Ingester
+	/// \param _interval interval between snapshots, in seconds
+	/// \param _prefix prefix of the snapshot files
+	/// \param _start time of the first interval, or the time of the first update rounded down to the interval if 0
+	void run(const std::vector<std::string>& _files, const uint32 _interval, const std::string& _prefix, uint32 _start = 0) {
+
+		assert(_interval > 0);
+
+		Ingester ingester(_files);
+
+		ingester.parse();
+
+		bool first = true;
+
+		uint64 next = 0; // time of next snapshot
+
+		ingester.merge([&](const UpdateRecord& _record) {
+
+			if (first) {
+
+				if (0 == _start) _start = _record.time / _interval * _interval;
+
+				next = static_cast<uint64>(_start) + _interval;
+
+				first = false;
+			}
+
+			// the updates have reached next snapshot, possibly skipping several ones without any update
+			while (_record.time >= next) {
+
+				write(_prefix + "_" + std::to_string(next));
+
+				next += _interval;
+			}
+
+			apply(_record);
+		});
+
+		if (first) next = static_cast<uint64>(_start) + _interval;
+
+		write(_prefix + "_" + std::to_string(next));
+
+		ingester.report();
+
+		report();
+
+		return;
+	}
+
+	/// \brief number of prefixes in the current table
+	size_t getPrefixNum() const {
+
+		return mTable.size();
+	}
+
+	/// \brief print the numbers of updates applied
+	void report() const {
+
+		std::cerr << "snapshot num: " << mSnapshotNum << " announce num: " << mAnnounceNum << " withdraw num: " << mWithdrawNum
+			<< " withdraws of absent prefixes: " << mMissNum << std::endl;
+
+		return;
+	}
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "tablegen.h"
+
+int main(int argc, char** argv){
+
+	if (argc < 5) {
+
+		std::cerr << "This program takes at least four parameters:\n";
+
+		std::cerr << "The 1st parameter specifies the source table, e.g., converted from a bview by the analyzer.\n";
+
+		std::cerr << "The 2nd parameter specifies the address family, 0 for IPv4 and 1 for IPv6.\n";
+
+		std::cerr << "The 3rd parameter specifies the number of prefixes in the generated table.\n";
+
+		std::cerr << "The 4th parameter specifies the generated table, and the generated updates are written to it suffixed by _update.\n";
+
+		std::cerr << "The 5th parameter (optional) specifies the source updates replayed on the source table, - for none.\n";
+
+		std::cerr << "The 6th parameter (optional) specifies the number of generated updates, 0 by default for the number of source updates scaled as the table.\n";
+
+		std::cerr << "The 7th parameter (optional) specifies U, the number of bits indexed by the root tables, 10 by default.\n";
+
+		std::cerr << "The 8th parameter (optional) specifies the seed of the generator, 1 by default.\n";
+
+		exit(0);
+	}
+
+	int family = atoi(argv[2]);
+
+	size_t prefixNum = static_cast<size_t>(atoll(argv[3]));
+
+	std::string updateFile(argc > 5 ? argv[5] : "-");
+
+	size_t updateNum = argc > 6 ? static_cast<size_t>(atoll(argv[6])) : 0;
+
+	int u = argc > 7 ? atoi(argv[7]) : 10;
+
+	unsigned seed = argc > 8 ? static_cast<unsigned>(atoi(argv[8])) : 1;
+
+	TableGenerator generator(family, u, seed);
+
+	auto table = generator.learnTable(argv[1]);
+
+	generator.generateTable(prefixNum, argv[4]);
+
+	if ("-" != updateFile) {
+
+		generator.learnUpdates(updateFile, table);
+
+		if (0 == updateNum) updateNum = generator.getUpdateNum() * prefixNum / std::max(static_cast<size_t>(1), generator.getPrefixNum());
+
+		generator.generateUpdates(updateNum, std::string(argv[4]) + "_update");
+	}
+
+	return 0;
+}
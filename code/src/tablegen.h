@@ -0,0 +1,834 @@
+#ifndef _TABLEGEN_H
+#define _TABLEGEN_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file tablegen.h
+/// \brief Definition of the generator of synthetic tables and updates.
+///
+/// Learn the shape of a real table and generate statistically similar tables of any size, for scaling studies.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "common/common.h"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+#include <arpa/inet.h>
+#include <string.h>
+
+
+/// \brief Generate synthetic tables (and updates) resembling a real one.
+///
+/// The model learned from a table (in the format build() reads) consists of
+/// (1) the distribution of prefix lengths,
+/// (2) for each length, the fraction of the prefixes nested in a shorter prefix and the distribution of the length of the closest such prefix, and
+/// (3) the top-level prefixes (i.e., not nested) of each length, as templates of their first U bits, which gives the sizes of the subtrees
+/// rooted at each U-bit value, as indexed by the root tables of the trees.
+///
+/// A table of N prefixes is generated length by length, from the shortest. A prefix of length L is nested with the learned probability,
+/// extending a random generated prefix of a length drawn from the learned distribution by random bits.
+/// Otherwise, it copies the first min(U, L) bits of a random template of length L, followed by random bits, such that it is not covered by any generated prefix.
+/// If the copy collides, fewer bits are copied in each retry, so that the table can spread beyond the source when scaled up.
+///
+/// An update stream (in the format update() reads) is learned from real updates replayed on the source table, as the fractions of
+/// withdraws, withdraws of absent prefixes, announces of present prefixes (e.g., path changes) and announces of previously withdrawn prefixes.
+/// The stream is generated on the synthetic table the same way, with brand-new prefixes drawn from the table model.
+///
+/// Prefixes are kept as 128-bit values, with an IPv4 address in the first 32 bits.
+class TableGenerator{
+
+private:
+
+	/// \brief a prefix
+	struct Prefix{
+
+		uint64 hi; ///< first 64 bits
+
+		uint64 lo; ///< last 64 bits
+
+		uint8 length; ///< prefix length
+
+		bool operator== (const Prefix& _a) const {
+
+			return hi == _a.hi && lo == _a.lo && length == _a.length;
+		}
+
+		bool operator< (const Prefix& _a) const {
+
+			if (hi != _a.hi) return hi < _a.hi;
+
+			if (lo != _a.lo) return lo < _a.lo;
+
+			return length < _a.length;
+		}
+	};
+
+	/// \brief hash of a prefix
+	struct PrefixHash{
+
+		size_t operator()(const Prefix& _a) const {
+
+			uint64 h = _a.hi * 0x9e3779b97f4a7c15ull ^ (_a.lo + _a.length) * 0xc2b2ae3d27d4eb4full;
+
+			return static_cast<size_t>(h ^ (h >> 29));
+		}
+	};
+
+	typedef std::unordered_set<Prefix, PrefixHash> PrefixSet;
+
+	int mFamily; ///< 0 for IPv4 and 1 for IPv6
+
+	int mW; ///< 32 or 128
+
+	int mU; ///< number of bits indexed by the root tables
+
+	std::mt19937_64 mRng; ///< random number generator
+
+	// model of the table
+	size_t mPrefixNum; ///< number of prefixes in the source table
+
+	bool mHasDefault; ///< whether the source table contains */0
+
+	std::vector<size_t> mLengthNum; ///< number of prefixes of each length
+
+	std::vector<size_t> mNestedNum; ///< number of nested prefixes of each length
+
+	std::vector<std::vector<size_t> > mParentNum; ///< [length][length of the closest covering prefix], number of nested prefixes
+
+	std::vector<std::vector<Prefix> > mTemplates; ///< top-level prefixes of each length
+
+	// model of the updates
+	size_t mUpdateNum; ///< number of updates learned
+
+	double mWithdrawRatio; ///< withdraws over updates
+
+	double mWithdrawAbsentRatio; ///< withdraws of absent prefixes over withdraws
+
+	double mAnnouncePresentRatio; ///< announces of present prefixes over announces
+
+	double mReannounceRatio; ///< announces of previously withdrawn prefixes over announces of absent prefixes
+
+	// generated table
+	std::vector<std::vector<Prefix> > mGenerated; ///< generated prefixes of each length
+
+	PrefixSet mGeneratedSet; ///< generated prefixes
+
+	size_t mFailNum; ///< number of prefixes that could not be placed
+
+	/// \brief the first _length bits of a prefix
+	static Prefix mask(const Prefix& _a, const int _length) {
+
+		Prefix p = _a;
+
+		p.length = static_cast<uint8>(_length);
+
+		if (_length <= 0) { p.hi = 0; p.lo = 0; }
+		else if (_length < 64) { p.hi &= ~0ull << (64 - _length); p.lo = 0; }
+		else if (64 == _length) { p.lo = 0; }
+		else if (_length < 128) { p.lo &= ~0ull << (128 - _length); }
+
+		return p;
+	}
+
+	/// \brief randomize the bits [_beg, _end) of a prefix
+	void randomize(Prefix& _a, const int _beg, const int _end) {
+
+		if (_beg >= _end) return;
+
+		Prefix r = {mRng(), mRng(), 0};
+
+		Prefix keep = mask(_a, _beg); // bits before _beg
+
+		Prefix high = mask(r, _end); // random bits before _end
+
+		Prefix low = mask(r, _beg); // random bits before _beg, to be cleared
+
+		_a.hi = keep.hi | (high.hi & ~low.hi);
+
+		_a.lo = keep.lo | (high.lo & ~low.lo);
+
+		return;
+	}
+
+	/// \brief parse a line "prefix length ..." into a prefix
+	///
+	/// \return false if the line is not a prefix of the family
+	bool parse(const std::string& _line, Prefix& _p, std::string* _rest = nullptr) const {
+
+		size_t pos1 = _line.find_first_of(" ");
+
+		if (std::string::npos == pos1) return false;
+
+		uint8 addr[16];
+
+		memset(addr, 0, sizeof(addr));
+
+		if (1 != inet_pton(0 == mFamily ? AF_INET : AF_INET6, _line.substr(0, pos1).c_str(), addr)) return false;
+
+		int length = atoi(_line.c_str() + pos1 + 1);
+
+		if (length < 0 || length > mW) return false;
+
+		_p.hi = 0;
+
+		_p.lo = 0;
+
+		for (int i = 0; i < 8; ++i) {
+
+			_p.hi = (_p.hi << 8) | addr[i];
+
+			_p.lo = (_p.lo << 8) | addr[i + 8];
+		}
+
+		_p = mask(_p, length);
+
+		if (nullptr != _rest) {
+
+			size_t pos2 = _line.find_first_of(" ", pos1 + 1);
+
+			*_rest = std::string::npos == pos2 ? std::string() : _line.substr(pos2 + 1);
+		}
+
+		return true;
+	}
+
+	/// \brief format a prefix as "prefix length"
+	std::string format(const Prefix& _p) const {
+
+		uint8 addr[16];
+
+		for (int i = 0; i < 8; ++i) {
+
+			addr[i] = static_cast<uint8>(_p.hi >> (56 - 8 * i));
+
+			addr[i + 8] = static_cast<uint8>(_p.lo >> (56 - 8 * i));
+		}
+
+		char buf[INET6_ADDRSTRLEN];
+
+		inet_ntop(0 == mFamily ? AF_INET : AF_INET6, addr, buf, sizeof(buf));
+
+		return std::string(buf) + " " + std::to_string(_p.length);
+	}
+
+	/// \brief length of the closest prefix in a set covering _p, -1 if none
+	///
+	/// \param _depth set to the number of covering prefixes, if not nullptr
+	static int findParent(const PrefixSet& _set, const Prefix& _p, const std::vector<int>& _lengths, int* _depth = nullptr) {
+
+		int parent = -1;
+
+		if (nullptr != _depth) *_depth = 0;
+
+		for (int length : _lengths) { // in ascending order
+
+			if (length >= _p.length) break;
+
+			if (0 != _set.count(mask(_p, length))) {
+
+				parent = length;
+
+				if (nullptr == _depth) continue;
+
+				++*_depth;
+			}
+		}
+
+		return parent;
+	}
+
+	/// \brief lengths of the generated prefixes, in ascending order
+	std::vector<int> getGeneratedLengths() const {
+
+		std::vector<int> lengths;
+
+		for (int l = 0; l <= mW; ++l) {
+
+			if (!mGenerated[l].empty()) lengths.push_back(l);
+		}
+
+		return lengths;
+	}
+
+	/// \brief draw an index by weights
+	///
+	/// \param _sum sum of the weights, greater than 0
+	size_t draw(const std::vector<size_t>& _weights, const size_t _sum) {
+
+		assert(_sum > 0);
+
+		uint64 r = mRng() % _sum;
+
+		for (size_t i = 0; i < _weights.size(); ++i) {
+
+			if (r < _weights[i]) return i;
+
+			r -= _weights[i];
+		}
+
+		return _weights.size() - 1;
+	}
+
+	/// \brief generate a prefix of a length, not yet in the generated table
+	///
+	/// \param _lengths lengths of the generated prefixes, in ascending order
+	/// \return false if failed after retries
+	bool generatePrefix(const int _length, const std::vector<int>& _lengths, Prefix& _p) {
+
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+		// a nested prefix, extending a generated prefix of a length drawn from the model
+		if (0 != mLengthNum[_length] && uniform(mRng) * mLengthNum[_length] < mNestedNum[_length]) {
+
+			std::vector<size_t> weights(_length, 0);
+
+			size_t sum = 0;
+
+			for (int l = 0; l < _length; ++l) {
+
+				if (!mGenerated[l].empty()) weights[l] = mParentNum[_length][l];
+
+				sum += weights[l];
+			}
+
+			for (int retry = 0; sum > 0 && retry < 16; ++retry) {
+
+				int parentLength = static_cast<int>(draw(weights, sum));
+
+				const std::vector<Prefix>& parents = mGenerated[parentLength];
+
+				_p = parents[mRng() % parents.size()];
+
+				_p.length = static_cast<uint8>(_length);
+
+				randomize(_p, parentLength, _length);
+
+				if (0 == mGeneratedSet.count(_p)) return true;
+			}
+		}
+
+		// a top-level prefix, following a template of the same length
+		const std::vector<Prefix>& templates = mTemplates[_length];
+
+		int keep = std::min(mU, _length);
+
+		for (int retry = 0; retry < 64; ++retry) {
+
+			if (templates.empty()) {
+
+				_p = Prefix{1 == mFamily ? 0x2000000000000000ull : 0, 0, 0}; // all nested in the source
+
+				keep = 0;
+			}
+			else {
+
+				_p = templates[mRng() % templates.size()];
+			}
+
+			_p.length = static_cast<uint8>(_length);
+
+			int copied = std::max(0, keep - retry / 4);
+
+			if (1 == mFamily) copied = std::max(copied, std::min(3, _length)); // in 2000::/3 as the source
+
+			randomize(_p, copied, _length);
+
+			if (0 == mGeneratedSet.count(_p) && -1 == findParent(mGeneratedSet, _p, _lengths)) return true;
+		}
+
+		return false;
+	}
+
+	/// \brief add a generated prefix
+	void addGenerated(const Prefix& _p) {
+
+		mGenerated[_p.length].push_back(_p);
+
+		mGeneratedSet.insert(_p);
+
+		return;
+	}
+
+	/// \brief print the shape of a table
+	void reportShape(const std::string& _name, const std::vector<Prefix>& _table) const {
+
+		PrefixSet set(_table.begin(), _table.end());
+
+		std::vector<int> lengths;
+
+		std::vector<size_t> lengthNum(mW + 1, 0);
+
+		for (auto& p : _table) ++lengthNum[p.length];
+
+		for (int l = 0; l <= mW; ++l) {
+
+			if (0 != lengthNum[l]) lengths.push_back(l);
+		}
+
+		size_t nestedNum = 0, depthSum = 0, maxDepth = 0;
+
+		std::unordered_map<uint64, size_t> subtrees; // number of prefixes longer than U under each U-bit value
+
+		for (auto& p : _table) {
+
+			int depth;
+
+			if (-1 != findParent(set, p, lengths, &depth)) ++nestedNum;
+
+			depthSum += depth;
+
+			maxDepth = std::max(maxDepth, static_cast<size_t>(depth));
+
+			if (p.length > mU) ++subtrees[mask(p, mU).hi];
+		}
+
+		size_t maxSubtree = 0;
+
+		for (auto& s : subtrees) maxSubtree = std::max(maxSubtree, s.second);
+
+		double num = std::max(static_cast<size_t>(1), _table.size());
+
+		std::cerr << _name << "--prefix num: " << _table.size() << " nested: " << nestedNum / num << " average nesting depth: " << depthSum / num
+			<< " max nesting depth: " << maxDepth << " subtree num: " << subtrees.size() << " max subtree size: " << maxSubtree << std::endl;
+
+		std::cerr << "\tlength distribution (%):";
+
+		for (int l : lengths) std::cerr << " " << l << ":" << static_cast<int>(1000.0 * lengthNum[l] / num) / 10.0;
+
+		std::cerr << std::endl;
+
+		return;
+	}
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _family 0 for IPv4 and 1 for IPv6
+	/// \param _u number of bits indexed by the root tables, as U of the trees
+	/// \param _seed seed of the random number generator
+	TableGenerator(const int _family = 0, const int _u = 10, const unsigned _seed = 1) :
+		mFamily(_family), mW(0 == _family ? 32 : 128), mU(_u), mRng(_seed), mPrefixNum(0), mHasDefault(false),
+		mLengthNum(mW + 1, 0), mNestedNum(mW + 1, 0), mParentNum(mW + 1, std::vector<size_t>(mW + 1, 0)), mTemplates(mW + 1),
+		mUpdateNum(0), mWithdrawRatio(0), mWithdrawAbsentRatio(0), mAnnouncePresentRatio(0), mReannounceRatio(0),
+		mGenerated(mW + 1), mFailNum(0) {}
+
+	/// \brief learn the model of a table
+	///
+	/// \return prefixes of the table
+	std::vector<Prefix> learnTable(const std::string& _fn) {
+
+		std::ifstream fin(_fn, std::ios_base::binary);
+
+		if (!fin) {
+
+			std::cerr << "cannot open " << _fn << "\n";
+
+			exit(1);
+		}
+
+		std::string line;
+
+		Prefix p;
+
+		PrefixSet set;
+
+		std::vector<Prefix> table;
+
+		while (getline(fin, line)) {
+
+			if (!parse(line, p) || !set.insert(p).second) continue;
+
+			if (0 == p.length) {
+
+				mHasDefault = true;
+
+				continue;
+			}
+
+			table.push_back(p);
+		}
+
+		std::vector<int> lengths;
+
+		for (auto& q : table) ++mLengthNum[q.length];
+
+		for (int l = 0; l <= mW; ++l) {
+
+			if (0 != mLengthNum[l]) lengths.push_back(l);
+		}
+
+		for (auto& q : table) {
+
+			int parent = findParent(set, q, lengths);
+
+			if (-1 == parent) {
+
+				mTemplates[q.length].push_back(q);
+			}
+			else {
+
+				++mNestedNum[q.length];
+
+				++mParentNum[q.length][parent];
+			}
+		}
+
+		mPrefixNum = table.size();
+
+		reportShape("source " + _fn, table);
+
+		return table;
+	}
+
+	/// \brief learn the model of the updates replayed on a table
+	void learnUpdates(const std::string& _fn, const std::vector<Prefix>& _table) {
+
+		std::ifstream fin(_fn, std::ios_base::binary);
+
+		if (!fin) {
+
+			std::cerr << "cannot open " << _fn << "\n";
+
+			exit(1);
+		}
+
+		PrefixSet present(_table.begin(), _table.end());
+
+		PrefixSet withdrawn;
+
+		size_t withdrawNum = 0, withdrawAbsentNum = 0, announceNum = 0, announcePresentNum = 0, reannounceNum = 0;
+
+		std::string line, rest;
+
+		Prefix p;
+
+		while (getline(fin, line)) {
+
+			if (!parse(line, p, &rest) || 0 == p.length) continue;
+
+			if ('0' == rest[0]) { // withdraw
+
+				++withdrawNum;
+
+				if (0 == present.erase(p)) ++withdrawAbsentNum;
+				else withdrawn.insert(p);
+			}
+			else {
+
+				++announceNum;
+
+				if (0 != present.count(p)) {
+
+					++announcePresentNum;
+				}
+				else {
+
+					if (0 != withdrawn.erase(p)) ++reannounceNum;
+
+					present.insert(p);
+				}
+			}
+		}
+
+		mUpdateNum = withdrawNum + announceNum;
+
+		mWithdrawRatio = static_cast<double>(withdrawNum) / std::max(static_cast<size_t>(1), mUpdateNum);
+
+		mWithdrawAbsentRatio = static_cast<double>(withdrawAbsentNum) / std::max(static_cast<size_t>(1), withdrawNum);
+
+		mAnnouncePresentRatio = static_cast<double>(announcePresentNum) / std::max(static_cast<size_t>(1), announceNum);
+
+		mReannounceRatio = static_cast<double>(reannounceNum) / std::max(static_cast<size_t>(1), announceNum - announcePresentNum);
+
+		std::cerr << "source " << _fn << "--update num: " << mUpdateNum << " withdraws: " << mWithdrawRatio << " of which absent: " << mWithdrawAbsentRatio
+			<< " announces of present prefixes: " << mAnnouncePresentRatio << " reannounces of withdrawn prefixes: " << mReannounceRatio << std::endl;
+
+		return;
+	}
+
+	/// \brief generate a table of _num prefixes and write it in the table format
+	void generateTable(const size_t _num, const std::string& _ofn) {
+
+		for (auto& generated : mGenerated) generated.clear();
+
+		mGeneratedSet.clear();
+
+		mFailNum = 0;
+
+		// number of prefixes of each length, scaled by largest remainders,
+		// and a length running out of values is capped with the excess spread over the other lengths
+		std::vector<size_t> targets(mW + 1, 0);
+
+		std::vector<bool> capped(mW + 1, false);
+
+		std::vector<std::pair<double, int> > remainders;
+
+		size_t assigned = 0;
+
+		for (bool overflow = true; overflow; ) {
+
+			overflow = false;
+
+			size_t cappedNum = 0, weight = 0;
+
+			for (int l = 1; l <= mW; ++l) {
+
+				if (capped[l]) cappedNum += targets[l];
+				else weight += mLengthNum[l];
+			}
+
+			remainders.clear();
+
+			assigned = cappedNum;
+
+			for (int l = 1; l <= mW; ++l) {
+
+				if (capped[l] || 0 == mLengthNum[l]) continue;
+
+				double exact = static_cast<double>(mLengthNum[l]) * (_num - std::min(_num, cappedNum)) / weight;
+
+				size_t capacity = l < 63 ? static_cast<size_t>(1) << l : static_cast<size_t>(-1);
+
+				if (exact >= capacity) {
+
+					targets[l] = capacity;
+
+					capped[l] = true;
+
+					overflow = true;
+
+					continue;
+				}
+
+				targets[l] = static_cast<size_t>(exact);
+
+				assigned += targets[l];
+
+				remainders.push_back(std::make_pair(exact - targets[l], l));
+			}
+		}
+
+		std::sort(remainders.rbegin(), remainders.rend());
+
+		for (size_t i = 0; assigned < _num && i < remainders.size(); ++i, ++assigned) ++targets[remainders[i].second];
+
+		std::vector<int> lengths;
+
+		for (int l = 1; l <= mW; ++l) {
+
+			for (size_t i = 0; i < targets[l]; ++i) {
+
+				Prefix p;
+
+				if (generatePrefix(l, lengths, p)) addGenerated(p);
+				else ++mFailNum;
+			}
+
+			if (!mGenerated[l].empty()) lengths.push_back(l);
+		}
+
+		std::vector<Prefix> table;
+
+		if (mHasDefault) table.push_back(Prefix{0, 0, 0});
+
+		for (auto& generated : mGenerated) table.insert(table.end(), generated.begin(), generated.end());
+
+		std::sort(table.begin(), table.end());
+
+		std::ofstream fout(_ofn, std::ios_base::binary);
+
+		if (!fout) {
+
+			std::cerr << "cannot open " << _ofn << "\n";
+
+			exit(1);
+		}
+
+		for (auto& p : table) fout << format(p) << " BGPDUMP_TYPE_TABLE_DUMP_V2\n";
+
+		reportShape("generated " + _ofn, table);
+
+		if (0 != mFailNum) std::cerr << "prefixes not placed: " << mFailNum << std::endl;
+
+		return;
+	}
+
+	/// \brief generate _num updates on the generated table and write them in the update format
+	void generateUpdates(const size_t _num, const std::string& _ofn) {
+
+		std::ofstream fout(_ofn, std::ios_base::binary);
+
+		if (!fout) {
+
+			std::cerr << "cannot open " << _ofn << "\n";
+
+			exit(1);
+		}
+
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+		// present prefixes, with their positions for removal in constant time
+		std::vector<Prefix> present;
+
+		std::unordered_map<Prefix, size_t, PrefixHash> position;
+
+		for (auto& generated : mGenerated) {
+
+			for (auto& p : generated) {
+
+				position[p] = present.size();
+
+				present.push_back(p);
+			}
+		}
+
+		auto remove = [&present, &position](const Prefix& _p) {
+
+			size_t pos = position[_p];
+
+			position[present.back()] = pos;
+
+			present[pos] = present.back();
+
+			present.pop_back();
+
+			position.erase(_p);
+		};
+
+		// positions in mGenerated, which is kept in sync with mGeneratedSet, so that no nested prefix is generated under a withdrawn one
+		std::unordered_map<Prefix, size_t, PrefixHash> slot;
+
+		for (auto& generated : mGenerated) {
+
+			for (size_t j = 0; j < generated.size(); ++j) slot[generated[j]] = j;
+		}
+
+		std::vector<int> lengths = getGeneratedLengths();
+
+		auto withdrawGenerated = [this, &slot](const Prefix& _p) {
+
+			std::vector<Prefix>& generated = mGenerated[_p.length];
+
+			size_t pos = slot[_p];
+
+			slot[generated.back()] = pos;
+
+			generated[pos] = generated.back();
+
+			generated.pop_back();
+
+			slot.erase(_p);
+
+			mGeneratedSet.erase(_p);
+		};
+
+		auto announceGenerated = [this, &slot, &lengths](const Prefix& _p) {
+
+			slot[_p] = mGenerated[_p.length].size();
+
+			addGenerated(_p);
+
+			if (1 == mGenerated[_p.length].size()) lengths = getGeneratedLengths(); // a new length
+		};
+
+		std::vector<Prefix> withdrawn;
+
+		std::vector<size_t> lengthNum(mLengthNum);
+
+		size_t lengthSum = mPrefixNum; // 0 if the source table is empty or holds */0 only, then no new prefix is generated
+
+		size_t withdrawNum = 0, updateNum = 0;
+
+		for (size_t i = 0; updateNum < _num && i < 2 * _num; ++i) { // retry the updates skipped
+
+			Prefix p;
+
+			if (uniform(mRng) < mWithdrawRatio && !present.empty()) {
+
+				if (uniform(mRng) < mWithdrawAbsentRatio) { // withdraw of an absent prefix
+
+					if (0 == lengthSum || !generatePrefix(static_cast<int>(draw(lengthNum, lengthSum)), lengths, p)) continue;
+				}
+				else {
+
+					p = present[mRng() % present.size()];
+
+					remove(p);
+
+					withdrawGenerated(p);
+
+					withdrawn.push_back(p);
+				}
+
+				fout << format(p) << " 0\n";
+
+				++withdrawNum;
+
+				++updateNum;
+
+				continue;
+			}
+
+			if (uniform(mRng) < mAnnouncePresentRatio && !present.empty()) { // e.g., a path change
+
+				p = present[mRng() % present.size()];
+			}
+			else {
+
+				if (uniform(mRng) < mReannounceRatio && !withdrawn.empty()) {
+
+					size_t idx = mRng() % withdrawn.size();
+
+					p = withdrawn[idx];
+
+					withdrawn[idx] = withdrawn.back();
+
+					withdrawn.pop_back();
+
+					if (0 != mGeneratedSet.count(p)) continue; // announced again in between
+				}
+				else if (0 == lengthSum || !generatePrefix(static_cast<int>(draw(lengthNum, lengthSum)), lengths, p)) {
+
+					continue;
+				}
+
+				position[p] = present.size();
+
+				present.push_back(p);
+
+				announceGenerated(p);
+			}
+
+			fout << format(p) << " 1\n";
+
+			++updateNum;
+		}
+
+		std::cerr << "generated " << _ofn << "--update num: " << updateNum << " withdraw num: " << withdrawNum << std::endl;
+
+		return;
+	}
+
+	/// \brief number of updates learned
+	size_t getUpdateNum() const {
+
+		return mUpdateNum;
+	}
+
+	/// \brief number of prefixes in the source table
+	size_t getPrefixNum() const {
+
+		return mPrefixNum;
+	}
+};
+
+#endif // _TABLEGEN_H
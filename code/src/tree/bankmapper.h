@@ -0,0 +1,103 @@
+#ifndef _BANKMAPPER_H
+#define _BANKMAPPER_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file bankmapper.h
+/// \brief Definition of the bank mapper for the memory of pipe stages.
+///
+/// Decide the memory bank of each node once the nodes have been scattered into the pipe stages.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+
+#include <vector>
+#include <algorithm>
+
+
+/// \brief Map nodes into the banks of their pipe stages.
+///
+/// The nodes in a stage are numbered in the order they are visited, and a node is mapped to a bank by hashing its index.
+/// Each group of B consecutive indices is rotated by a hashed offset, so that the banks of a stage differ in at most one node,
+/// while neighbouring nodes (e.g., siblings) do not fall into a fixed pattern of banks.
+class BankMapper{
+
+private:
+
+	int mStageNum; ///< number of pipe stages
+
+	int mBankNum; ///< number of banks per pipe stage
+
+	std::vector<size_t> mNodeNumInStage; ///< number of nodes mapped in each pipe stage
+
+	std::vector<size_t> mNodeNumInBank; ///< number of nodes mapped in each bank, indexed by stage * mBankNum + bank
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _stagenum number of pipe stages
+	/// \param _banknum number of banks per pipe stage
+	BankMapper(const int _stagenum, const int _banknum) :
+		mStageNum(_stagenum),
+		mBankNum(_banknum),
+		mNodeNumInStage(_stagenum, 0),
+		mNodeNumInBank(_stagenum * _banknum, 0) {
+
+		assert(_banknum >= 1);
+	}
+
+	/// \brief mix the bits of an index (finalizer of MurmurHash3)
+	static uint32 hash(uint32 _idx) {
+
+		_idx ^= _idx >> 16;
+
+		_idx *= 0x85ebca6bu;
+
+		_idx ^= _idx >> 13;
+
+		_idx *= 0xc2b2ae35u;
+
+		_idx ^= _idx >> 16;
+
+		return _idx;
+	}
+
+	/// \brief map the next node of a pipe stage
+	///
+	/// \return bank of the node
+	int map(const int _stageidx) {
+
+		uint32 idx = static_cast<uint32>(mNodeNumInStage[_stageidx]++);
+
+		int bank = static_cast<int>((idx + hash(idx / mBankNum)) % mBankNum);
+
+		mNodeNumInBank[_stageidx * mBankNum + bank]++;
+
+		return bank;
+	}
+
+	/// \brief print the balance of the banks
+	void report() const {
+
+		size_t maxNum = 0, sumNum = 0;
+
+		for (auto num : mNodeNumInBank) {
+
+			maxNum = std::max(maxNum, num);
+
+			sumNum += num;
+		}
+
+		std::cerr << "banks per stage: " << mBankNum << " nodes in the largest bank: " << maxNum
+			<< " mean: " << static_cast<double>(sumNum) / mNodeNumInBank.size() << std::endl;
+
+		return;
+	}
+};
+
+#endif
@@ -16,6 +16,8 @@
 
 #include "../common/common.h"
 #include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/accesslog.h"
 #include <queue>
 #include <deque>
 #include <stack>
@@ -63,10 +65,12 @@ private:
 
 	uint32 levelnodenum[W + 1]; ///< root node contains */0 and locates at level 0
 
+	utility::AccessLog* mAccessLog; ///< log of the memory accesses of search(), nullptr for none
+
 private:
 
 	/// \brief default ctor
-	BTree() : root(nullptr), nodenum(0) {
+	BTree() : root(nullptr), nodenum(0), mAccessLog(nullptr) {
 
 		for (int i = 0; i < W + 1; ++i) {
 
@@ -121,12 +125,20 @@ public:
 
 		uint32 nexthop;
 	
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("BTree", {W}, "build"));
+
+		size_t linenum = 0; // number of prefixes read
+
+		counter.start();
+
 		while (getline(fin, line)) {	
 
+			++linenum;
+
 			// retrieve prefix and length
 			utility::retrieveInfo(line, prefix, length);
 
-			nexthop = length; //! note that we represent the nexthop information by length (for test only)
+			nexthop = utility::retrieveNexthop(line, length); // interned nexthop if given, or the length (for test only)
 	
 			if (0 == length) { // must be */0
 
@@ -144,6 +156,8 @@ public:
 			}
 		}	 
 
+		counter.stop(linenum);
+
 		std::cerr << "created node num: " << nodenum << std::endl;
 
 		for (int i = 0; i < W + 1; ++i) {
@@ -272,6 +286,12 @@ public:
 	}
 
 	/// \breif search the LPM for the given IP address
+	/// \brief attach a log of the memory accesses of search(), nullptr to detach
+	void setAccessLog(utility::AccessLog* _log) {
+
+		mAccessLog = _log;
+	}
+
 	uint32 search(const ip_type& _ip) {
 
 		// root contains */0, which is a prefix matching any address
@@ -284,6 +304,8 @@ public:
 		// search from root to a leaf node
 		while (node != nullptr) {
 
+			if (nullptr != mAccessLog) mAccessLog->record(node, sizeof(node_type));
+
 			// find a valid prefix, update nexthop
 			if (node->nexthop != 0) {
 
@@ -0,0 +1,111 @@
+#ifndef _CIRPLACER_H
+#define _CIRPLACER_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file cirplacer.h
+/// \brief Definition of the tree placer for a circular pipeline.
+///
+/// Choose the start stage of each tree when scattering a forest into a circular pipeline.
+/// Please refer to "CAMP: fast and efficient IP lookup architecture" for more details.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+
+#include <vector>
+#include <limits>
+
+
+/// \brief Place trees into a circular pipeline, larger trees are expected to be placed first.
+///
+/// The root of a tree is located at a start stage and the nodes at level k are located at stage (start + k) % S.
+/// Among all the start stages, the one minimizing the variance of memory in use over all stages is chosen.
+///
+/// Let c[s] be the memory in use for stage s and f[r] be the memory of levels k with k % S == r.
+/// Putting the tree at start stage j adds f[r] to c[(j + r) % S]. Since the total memory is fixed,
+/// the variance only depends on sum_r 2 * c[(j + r) % S] * f[r] + f[r]^2, where the latter term is the same for all j.
+/// Thus a candidate is evaluated in O(depth) instead of copying and rescanning all stages.
+class CirPlacer{
+
+private:
+
+	int mStageNum; ///< number of pipe stages
+
+	std::vector<uint64> mColored; ///< memory in use for each stage
+
+	std::vector<uint64> mFold; ///< memory of a tree folded into the stages, f[r]
+
+	std::vector<int> mFoldIdx; ///< indices r with f[r] != 0
+
+public:
+
+	/// \brief ctor
+	CirPlacer(const int _stagenum) : mStageNum(_stagenum), mColored(_stagenum, 0), mFold(_stagenum, 0) {}
+
+	/// \brief choose the start stage for a tree and account for its memory
+	///
+	/// \param _levelMem memory of each level in the tree
+	/// \param _levelNum number of levels
+	/// \return the start stage, the smallest index is returned for a tie
+	template<typename T>
+	int place(const T* _levelMem, const int _levelNum) {
+
+		// fold levels into stages (wrap around)
+		for (int k = 0; k < _levelNum; ++k) {
+
+			if (0 == _levelMem[k]) continue;
+
+			int r = k % mStageNum;
+
+			if (0 == mFold[r]) mFoldIdx.push_back(r);
+
+			mFold[r] += _levelMem[k];
+		}
+
+		// try to put the root node at j-th pipe stage
+		int bestStartIdx = 0;
+
+		uint64 bestCost = std::numeric_limits<uint64>::max();
+
+		for (int j = 0; j < mStageNum; ++j) {
+
+			uint64 cost = 0;
+
+			for (auto r : mFoldIdx) {
+
+				cost += mColored[(j + r) % mStageNum] * mFold[r];
+			}
+
+			if (cost < bestCost) {
+
+				bestCost = cost;
+
+				bestStartIdx = j;
+			}
+		}
+
+		// color the stages and reset the folded tree
+		for (auto r : mFoldIdx) {
+
+			mColored[(bestStartIdx + r) % mStageNum] += mFold[r];
+
+			mFold[r] = 0;
+		}
+
+		mFoldIdx.clear();
+
+		return bestStartIdx;
+	}
+
+	/// \brief memory in use for a stage
+	uint64 getColored(const int _stageidx) const {
+
+		return mColored[_stageidx];
+	}
+};
+
+#endif // _CIRPLACER_H
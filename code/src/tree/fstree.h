@@ -15,6 +15,8 @@
 
 #include "../common/common.h"
 #include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/accesslog.h"
 #include "btree.h"
 #include <queue>
 #include <deque>
@@ -187,6 +189,8 @@ private:
 	uint32 mLevelEntryNum[K]; ///< number of entries in each level
 
 	uint32 mMaxLevelEntryNum; ///< maximum number of entries among all the levels 
+
+	utility::AccessLog* mAccessLog; ///< log of the memory accesses of search(), nullptr for none
 private:
 
 	FSTree (const FSTree& _factory) = delete;
@@ -196,7 +200,7 @@ private:
 public:
 
 	/// \brief ctor
-	FSTree () : fst_root(nullptr), fst2_root(nullptr), mNodeNum(0), mEntryNum(0) {
+	FSTree () : fst_root(nullptr), fst2_root(nullptr), mNodeNum(0), mEntryNum(0), mAccessLog(nullptr) {
 
 		for (int i = 0; i < K; ++i) {
 
@@ -266,12 +270,20 @@ public:
 
 		uint32 nexthop;
 
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("FSTree", {W, K, M}, "build"));
+
+		size_t linenum = 0; // number of prefixes read
+
+		counter.start();
+
 		while (getline(fin, line)) {
 
+			++linenum;
+
 			// retrieve prefix and length
 			utility::retrieveInfo(line, prefix, length);
 
-			nexthop = length; // represent the nexthop information by length (for test only)
+			nexthop = utility::retrieveNexthop(line, length); // interned nexthop if given, or the length (for test only)
 
 			if (0 == length) { // attempt to insert */0, do nothing
 			
@@ -290,6 +302,8 @@ public:
 		// rebuild the fixed-stride tree by leaf-pushing
 		rebuild();
 
+		counter.stop(linenum);
+
 		return;
 	}
 
@@ -820,6 +834,12 @@ private:
 
 public:
 	/// \brief search 
+	/// \brief attach a log of the memory accesses of search(), nullptr to detach
+	void setAccessLog(utility::AccessLog* _log) {
+
+		mAccessLog = _log;
+	}
+
 	uint32 search(const ip_type& _ip) {
 
 		uint32 nexthop = 0;
@@ -837,6 +857,11 @@ public:
 
 			uint32 entryIndex = utility::getBitsValue(_ip, begBit, endBit);
 
+			// the node, i.e., the pointer to its entries, and the entry
+			if (nullptr != mAccessLog) mAccessLog->record(node, sizeof(fnode2_type));
+
+			if (nullptr != mAccessLog) mAccessLog->record(&node->entries[entryIndex], sizeof(typename fnode2_type::Entry));
+
 			if (true == node->entries[entryIndex].isLeaf) {
 
 				nexthop = node->entries[entryIndex].nexthop;
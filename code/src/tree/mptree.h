@@ -18,6 +18,8 @@
 
 #include "../common/common.h"
 #include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/accesslog.h"
 #include <queue>
 #include <cmath>
 
@@ -128,10 +130,12 @@ private:
 
 	uint32 mSNodeNum; ///< number of secondary nodes in total
 
+	utility::AccessLog* mAccessLog; ///< log of the memory accesses of search(), nullptr for none
+
 private:
 	
 	/// \brief default ctor
-	MPTree() : pRoot(nullptr), mPNodeNum(0), mSNodeNum(0) {}
+	MPTree() : pRoot(nullptr), mPNodeNum(0), mSNodeNum(0), mAccessLog(nullptr) {}
 
 	MPTree(const MPTree& _mpt) = delete;
 
@@ -172,11 +176,19 @@ public:
 
 		uint32 nexthop;
 
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("MPTree", {W, K}, "build"));
+
+		size_t linenum = 0; // number of prefixes read
+
+		counter.start();
+
 		while (getline(fin, line)) {
 
+			++linenum;
+
 			utility::retrieveInfo(line, prefix, length);
 
-			nexthop = length; 
+			nexthop = utility::retrieveNexthop(line, length); // interned nexthop if given, or the length (for test only)
 
 			if (0 == length) { // */0
 
@@ -188,6 +200,8 @@ public:
 			}
 		}		
 
+		counter.stop(linenum);
+
 		return;
 	}
 
@@ -429,6 +443,12 @@ public:
 
 
 	/// \brief search LPM for the given IP address
+	/// \brief attach a log of the memory accesses of search(), nullptr to detach
+	void setAccessLog(utility::AccessLog* _log) {
+
+		mAccessLog = _log;
+	}
+
 	uint32 search(const ip_type& _ip) {
 
 		if (nullptr == pRoot) {
@@ -446,6 +466,9 @@ public:
 
 		while (nullptr != pnode) {
 
+			// the count and the prefixes scanned
+			if (nullptr != mAccessLog) mAccessLog->record(pnode, reinterpret_cast<const char*>(&pnode->prefixEntries[pnode->t]) - reinterpret_cast<const char*>(pnode));
+
 			// search in pnode, if there exist a match, then it must be LPM
 			for (size_t i = 0; i < pnode->t; ++i) {
 
@@ -456,6 +479,8 @@ public:
 			}
 
 			// search in snode, if find a match, record it in (bestLength, nexthop)
+			if (nullptr != mAccessLog) mAccessLog->record(&pnode->sRoot, sizeof(snode_type*));
+
 			if (nullptr != pnode->sRoot) {
 
 				int sLevel = 0;
@@ -464,6 +489,8 @@ public:
 
 				while (nullptr != snode) {
 
+					if (nullptr != mAccessLog) mAccessLog->record(snode, sizeof(snode_type));
+
 					if (utility::getBitsValue(_ip, 0, snode->length - 1) == utility::getBitsValue(snode->prefix, 0, snode->length - 1)) {
 
 						if (sBestLength < snode->length) {
@@ -488,7 +515,11 @@ public:
 			}
 
 			// search in higher level
-			pnode = pnode->childEntries[utility::getBitsValue(_ip, pLevel * K, (pLevel + 1) * K - 1)];
+			size_t childIdx = utility::getBitsValue(_ip, pLevel * K, (pLevel + 1) * K - 1);
+
+			if (nullptr != mAccessLog) mAccessLog->record(&pnode->childEntries[childIdx], sizeof(pnode_type*));
+
+			pnode = pnode->childEntries[childIdx];
 
 			++pLevel;
 		}
@@ -17,6 +17,8 @@
 
 #include "../common/common.h"
 #include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/accesslog.h"
 #include <queue>
 
 
@@ -63,12 +65,14 @@ private:
 
 	uint32 mNodeNum; ///< number of nodes in total
 
+	utility::AccessLog* mAccessLog; ///< log of the memory accesses of search(), nullptr for none
+
 	uint32 mLevelNodeNum[W + 1]; ///< number of nodes in each level
 
 private:
 
 	/// \brief default ctor
-	PTree() : root(nullptr), mNodeNum(0) {
+	PTree() : root(nullptr), mNodeNum(0), mAccessLog(nullptr) {
 
 		for (int i = 0; i < W + 1; ++i) {
 
@@ -116,12 +120,20 @@ public:
 
 		uint32 nexthop;
 
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("PTree", {W}, "build"));
+
+		size_t linenum = 0; // number of prefixes read
+
+		counter.start();
+
 		while(getline(fin, line)) {
 
+			++linenum;
+
 			// retrieve prefix and length
 			utility::retrieveInfo(line, prefix, length);
 
-			nexthop = length;
+			nexthop = utility::retrieveNexthop(line, length); // interned nexthop if given, or the length (for test only)
 
 			if (0 == length) { // */0
 
@@ -133,6 +145,8 @@ public:
 			}
 		}
 
+		counter.stop(linenum);
+
 		std::cerr << "created node num: " << mNodeNum << std::endl;
 
 		for (int i = 0; i < W + 1; ++i) {
@@ -345,6 +359,12 @@ public:
 
 
 	/// \brief search the LPM for the given IP address
+	/// \brief attach a log of the memory accesses of search(), nullptr to detach
+	void setAccessLog(utility::AccessLog* _log) {
+
+		mAccessLog = _log;
+	}
+
 	uint32 search(const ip_type& _ip) {
 		
 		uint32 nexthop = 0; 
@@ -362,6 +382,8 @@ public:
 			
 			while (nullptr != node) {
 
+				if (nullptr != mAccessLog) mAccessLog->record(node, sizeof(node_type));
+
 				if (utility::getBitsValue(_ip, 0, node->length - 1) == utility::getBitsValue(node->prefix, 0, node->length - 1)) { // match
 
 					if (bestLength < node->length) { // if length > current best match
@@ -17,7 +17,16 @@
 
 #include "../common/common.h"
 #include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/accesslog.h"
 #include "rbtree.h"
+#include "stageplacer.h"
+#include "cirplacer.h"
+#include "bankmapper.h"
+#include "stagemap.h"
+#include "tracegen.h"
+#include "tracer.h"
+#include "../common/parallel.h"
 #include <queue>
 #include <deque>
 #include <stack>
@@ -115,7 +124,7 @@ struct FNode2{
 
 	};
 
-	int stageidx;
+	uint32 id; ///< node ID, indexing the stage mappings (see StageMap)
 
 	Entry* entries;
 
@@ -124,7 +133,7 @@ struct FNode2{
 
 		entries = new Entry[_entrynum];
 
-		stageidx = 0;
+		id = 0;
 	}
 
 	~FNode2(){
@@ -197,6 +206,12 @@ private:
 	size_t mMaxGlobalLevelEntryNum; ///< maximum number of entries in a level (nodes in a same level of all trees are summed up)
 
 	FastTable<W, U - 1> ft; ///< pointer to fast table
+
+	StageMap mStageMap; ///< mapping of the nodes to the stages, used if no other mapping is given
+
+	uint32 mNodeIdNum; ///< number of node IDs given, the ID of the next node created
+
+	utility::AccessLog* mAccessLog; ///< log of the memory accesses of search(), nullptr for none
 	
 private:
 
@@ -207,7 +222,7 @@ private:
 public:
 
 	/// \brief ctor
-	RFSTree() {
+	RFSTree() : mAccessLog(nullptr) {
 
 		initializeParameters();
 	}
@@ -215,6 +230,10 @@ public:
 
 	/// \brief initialize parameters
 	void initializeParameters() {
+
+		mStageMap.clear();
+
+		mNodeIdNum = 0;
 	
 		for (size_t i = 0; i < V; ++i) {
 
@@ -350,53 +369,56 @@ public:
 		return;
 	}
 
-	/// \brief produce a non-leaf-pushed fixed-stride tree	
+	/// \brief produce a non-leaf-pushed fixed-stride tree
 	void build(const std::string& _fn) {
 
+		std::vector<utility::Route<W> > table;
+
+		utility::loadTable<W>(_fn, table);
+
+		build(table);
+
+		return;
+	}
+
+	/// \brief produce a fixed-stride tree from a parsed table, e.g., shared by several indexes
+	void build(const std::vector<utility::Route<W> >& _table) {
+
 		// if an index exists, clear.
 		clear();
 
-		// initialize	
+		// initialize
 		initializeParameters();
 
 		// build the auxiliary binary tree
 		rbtree_type* rbt = new rbtree_type();
 
-		rbt->build(_fn);
-		
+		rbt->build(_table);
+
 		// compute expansion levels using dynamic programming
 		doPrefixExpansion(rbt);
 
-		// insert prefixes in BGP table one by one
-		std::ifstream fin(_fn, std::ios_base::binary);
-
-		std::string line;
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("RFSTree", {W, K, M, U}, "build"));
 
-		ip_type prefix;
+		counter.start();
 
-		uint8 length;
-
-		uint32 nexthop;
-
-		while (getline(fin, line)) {
-
-			// retrieve prefix and length
-			utility::retrieveInfo(line, prefix, length);
-
-			nexthop = length;
+		// insert prefixes in BGP table one by one
+		for (auto& route : _table) {
 
-			if (0 == length) {
+			if (0 == route.length) {
 
 				// do nothing
 			}
 			else {
 
-				ins(prefix, length, nexthop);
+				ins(route.prefix, route.length, route.nexthop);
 			}
 		}
 
 		// rebuild the fixed-stride tree by leaf-pushing the prefixes
 		rebuild();
+
+		counter.stop(_table.size());
 	
 		return;
 	}
@@ -897,6 +919,8 @@ public:
 					std::queue<std::tuple<fnode_type*, int, fnode2_type*> > queue;		
 						
 					mRootTable2[i] = new fnode2_type(mNodeEntryNum[0]); 
+
+					mRootTable2[i]->id = mNodeIdNum++;
 				
 					++mGlobalLevelNodeNum[0];
 
@@ -925,6 +949,8 @@ public:
 		
 								std::get<2>(front)->entries[j].child = new fnode2_type(mNodeEntryNum[std::get<1>(front) + 1]);
 
+							std::get<2>(front)->entries[j].child->id = mNodeIdNum++;
+
 								++mGlobalLevelNodeNum[std::get<1>(front) + 1];
 
 								++mLocalLevelNodeNum[i][std::get<1>(front) + 1];
@@ -1001,9 +1027,41 @@ public:
 		return;
 	}
 
-	/// \brief search LPM for target IP address
+	/// \brief attach a log of the memory accesses of search(), nullptr to detach
+	void setAccessLog(utility::AccessLog* _log) {
+
+		mAccessLog = _log;
+	}
+
+	/// \brief search LPM for target IP address, without the trace
+	///
+	/// The memory accesses are logged if a log is attached, otherwise nothing is traced, i.e., search() with NullTracer.
+	uint32 search(const ip_type& _ip) {
+
+		if (nullptr != mAccessLog) {
+
+			AddressTracer tracer(*mAccessLog);
+
+			return search(_ip, tracer);
+		}
+
+		NullTracer tracer;
+
+		return search(_ip, tracer);
+	}
+
+	/// \brief search LPM for target IP address, with the node IDs visited appended to the trace
 	uint32 search(const ip_type& _ip, std::vector<int>& _trace) {
 
+		StageTracer tracer(_trace);
+
+		return search(_ip, tracer);
+	}
+
+	/// \brief search LPM for target IP address, traced by a tracer (see tracer.h)
+	template<typename R>
+	uint32 search(const ip_type& _ip, R& _tracer) {
+
 		// try to find a match in the fast lookup table
 		uint32 nexthop1 = 0;
 
@@ -1020,20 +1078,29 @@ public:
 
 		int expansionLevel = 0;
 
+		_tracer.access(&ft.mEntries[utility::getBitsValue(_ip, 0, U - 1)], sizeof(ft.mEntries[0]));
+
+		_tracer.access(&mRootTable2[entryIndex], sizeof(fnode2_type*));
+
 		if (nullptr != mRootTable2[entryIndex]) {
 
 	 		fnode2_type* node = mRootTable2[entryIndex];
 			
 			while(true) {
 
-				_trace.push_back(node->stageidx); // stageidx
+				_tracer.step(node->id); // mapped to stage and bank by a StageMap
 			
 				begBit = mBegLevel[expansionLevel] + U - 1;
 
 				endBit = mEndLevel[expansionLevel] + U - 1;
 				
 				entryIndex = utility::getBitsValue(_ip, begBit, endBit);
-				
+
+				// the node, i.e., the pointer to its entries, and the entry
+				_tracer.access(node, sizeof(fnode2_type));
+
+				_tracer.access(&node->entries[entryIndex], sizeof(node->entries[0]));
+
 				if (true == node->entries[entryIndex].isLeaf) {
 
 					nexthop2 = node->entries[entryIndex].nexthop;
@@ -1063,54 +1130,28 @@ public:
 	/// \brief generate lookup trace for simulation
 	void generateTrace (const std::string& _reqFile, const std::string& _traceFile, const uint32 _stageNum){
 
-		std::ifstream reqFin(_reqFile, std::ios_base::binary);
+		generateTrace(_reqFile, std::vector<TraceOutput>(1, TraceOutput(&mStageMap, _traceFile, _stageNum)));
 
-		std::string line;
-
-		ip_type prefix;
-
-		std::ofstream traFin(_traceFile, std::ios_base::binary);	
-		
-		size_t searchNum = 0;
-
-		double avgSearchDepth = 0;
+		return;
+	}
 
-		while (getline(reqFin, line)) {
+	/// \brief generate lookup traces under several mappings in one pass
+	///
+	/// Each request is searched once, and its steps are written to each trace file as mapped by the mapping of the file.
+	void generateTrace (const std::string& _reqFile, const std::vector<TraceOutput>& _outputs){
 
-			std::vector<int> trace;
+		// the requests are searched on the worker threads, see TraceGenerator
+		TraceGenerator<ip_type> generator;
 
-			std::stringstream ss(line);
+		generator.run(_reqFile, _outputs, utility::getPerfName("RFSTree", {W, K, M, U}, "traced search"), [this](const ip_type& _ip, TraceBatch& _batch) {
 
-			ss >> prefix;
-			
 			// generate trace while performing the lookup request
-			search(prefix, trace);
+			search(_ip, _batch.steps);
+		});
 
-			// collect search depth
-			++searchNum;
+		double avgSearchDepth = generator.getAvgSearchDepth(); 
 
-			avgSearchDepth += trace.size();
-		 
-			// output trace to file	
-			traFin << static_cast<size_t>(trace.size());
-
-			traFin << " ";
-	
-			// record stage list
-			for (int i = 0; i < trace.size(); ++i) {
-			
-				traFin << static_cast<size_t>(trace[i]);		
-
-				traFin << " ";
-			}
-	
-			//
-			traFin << "\n";
-		}
-	
-		avgSearchDepth /= searchNum; 
-
-		std::cerr << "workload: " << LAMBDA * BURSTSIZE * avgSearchDepth / _stageNum << std::endl; 
+		for (auto& output : _outputs) std::cerr << "workload: " << LAMBDA * BURSTSIZE * avgSearchDepth / output.stageNum << std::endl; 
 
 		std::cerr << "average search depth: " << avgSearchDepth << std::endl;		
 
@@ -1222,21 +1263,81 @@ public:
 	///
 	/// For CPE and MINMAX, we only consider linear pipeline
 	/// For EVEN, we consider linear, circular and random pipelines 
-	void scatterToPipeline(int _pipestyle, int _stagenum = W - U + 1) {
+	/// For a random pipeline, _ranpolicy selects the placement policy (see StagePlacer).
+	/// The memory of each stage is split into _banknum banks (see BankMapper), 
+	/// then the traces give stage * _banknum + bank for each step.
+	void scatterToPipeline(int _pipestyle, int _stagenum = W - U + 1, int _ranpolicy = 0, int _banknum = 1) {
+
+		scatterToPipeline(mStageMap, _pipestyle, _stagenum, _ranpolicy, _banknum);
+
+		return;
+	}
+
+	/// \brief Scatter nodes into a mapping of its own, apart from the other mappings of the index
+	void scatterToPipeline(StageMap& _map, int _pipestyle, int _stagenum = W - U + 1, int _ranpolicy = 0, int _banknum = 1) {
+
+		_map.resize(mNodeIdNum);
+
+		_map.setPipeline(_stagenum, _banknum);
 	
 		switch(_pipestyle) {
 
-		case 0: lin(_stagenum); break;
+		case 0: lin(_map, _stagenum); break;
 
-		case 1: ran(_stagenum); break;
+		case 1: ran(_map, _stagenum, _ranpolicy); break;
 
-		case 2: cir(_stagenum); break;
+		case 2: cir(_map, _stagenum); break;
 
 		}
 
+		mapToBanks(_map, _stagenum, _banknum);
+
 		return;		
 	}	
 
+	/// \brief mapping of the nodes to the stages, used if no other mapping is given
+	StageMap& getStageMap() {
+
+		return mStageMap;
+	}
+
+	/// \brief Map nodes into the memory banks of their pipe stages.
+	void mapToBanks(StageMap& _map, int _stagenum, int _banknum) {
+
+		BankMapper mapper(_stagenum, _banknum);
+
+		for (size_t i = 0; i < V; ++i) {
+
+			if (nullptr != mRootTable2[i]) {
+
+				std::queue<std::pair<fnode2_type*, int> > queue;
+
+				queue.push(std::pair<fnode2_type*, int>(mRootTable2[i], 0));
+
+				while (!queue.empty()) {
+
+					auto front = queue.front();
+
+					_map.bank(front.first->id) = mapper.map(_map.stage(front.first->id));
+
+					for (size_t j = 0; j < mNodeEntryNum[front.second]; ++j) {
+
+						if (false == front.first->entries[j].isLeaf) {
+
+							queue.push(std::pair<fnode2_type*, int>(front.first->entries[j].child, front.second + 1));
+						}
+					}
+
+					queue.pop();
+				}
+			}
+		}
+
+		if (_banknum > 1) mapper.report();
+
+		return;
+	}
+
 	
 	/// \brief Scatter nodes in a linear pipeline.
 	///
@@ -1244,7 +1345,7 @@ public:
 	///
 	/// \note the number of stages is W - U + 1 for a linear pipe line.
 	/// \note CPE, MINMAX and EVEN are permitted
-	void lin(int _stagenum) {
+	void lin(StageMap& _map, int _stagenum) {
 		
 		size_t* nodeNumInStage = new size_t[_stagenum];
 
@@ -1266,7 +1367,7 @@ public:
 			
 					auto front = queue.front();
 
-					front.first->stageidx = front.second;
+					_map.stage(front.first->id) = front.second;
 					
 					nodeNumInStage[front.second] += 1;
 						
@@ -1306,9 +1407,11 @@ public:
 
 	/// \brief Scatter in a random pipeline.
 	///
-	/// Map nodes into a random pipeline. A random generator is applied to determine the pipe stage to where a node is allocated.
+	/// Map nodes into a random pipeline. A placer is applied to determine the pipe stage to where a node is allocated.
+	/// Nodes at different levels are of different size, thus the placer is weighted by the number of entries in a node.
 	///
-	void ran(int _stagenum) {
+	/// \param _ranpolicy 0, 1 or 2 for uniform, power-of-two-choices or greedy least-loaded placement, respectively (see StagePlacer)
+	void ran(StageMap& _map, int _stagenum, int _ranpolicy = 0) {
 		
 		// collect information about the number of nodes/entries in each stage
 		size_t* nodeNumInStage = new size_t[_stagenum];
@@ -1322,41 +1425,42 @@ public:
 			entryNumInStage[i] = 0;
 		}
 	
-		unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-
-		std::default_random_engine generator = std::default_random_engine(seed);
-
-		std::uniform_int_distribution<int> distribution = std::uniform_int_distribution<int>(0, _stagenum - 1);
-
-		auto roll = std::bind(distribution, generator);
+		StagePlacer placer(_stagenum, _ranpolicy);
 
+		placer.reportPolicy();
 		
-		// start numbering from 0 to _stagenum - 1, nodes in a same level are located in the same level
+		// a node is placed when it is pushed into the queue, so that the stage of its parent is known
 		for (size_t i = 0; i < V; ++i) {
 
 			if (nullptr != mRootTable2[i]) {
 
 				std::queue<std::pair<fnode2_type*, int> > queue;
 
+				_map.stage(mRootTable2[i]->id) = placer.place(mNodeEntryNum[0]);
+
+				nodeNumInStage[_map.stage(mRootTable2[i]->id)] += 1;
+
+				entryNumInStage[_map.stage(mRootTable2[i]->id)] += mNodeEntryNum[0];
+
 				queue.push(std::pair<fnode2_type*, int>(mRootTable2[i], 0));
 	
 				while(!queue.empty()) {
 			
 					auto front = queue.front();
 
-					int rand_stageidx = roll();
+					for (size_t j = 0; j < mNodeEntryNum[front.second]; ++j) {
 
-					front.first->stageidx = rand_stageidx;
-							
-					nodeNumInStage[rand_stageidx] += 1;
+						if (false == front.first->entries[j].isLeaf) { // has child, place and push the child
 
-					entryNumInStage[rand_stageidx] += mNodeEntryNum[front.second];
-						
-					for (size_t j = 0; j < mNodeEntryNum[front.second]; ++j) {
+							fnode2_type* child = front.first->entries[j].child;
+
+							_map.stage(child->id) = placer.place(mNodeEntryNum[front.second + 1], _map.stage(front.first->id));
+
+							nodeNumInStage[_map.stage(child->id)] += 1;
 
-						if (false == front.first->entries[j].isLeaf) { // has child, push the child
+							entryNumInStage[_map.stage(child->id)] += mNodeEntryNum[front.second + 1];
 
-							 queue.push(std::pair<fnode2_type*, int>(front.first->entries[j].child, front.second + 1));
+							queue.push(std::pair<fnode2_type*, int>(child, front.second + 1));
 						}
 					}
 			
@@ -1399,6 +1503,8 @@ public:
 
 		std::cerr << "min ratio: " << min_ratio << " max ratio: " << max_ratio << " mean ratio: " << mean_ratio << std::endl;
 
+		std::cerr << "entries in the largest stage: " << placer.getMaxMemUse() << std::endl;
+
 		delete[] nodeNumInStage;
 
 		delete[] entryNumInStage;
@@ -1433,10 +1539,10 @@ public:
 	/// \brief Scatter in a circular pipe line.
 	///
 	/// Scatter nodes into a circular pipe line according to method proposed by Sailesh Karmar et al.
-	/// we use variance to make heuristic.
+	/// we use variance to make heuristic (see CirPlacer).
 	/// Because nodes in a fixed-stride tree is of different size in different levels, we perform the heuristic by coloring the entries
 	/// instead of coloring the nodes.
-	void cir(int _stagenum) {
+	void cir(StageMap& _map, int _stagenum) {
 
 		// step 1: sort binary tries by their size in non-decreasing order
 		std::vector<SortElem> vec;
@@ -1451,69 +1557,24 @@ public:
 
 		std::sort(std::begin(vec), std::end(vec));		
 
-		// step 2: scatter nodes
-		size_t* colored = new size_t[_stagenum];
+		// step 2: choose the start stage for each tree, larger-size tree first
+		CirPlacer placer(_stagenum);
 
-		for (int i = 0; i < _stagenum; ++i) colored[i]= 0;
+		std::vector<int> startIdx(vec.size(), 0);
 
-		size_t* trycolor = new size_t[_stagenum];
+		for (int i = vec.size() - 1; i >= 0; --i) {
 
-		for (int i = 0; i < _stagenum; ++i) trycolor[i] = 0;
+			startIdx[i] = placer.place(mLocalLevelEntryNum[vec[i].treeIdx], K); // put nodes (color all entries) one level per stage
+		}
 
-		int bestStartIdx = 0;
+		// step 3: color the trees, trees are independent of each other
+		utility::parallelFor(vec.size(), [&](const size_t i) {
 
-		for (int i = vec.size() - 1; i >= 0; --i) { // larger-size tree first
-		
 			size_t treeIdx = vec[i].treeIdx;
 
-			double bestVar = std::numeric_limits<double>::max();
-
-			for (size_t j = 0; j < _stagenum; ++j) { // try to put the root node at j-th pipe stage
-
-				for (size_t k = 0; k < _stagenum; ++k) { // reset 
-
-					trycolor[k] = colored[k];
-				}
-	
-				for (size_t k = 0; k < K; ++k) { // put nodes (color all entries) one level per stage
-
-					trycolor[(j + k) % _stagenum] += mLocalLevelEntryNum[treeIdx][k]; 		
-				}
-
-				// compute variance
-				double sum = std::accumulate(trycolor, trycolor + _stagenum, 0.0);
-
-				double mean = sum / _stagenum;
-
-				double accum = 0.0;
-
-				for (int k = 0; k < _stagenum; ++k) {
-
-					accum += (trycolor[k] - mean) * (trycolor[k] - mean);
-				}
-				
-				double var = accum / _stagenum;
-
-//				std::cerr << "var: " << var << " bestVar: " << bestVar << std::endl;
-//				std::cin.get();
-
-				if (var < bestVar) {
-					
-					bestVar = var;
-
-					bestStartIdx = j;
-				}
-			}	
-
-			for (int j = 0; j < K; ++j) {
-				
-				colored[(bestStartIdx + j) % _stagenum] += mLocalLevelEntryNum[treeIdx][j];	
-			}
-
-			// color current tree
 			std::queue<std::pair<fnode2_type*, int> > queue;
 
-			mRootTable2[treeIdx]->stageidx = bestStartIdx;
+			_map.stage(mRootTable2[treeIdx]->id) = startIdx[i];
 
 			queue.push(std::pair<fnode2_type*, int>(mRootTable2[treeIdx], 0));
 
@@ -1525,7 +1586,7 @@ public:
 				
 					if (false == front.first->entries[j].isLeaf) {
 
-						front.first->entries[j].child->stageidx = (front.first->stageidx + 1) % _stagenum; // wrap around
+						_map.stage(front.first->entries[j].child->id) = (_map.stage(front.first->id) + 1) % _stagenum; // wrap around
 
 						queue.push(std::pair<fnode2_type*, int>(front.first->entries[j].child, front.second + 1));
 					}	
@@ -1533,7 +1594,12 @@ public:
 
 				queue.pop();
 			}
-		} 
+		});
+
+		// collect information
+		size_t* colored = new size_t[_stagenum];
+
+		for (int i = 0; i < _stagenum; ++i) colored[i] = placer.getColored(i);
 
 		size_t entryNumInAllStages = 0;
 
@@ -1566,8 +1632,6 @@ public:
 
 		delete[] colored;
 
-		delete[] trycolor;
-
 		return;
 	}
 };
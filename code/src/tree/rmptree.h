@@ -18,8 +18,17 @@
 
 #include "../common/common.h"
 #include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/accesslog.h"
 
 #include "fasttable.h"
+#include "stageplacer.h"
+#include "cirplacer.h"
+#include "bankmapper.h"
+#include "stagemap.h"
+#include "tracegen.h"
+#include "tracer.h"
+#include "../common/parallel.h"
 
 #include <queue>
 #include <cmath>
@@ -41,8 +50,6 @@ struct SNode{
 
 	typedef typename choose_ip_type<W>::ip_type ip_type;
 
-	static const size_t size; ///< size of a secondary node
-
 	ip_type prefix; ///< prefix
 	
 	uint8 length; ///< length of prefix
@@ -53,13 +60,16 @@ struct SNode{
 
 	SNode* rchild; ///< pointer to right child
 
-	int stageidx; ///< pipe stage number, not required, only for test
+	uint32 id; ///< node ID, indexing the stage mappings (see StageMap), not required, only for test
 
-	SNode() : prefix(0), length(0), nexthop(0), lchild(nullptr), rchild(nullptr), stageidx(0) {}
-};
+	SNode() : prefix(0), length(0), nexthop(0), lchild(nullptr), rchild(nullptr), id(0) {}
 
-template<int W>
-const size_t SNode<W>::size = sizeof(ip_type) + sizeof(uint8) + sizeof(uint32) + sizeof(SNode*) + sizeof(SNode*); // stageidx is excluded
+	/// \brief size of a secondary node in memory, with a nexthop as wide as the IDs interned so far (see NexthopTable)
+	static size_t getSize() {
+
+		return sizeof(ip_type) + sizeof(uint8) + utility::NexthopTable::global().getByteNum() + sizeof(SNode*) + sizeof(SNode*); // id is excluded
+	}
+};
 
 
 
@@ -73,19 +83,17 @@ const size_t SNode<W>::size = sizeof(ip_type) + sizeof(uint8) + sizeof(uint32) +
 /// \param MP number of prefixes in a primary node, which is equal to  2 * K + 1. Do not change it.
 /// \param MC number of child pointers in a primary node, which is equal to pow(2, K). Do not change it.
 template<int W, int K, size_t MP = 2 * K + 1, size_t MC = static_cast<size_t>(pow(2, K))>
-struct PNode{
+struct MPNode{
 
 	typedef typename choose_ip_type<W>::ip_type ip_type;	
 	
-	typedef PNode<W, K> pnode_type;
+	typedef MPNode<W, K> pnode_type;
 
 	typedef SNode<W> snode_type; 
 
-	static const size_t size; ///< size of a primary node
-
 	uint8 t; ///< number of prefixes currently stored in the primary node, at most 2 * K + 1
 
-	int stageidx; ///< pipe stage number
+	uint32 id; ///< node ID, indexing the stage mappings (see StageMap), shared with the secondary nodes
 
 	/// \brief Prefix entry.
 	///
@@ -108,7 +116,7 @@ struct PNode{
 
 	snode_type* sRoot; ///< pointer to the root of auxiliary prefix tree.
 
-	PNode() : t(0), stageidx(0), sRoot(nullptr) {
+	MPNode() : t(0), id(0), sRoot(nullptr) {
 
 		for (size_t i = 0; i < MC; ++i) {
 
@@ -116,13 +124,18 @@ struct PNode{
 		}
 	}
 
-	~PNode() {
+	~MPNode() {
 		
 	}
-};
 
-template<int W, int K, size_t MP, size_t MC>
-const size_t PNode<W, K, MP, MC>::size = sizeof(uint8) + sizeof(PrefixEntry) * MP + sizeof(pnode_type*) * MC + sizeof(snode_type*); // exclude stageidx
+	/// \brief size of a primary node in memory, with a nexthop as wide as the IDs interned so far (see NexthopTable)
+	static size_t getSize() {
+
+		size_t entrySize = sizeof(ip_type) + sizeof(uint8) + utility::NexthopTable::global().getByteNum();
+
+		return sizeof(uint8) + entrySize * MP + sizeof(pnode_type*) * MC + sizeof(snode_type*); // exclude id
+	}
+};
 
 
 /// \brief Build and update the index.
@@ -144,7 +157,7 @@ private:
 
 	typedef typename choose_ip_type<W>::ip_type ip_type;
 
-	typedef PNode<W, K> pnode_type; ///< primary node type
+	typedef MPNode<W, K> pnode_type; ///< primary node type
 
 	typedef SNode<W> snode_type; ///< secondary node type
 
@@ -168,10 +181,16 @@ private:
 
 	FastTable<W, U - 1> ft; ///< pointer to the fast lookup table
 
+	StageMap mStageMap; ///< mapping of the nodes to the stages, used if no other mapping is given
+
+	uint32 mNodeIdNum; ///< number of node IDs given to primary and secondary nodes, the ID of the next node created
+
+	utility::AccessLog* mAccessLog; ///< log of the memory accesses of search(), nullptr for none
+
 public:
 	
 	/// \brief default ctor
-	RMPTree() {
+	RMPTree() : mAccessLog(nullptr) {
 
 		initializeParameters();
 	}
@@ -179,6 +198,10 @@ public:
 	/// \brief initialize parameters
 	void initializeParameters() {
 
+		mStageMap.clear();
+
+		mNodeIdNum = 0;
+
 		for (size_t i = 0; i < V; ++i) {
 
 			mRootTable[i] = nullptr;
@@ -262,38 +285,42 @@ public:
 	/// \brief Build the index.
 	void build(const std::string & _fn) {
 
-		// clear old index if there exists any
-		clear();
+		std::vector<utility::Route<W> > table;
 
-		// initialize
-		initializeParameters();
+		utility::loadTable<W>(_fn, table);
 
-		// insert prefixes one by one into index
-		std::ifstream fin(_fn, std::ios_base::binary);
+		build(table);
 
-		std::string line;
+		return;
+	}
 
-		ip_type prefix;
+	/// \brief Build the index from a parsed table, e.g., shared by several indexes.
+	void build(const std::vector<utility::Route<W> >& _table) {
 
-		uint8 length;
+		// clear old index if there exists any
+		clear();
 
-		uint32 nexthop;
-		
-		while (getline(fin, line)) {
+		// initialize
+		initializeParameters();
+
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("RMPTree", {W, K, U}, "build"));
 
-			utility::retrieveInfo(line, prefix, length);
+		counter.start();
 
-			nexthop = length; 
+		// insert prefixes one by one into index
+		for (auto& route : _table) {
 
-			if (0 == length) { // */0
+			if (0 == route.length) { // */0
 
 				// do nothing
 			}
 			else {
 
-				ins(prefix, length, nexthop);
+				ins(route.prefix, route.length, route.nexthop);
 			}
-		}		
+		}
+
+		counter.stop(_table.size());
 
 		report();
 
@@ -379,6 +406,8 @@ public:
 
 		std::cerr << "snode num in total: " << mTotalSNodeNum << std::endl;
 
+		std::cerr << "node memory in total (bytes): " << mTotalPNodeNum * pnode_type::getSize() + mTotalSNodeNum * snode_type::getSize() << std::endl;
+
 		return;
 	}
 
@@ -404,6 +433,8 @@ public:
 		if (nullptr == _pnode) { // node is empty, create the node
 
 			_pnode = new pnode_type();
+
+			_pnode->id = mNodeIdNum++;
 	
 			++mLocalPNodeNum[_treeIdx]; // primary nodes in current MPT
 
@@ -498,7 +529,7 @@ public:
 
 
 	/// \brief delete a prefix at certain position from a primary node
-	void deletePrefixInPNode(PNode<W, K>* _pnode, const int _pos){
+	void deletePrefixInPNode(MPNode<W, K>* _pnode, const int _pos){
 
 		// move elements to override the deleted prefix
 		for (int i = _pos + 1; i < _pnode->t; ++i) {
@@ -524,6 +555,8 @@ public:
 			// create a new secondary node
 			_snode = new snode_type();
 
+			_snode->id = mNodeIdNum++;
+
 			mLocalSNodeNum[_treeIdx]++;	
 
 			mLocalLevelSNodeNum[_treeIdx][_pLevel + 1 + _sLevel]++; // be careful, required to plus 1 
@@ -589,9 +622,41 @@ public:
 	}
 
 
-	/// \brief Search LPM for the input IP address.
+	/// \brief attach a log of the memory accesses of search(), nullptr to detach
+	void setAccessLog(utility::AccessLog* _log) {
+
+		mAccessLog = _log;
+	}
+
+	/// \brief search LPM for target IP address, without the trace
+	///
+	/// The memory accesses are logged if a log is attached, otherwise nothing is traced, i.e., search() with NullTracer.
+	uint32 search(const ip_type& _ip) {
+
+		if (nullptr != mAccessLog) {
+
+			AddressTracer tracer(*mAccessLog);
+
+			return search(_ip, tracer);
+		}
+
+		NullTracer tracer;
+
+		return search(_ip, tracer);
+	}
+
+	/// \brief search LPM for target IP address, with the node IDs visited appended to the trace
 	uint32 search(const ip_type& _ip, std::vector<int>& _trace) {
 
+		StageTracer tracer(_trace);
+
+		return search(_ip, tracer);
+	}
+
+	/// \brief Search LPM for the input IP address, traced by a tracer (see tracer.h).
+	template<typename R>
+	uint32 search(const ip_type& _ip, R& _tracer) {
+
 		// try to find a match in the fast lookup table
 		uint32 nexthop1 = 0;
 
@@ -602,6 +667,10 @@ public:
 
 		nexthop2 = 0;
 
+		_tracer.access(&ft.mEntries[utility::getBitsValue(_ip, 0, U - 1)], sizeof(ft.mEntries[0]));
+
+		_tracer.access(&mRootTable[utility::getBitsValue(_ip, 0, U - 1)], sizeof(pnode_type*));
+
 		pnode_type* pnode = mRootTable[utility::getBitsValue(_ip, 0, U - 1)];	
 
 		int pLevel = 0;
@@ -610,7 +679,10 @@ public:
 
 		while (nullptr != pnode) {
 
-			_trace.push_back(pnode->stageidx);
+			_tracer.step(pnode->id); // mapped to stage and bank by a StageMap
+
+			// the count and the prefixes scanned
+			_tracer.access(pnode, reinterpret_cast<const char*>(&pnode->prefixEntries[pnode->t]) - reinterpret_cast<const char*>(pnode));
 
 			// if there exists a match in the primary node, then it must be the LPM
 			for (size_t i = 0; i < pnode->t; ++i) {
@@ -622,6 +694,8 @@ public:
 			}
 				
 			// if there exists a match in the auxiliary tree, then records it.
+			_tracer.access(&pnode->sRoot, sizeof(snode_type*));
+
 			if (nullptr != pnode->sRoot) {
 
 				int sLevel = 0;
@@ -630,7 +704,9 @@ public:
 
 				while (nullptr != snode) {
 
-					_trace.push_back(snode->stageidx);
+					_tracer.step(snode->id);
+
+					_tracer.access(snode, sizeof(snode_type));
 
 					if (utility::getBitsValue(_ip, 0, snode->length - 1) == 
 						utility::getBitsValue(snode->prefix, 0, snode->length - 1)) {
@@ -657,7 +733,11 @@ public:
 			}
 
 			// search in higher levels
-			pnode = pnode->childEntries[utility::getBitsValue(_ip, U + pLevel * K, U + (pLevel + 1) * K - 1)];
+			size_t childIdx = utility::getBitsValue(_ip, U + pLevel * K, U + (pLevel + 1) * K - 1);
+
+			_tracer.access(&pnode->childEntries[childIdx], sizeof(pnode_type*));
+
+			pnode = pnode->childEntries[childIdx];
 
 			++pLevel;
 		}
@@ -677,54 +757,28 @@ public:
 	/// \brief generate lookup trace for simulation
 	void generateTrace (const std::string& _reqFile, const std::string& _traceFile, const uint32 _stageNum){
 
-		std::ifstream reqFin(_reqFile, std::ios_base::binary);
-
-		std::string line;
+		generateTrace(_reqFile, std::vector<TraceOutput>(1, TraceOutput(&mStageMap, _traceFile, _stageNum)));
 
-		ip_type prefix;
-
-		std::ofstream traFin(_traceFile, std::ios_base::binary);	
-		
-		size_t searchNum = 0;
-
-		double avgSearchDepth = 0;
+		return;
+	}
 
-		while (getline(reqFin, line)) {
+	/// \brief generate lookup traces under several mappings in one pass
+	///
+	/// Each request is searched once, and its steps are written to each trace file as mapped by the mapping of the file.
+	void generateTrace (const std::string& _reqFile, const std::vector<TraceOutput>& _outputs){
 
-			std::vector<int> trace;
+		// the requests are searched on the worker threads, see TraceGenerator
+		TraceGenerator<ip_type> generator;
 
-			std::stringstream ss(line);
+		generator.run(_reqFile, _outputs, utility::getPerfName("RMPTree", {W, K, U}, "traced search"), [this](const ip_type& _ip, TraceBatch& _batch) {
 
-			ss >> prefix;
-			
 			// generate trace while performing the lookup request
-			search(prefix, trace);
+			search(_ip, _batch.steps);
+		});
 
-			// collect search depth
-			++searchNum;
+		double avgSearchDepth = generator.getAvgSearchDepth(); 
 
-			avgSearchDepth += trace.size();
-		 
-			// output trace to file	
-			traFin << static_cast<size_t>(trace.size());
-
-			traFin << " ";
-	
-			// record stage list
-			for (int i = 0; i < trace.size(); ++i) {
-			
-				traFin << static_cast<size_t>(trace[i]);		
-
-				traFin << " ";
-			}
-	
-			//
-			traFin << "\n";
-		}
-	
-		avgSearchDepth /= searchNum; 
-
-		std::cerr << "workload: " << LAMBDA * BURSTSIZE * avgSearchDepth / _stageNum << std::endl; 
+		for (auto& output : _outputs) std::cerr << "workload: " << LAMBDA * BURSTSIZE * avgSearchDepth / output.stageNum << std::endl; 
 
 		std::cerr << "average search depth: " << avgSearchDepth << std::endl;		
 
@@ -757,7 +811,7 @@ public:
 	/// (2-1): if current node is an external node, then directly remove the prefix in the node.
 	/// (2-2): if currentnode is an internal node, then remove the prefix in the node and fetch the longest prefix in the child nodes to fill up 
 	/// current node again. Then recursively delete the prefix fetched from the child node. 
-	void del(const ip_type& _prefix, const uint8& _length, PNode<W, K>*& _pnode, const int _level, uint32 _treeIdx) {
+	void del(const ip_type& _prefix, const uint8& _length, MPNode<W, K>*& _pnode, const int _level, uint32 _treeIdx) {
 
 		if (nullptr == _pnode) return;
 
@@ -974,7 +1028,7 @@ public:
 	///
 	/// If all the child nodes have no prefixes, then they are external nodes and the longest prefix is in one of the auxiliary prefix tree
 	/// If at least one child node is an internal node, then the longest prefix can be found in one of the child node.
-	void findLongestPrefixInChild(PNode<W, K>* _pnode, size_t& _childIdx, ip_type& _longPrefix, uint8& _longLength, uint32& _longNexthop){
+	void findLongestPrefixInChild(MPNode<W, K>* _pnode, size_t& _childIdx, ip_type& _longPrefix, uint8& _longLength, uint32& _longNexthop){
 
 		_longLength = 0;
 
@@ -1061,23 +1115,104 @@ public:
 	/// There's no efficient mapping method to distribute nodes in a MPT
 	/// into a linear/cirular pipeline without no-ops
 	/// Here, we only consider random pipeline.
-	void scatterToPipeline(int _pipestyle, int _stagenum = H2) { // H2 > H1
+	/// For a random pipeline, _ranpolicy selects the placement policy (see StagePlacer).
+	/// The memory of each stage is split into _banknum banks (see BankMapper), 
+	/// then the traces give stage * _banknum + bank for each step.
+	void scatterToPipeline(int _pipestyle, int _stagenum = H2, int _ranpolicy = 0, int _banknum = 1) { // H2 > H1
+
+		scatterToPipeline(mStageMap, _pipestyle, _stagenum, _ranpolicy, _banknum);
+
+		return;
+	}
+
+	/// \brief Scatter nodes into a mapping of its own, apart from the other mappings of the index
+	void scatterToPipeline(StageMap& _map, int _pipestyle, int _stagenum = H2, int _ranpolicy = 0, int _banknum = 1) {
+
+		_map.resize(mNodeIdNum);
+
+		_map.setPipeline(_stagenum, _banknum);
 
 		switch(_pipestyle) {
 
-	//	case 0: lin(_stagenum); break;
+	//	case 0: lin(_map, _stagenum); break;
+
+		case 1: ran(_map, _stagenum, _ranpolicy); break;
+
+	//	case 2: cir(_map, _stagenum); break;
+		}
+
+		mapToBanks(_map, _stagenum, _banknum);
+
+		return;
+	}
+
+	/// \brief mapping of the nodes to the stages, used if no other mapping is given
+	StageMap& getStageMap() {
+
+		return mStageMap;
+	}
+
+	/// \brief Map primary and secondary nodes into the memory banks of their pipe stages.
+	void mapToBanks(StageMap& _map, int _stagenum, int _banknum) {
+
+		BankMapper mapper(_stagenum, _banknum);
+
+		for (size_t i = 0; i < V; ++i) {
+
+			if (nullptr != mRootTable[i]) {
+
+				std::queue<pnode_type*> pqueue;
+
+				pqueue.push(mRootTable[i]);
+
+				while (!pqueue.empty()) {
+
+					auto pfront = pqueue.front();
+
+					_map.bank(pfront->id) = mapper.map(_map.stage(pfront->id));
+
+					if (nullptr != pfront->sRoot) {
 
-		case 1: ran(_stagenum); break;
+						std::queue<snode_type*> squeue;
+
+						squeue.push(pfront->sRoot);
 
-	//	case 2: cir(_stagenum); break;
+						while (!squeue.empty()) {
+
+							auto sfront = squeue.front();
+
+							_map.bank(sfront->id) = mapper.map(_map.stage(sfront->id));
+
+							if (nullptr != sfront->lchild) squeue.push(sfront->lchild);
+
+							if (nullptr != sfront->rchild) squeue.push(sfront->rchild);
+
+							squeue.pop();
+						}
+					}
+
+					for (size_t j = 0; j < MC; ++j) {
+
+						if (nullptr != pfront->childEntries[j]) pqueue.push(pfront->childEntries[j]);
+					}
+
+					pqueue.pop();
+				}
+			}
 		}
 
+		if (_banknum > 1) mapper.report();
+
 		return;
 	}
 
 	/// \brief Scatter nodes in a linear pipe line.
 	/// \note abandon
-	void lin(int _stagenum) {
+	void lin(StageMap& _map, int _stagenum) {
+
+		const size_t pnodeSize = pnode_type::getSize(); // nexthops as wide as the IDs interned so far
+
+		const size_t snodeSize = snode_type::getSize();
 
 		size_t* memUseInStage = new size_t[_stagenum];
 
@@ -1099,9 +1234,9 @@ public:
 
 			if (nullptr != mRootTable[i]) { // current MPT is not empty
 
-				mRootTable[i]->stageidx = 0; // put pRoot in the initial stage
+				_map.stage(mRootTable[i]->id) = 0; // put pRoot in the initial stage
 
-				memUseInStage[0] += PNode<W, K>::size;
+				memUseInStage[0] += pnodeSize;
 		
 				testGlobalPNodeNum[0]++;	
 
@@ -1115,11 +1250,11 @@ public:
 
 					if (nullptr != pfront->sRoot) { // auxiliary PT of current primary node is not empty
 
-						pfront->sRoot->stageidx = (pfront->stageidx + 1) % _stagenum; // put sRoot into the next stage of pRoot
+						_map.stage(pfront->sRoot->id) = (_map.stage(pfront->id) + 1) % _stagenum; // put sRoot into the next stage of pRoot
 
-						memUseInStage[pfront->sRoot->stageidx] += SNode<W>::size;
+						memUseInStage[_map.stage(pfront->sRoot->id)] += snodeSize;
 
-						testGlobalSNodeNum[pfront->sRoot->stageidx]++;
+						testGlobalSNodeNum[_map.stage(pfront->sRoot->id)]++;
 
 						std::queue<snode_type*> squeue;
 
@@ -1131,22 +1266,22 @@ public:
 
 							if (nullptr != sfront->lchild) {
 
-								sfront->lchild->stageidx = (sfront->stageidx + 1) % _stagenum; // sequentially put nodes
+								_map.stage(sfront->lchild->id) = (_map.stage(sfront->id) + 1) % _stagenum; // sequentially put nodes
 
-								memUseInStage[sfront->lchild->stageidx] += SNode<W>::size;
+								memUseInStage[_map.stage(sfront->lchild->id)] += snodeSize;
 
-								testGlobalSNodeNum[sfront->lchild->stageidx]++;
+								testGlobalSNodeNum[_map.stage(sfront->lchild->id)]++;
 
 								squeue.push(sfront->lchild);
 							}
 
 							if (nullptr != sfront->rchild) {
 
-								sfront->rchild->stageidx = (sfront->stageidx + 1) % _stagenum;
+								_map.stage(sfront->rchild->id) = (_map.stage(sfront->id) + 1) % _stagenum;
 
-								memUseInStage[sfront->rchild->stageidx] += SNode<W>::size;
+								memUseInStage[_map.stage(sfront->rchild->id)] += snodeSize;
 
-								testGlobalSNodeNum[sfront->rchild->stageidx]++;
+								testGlobalSNodeNum[_map.stage(sfront->rchild->id)]++;
 
 								squeue.push(sfront->rchild);
 							}
@@ -1160,11 +1295,11 @@ public:
 
 						if (nullptr != pfront->childEntries[j]) {
 
-							pfront->childEntries[j]->stageidx = (pfront->stageidx + 1) % _stagenum; // sequentially put nodes
+							_map.stage(pfront->childEntries[j]->id) = (_map.stage(pfront->id) + 1) % _stagenum; // sequentially put nodes
 
-							memUseInStage[pfront->childEntries[j]->stageidx] += PNode<W, K>::size;
+							memUseInStage[_map.stage(pfront->childEntries[j]->id)] += pnodeSize;
 
-							testGlobalPNodeNum[pfront->childEntries[j]->stageidx]++;
+							testGlobalPNodeNum[_map.stage(pfront->childEntries[j]->id)]++;
 
 							pqueue.push(pfront->childEntries[j]);
 						}
@@ -1218,9 +1353,15 @@ public:
 
 	/// \brief Scatter nodes in a random pipe line.
 	///
-	/// Use different generator to produce random number for distributing primary nodes and 
-	/// secondary nodes.
-	void ran(int _stagenum) {
+	/// Use a placer to distribute primary nodes and secondary nodes. The placer is weighted by the size of 
+	/// a primary/secondary node.
+	///
+	/// \param _ranpolicy 0, 1 or 2 for uniform, power-of-two-choices or greedy least-loaded placement, respectively (see StagePlacer)
+	void ran(StageMap& _map, int _stagenum, int _ranpolicy = 0) {
+
+		const size_t pnodeSize = pnode_type::getSize(); // nexthops as wide as the IDs interned so far
+
+		const size_t snodeSize = snode_type::getSize();
 
 		size_t* memUseInStage = new size_t[_stagenum];
 
@@ -1237,34 +1378,20 @@ public:
 			testGlobalSNodeNum[i] = 0;
 		}
 
-		// random generator for pnode
-		unsigned seed_pnode = std::chrono::system_clock::now().time_since_epoch().count();
-
-		std::default_random_engine generator_pnode(seed_pnode);
-
-		std::uniform_int_distribution<int> distribution_pnode(0, _stagenum - 1);
-
-		auto roll_pnode = std::bind(distribution_pnode, generator_pnode);
-
-		// random generator for snode
-		unsigned seed_snode = std::chrono::system_clock::now().time_since_epoch().count() + 1000000;
-
-		std::default_random_engine generator_snode(seed_snode);
-
-		std::uniform_int_distribution<int> distribution_snode(0, _stagenum - 1);
+		StagePlacer placer(_stagenum, _ranpolicy);
 
-		auto roll_snode = std::bind(distribution_snode, generator_snode);
+		placer.reportPolicy();
 
 		// start numbering nodes
 		for (size_t i = 0; i < V; ++i) {
 
 			if (nullptr != mRootTable[i]) { // pRoot is not null
 
-				mRootTable[i]->stageidx = roll_pnode(); // roll
+				_map.stage(mRootTable[i]->id) = placer.place(pnodeSize); // place
 
-				memUseInStage[mRootTable[i]->stageidx] += PNode<W, K>::size;
+				memUseInStage[_map.stage(mRootTable[i]->id)] += pnodeSize;
 				
-				testGlobalPNodeNum[mRootTable[i]->stageidx]++;	
+				testGlobalPNodeNum[_map.stage(mRootTable[i]->id)]++;	
 
 				std::queue<pnode_type*> pqueue;
 
@@ -1277,11 +1404,11 @@ public:
 					// auxiliary tree
 					if (nullptr != pfront->sRoot) {
 
-						pfront->sRoot->stageidx = roll_snode(); // roll  
+						_map.stage(pfront->sRoot->id) = placer.place(snodeSize, _map.stage(pfront->id)); // place
 
-						memUseInStage[pfront->sRoot->stageidx] += SNode<W>::size;
+						memUseInStage[_map.stage(pfront->sRoot->id)] += snodeSize;
 
-						testGlobalSNodeNum[pfront->sRoot->stageidx]++;
+						testGlobalSNodeNum[_map.stage(pfront->sRoot->id)]++;
 
 						std::queue<snode_type*> squeue;
 	
@@ -1293,22 +1420,22 @@ public:
 							
 							if (nullptr != sfront->lchild) {
 
-								sfront->lchild->stageidx = roll_snode(); // roll
+								_map.stage(sfront->lchild->id) = placer.place(snodeSize, _map.stage(sfront->id)); // place
 
-								memUseInStage[sfront->lchild->stageidx] += SNode<W>::size;
+								memUseInStage[_map.stage(sfront->lchild->id)] += snodeSize;
 
-								testGlobalSNodeNum[sfront->lchild->stageidx]++;
+								testGlobalSNodeNum[_map.stage(sfront->lchild->id)]++;
 
 								squeue.push(sfront->lchild);
 							}
 
 							if (nullptr != sfront->rchild) {
 
-								sfront->rchild->stageidx = roll_snode(); // roll
+								_map.stage(sfront->rchild->id) = placer.place(snodeSize, _map.stage(sfront->id)); // place
 
-								memUseInStage[sfront->rchild->stageidx] += SNode<W>::size;
+								memUseInStage[_map.stage(sfront->rchild->id)] += snodeSize;
 
-								testGlobalSNodeNum[sfront->rchild->stageidx]++;
+								testGlobalSNodeNum[_map.stage(sfront->rchild->id)]++;
 
 								squeue.push(sfront->rchild);
 							}
@@ -1322,11 +1449,11 @@ public:
 
 						if(nullptr != pfront->childEntries[j]) {
 
-							pfront->childEntries[j]->stageidx = roll_pnode(); // roll
+							_map.stage(pfront->childEntries[j]->id) = placer.place(pnodeSize, _map.stage(pfront->id)); // place
 
-							memUseInStage[pfront->childEntries[j]->stageidx] += PNode<W, K>::size;
+							memUseInStage[_map.stage(pfront->childEntries[j]->id)] += pnodeSize;
 
-							testGlobalPNodeNum[pfront->childEntries[j]->stageidx]++;
+							testGlobalPNodeNum[_map.stage(pfront->childEntries[j]->id)]++;
 
 							pqueue.push(pfront->childEntries[j]);
 						}
@@ -1370,6 +1497,8 @@ public:
 		std::cerr << "pnode number in all stages: " << pnodeNumInAllStages << std::endl;
 		std::cerr << "snode number in all stages: " << snodeNumInAllStages << std::endl;
 
+		std::cerr << "mem use in the largest stage: " << placer.getMaxMemUse() << std::endl;
+
 		delete[] memUseInStage;
 
 		delete[] testGlobalPNodeNum;
@@ -1408,7 +1537,11 @@ public:
 
 	/// \brief Scatter in a circular pipeline
 	/// \note abandon
-	void cir(int _stagenum) {
+	void cir(StageMap& _map, int _stagenum) {
+
+		const size_t pnodeSize = pnode_type::getSize(); // nexthops as wide as the IDs interned so far
+
+		const size_t snodeSize = snode_type::getSize();
 
 		size_t* memUseInStage = new size_t[_stagenum];
 
@@ -1433,7 +1566,7 @@ public:
 
 			if (nullptr != mRootTable[i]) {
 
-				size_t treeSize = mLocalPNodeNum[i] * PNode<W, K>::size + mLocalSNodeNum[i] * SNode<W>::size;
+				size_t treeSize = mLocalPNodeNum[i] * pnodeSize + mLocalSNodeNum[i] * snodeSize;
 
 				vec.push_back(SortElem(treeSize, i));
 			}
@@ -1441,83 +1574,45 @@ public:
 
 		std::sort(std::begin(vec), std::end(vec));
 
-		// step 2: scatter nodes 
-		size_t* colored = new size_t[_stagenum];
-
-		for (int i = 0; i < _stagenum; ++i) colored[i] = 0;
-
-		size_t* trycolor = new size_t[_stagenum];
+		// step 2: choose the start stage for each tree, larger-size tree first
+		CirPlacer placer(_stagenum);
 
-		for (int i = 0; i < _stagenum; ++i)  trycolor[i] = 0;
+		std::vector<int> startIdx(vec.size(), 0);
 
-		int bestStartIdx = 0; // the most proper stage that accommodate the root node
+		size_t levelMem[H2]; // mem use of a tree at each level
 
 		for (int i = vec.size() - 1; i >= 0; --i) {
 
 			size_t treeIdx = vec[i].treeIdx;
 
-			double bestVar = std::numeric_limits<double>::max();
-
-			for (size_t j = 0; j < _stagenum; ++j) {
-
-				// reset
-				for (size_t k = 0; k < _stagenum; ++k) {
-
-					trycolor[k] = colored[k];
-				}
-
-				// add primary nodes
-				for (size_t k = 0; k < H1; ++k) {
-
-					trycolor[(j + k) % _stagenum] += mLocalLevelPNodeNum[treeIdx][k] * PNode<W, K>::size;
-				}
+			for (int k = 0; k < H2; ++k) {
 
-				// add auxiliary nodes
-				for (size_t k = 0; k < H2; ++k) {
+				levelMem[k] = mLocalLevelSNodeNum[treeIdx][k] * snodeSize; // add secondary nodes
 
-					trycolor[(j + k) % _stagenum] += mLocalLevelSNodeNum[treeIdx][k] * SNode<W>::size;
-				}
+				if (k < H1) levelMem[k] += mLocalLevelPNodeNum[treeIdx][k] * pnodeSize; // add primary nodes
+			}
 
-				// compute variance
-				double sum = std::accumulate(trycolor, trycolor + _stagenum, 0.0);
+			startIdx[i] = placer.place(levelMem, H2);
 
-				double mean = sum / _stagenum;
+			// a node at level k is located at stage (start + k) % _stagenum, both for pnodes and snodes
+			for (int k = 0; k < H2; ++k) {
 
-				double accum = 0.0;
+				int stageidx = (startIdx[i] + k) % _stagenum;
 
-				for (int k = 0; k < _stagenum; ++k) {
+				memUseInStage[stageidx] += levelMem[k];
 
-					accum += (trycolor[k] - mean) * (trycolor[k] - mean);
-				}
-				
-				double var = accum / _stagenum;
-
-				if (var < bestVar) {
-					
-					bestVar = var;
+				testGlobalSNodeNum[stageidx] += mLocalLevelSNodeNum[treeIdx][k];
 
-					bestStartIdx = j;
-				}
-			}	
-
-			// add primary nodes
-			for (int j = 0; j < H1; ++j) {
-
-				trycolor[(bestStartIdx + j) % _stagenum] += mLocalLevelPNodeNum[treeIdx][j] * PNode<W, K>::size;
-			}
-
-			// add secondary nodes
-			for (int j = 0; j < H2; ++j) {
-
-				trycolor[(bestStartIdx + j) % _stagenum] += mLocalLevelSNodeNum[treeIdx][j] * SNode<W>::size;
+				if (k < H1) testGlobalPNodeNum[stageidx] += mLocalLevelPNodeNum[treeIdx][k];
 			}
+		}
 
-			// color nodes in current tree
-			mRootTable[treeIdx]->stageidx = bestStartIdx;
+		// step 3: color nodes in the trees, trees are independent of each other
+		utility::parallelFor(vec.size(), [&](const size_t i) {
 
-			memUseInStage[mRootTable[treeIdx]->stageidx] += PNode<W, K>::size;
+			size_t treeIdx = vec[i].treeIdx;
 
-			testGlobalPNodeNum[mRootTable[treeIdx]->stageidx]++;
+			_map.stage(mRootTable[treeIdx]->id) = startIdx[i];
 
 			std::queue<pnode_type*> pqueue;
 
@@ -1529,12 +1624,8 @@ public:
 			
 				if (nullptr != pfront->sRoot) {
 
-					pfront->sRoot->stageidx = (pfront->stageidx + 1) % _stagenum; // stage of sRoot is next to that of pRoot
-
-					memUseInStage[pfront->sRoot->stageidx] += SNode<W>::size;
+					_map.stage(pfront->sRoot->id) = (_map.stage(pfront->id) + 1) % _stagenum; // stage of sRoot is next to that of pRoot
 
-					testGlobalSNodeNum[pfront->sRoot->stageidx]++;
-	
 					std::queue<snode_type*> squeue;
 
 					squeue.push(pfront->sRoot);
@@ -1545,22 +1636,14 @@ public:
 
 						if (nullptr != sfront->lchild) {
 
-							sfront->lchild->stageidx = (sfront->stageidx + 1) % _stagenum; // in sequence
-
-							memUseInStage[sfront->lchild->stageidx] += SNode<W>::size;
-
-							testGlobalSNodeNum[sfront->lchild->stageidx]++;
+							_map.stage(sfront->lchild->id) = (_map.stage(sfront->id) + 1) % _stagenum; // in sequence
 
 							squeue.push(sfront->lchild);
 						}
 
 						if (nullptr != sfront->rchild) {
 
-							sfront->rchild->stageidx = (sfront->stageidx + 1) % _stagenum; // in sequence
-
-							memUseInStage[sfront->rchild->stageidx] += SNode<W>::size;
-
-							testGlobalSNodeNum[sfront->rchild->stageidx]++;
+							_map.stage(sfront->rchild->id) = (_map.stage(sfront->id) + 1) % _stagenum; // in sequence
 
 							squeue.push(sfront->rchild);
 						}
@@ -1574,11 +1657,7 @@ public:
 
 					if (nullptr != pfront->childEntries[j]) {
 
-						pfront->childEntries[j]->stageidx = (pfront->stageidx + 1) % _stagenum;
-
-						memUseInStage[pfront->childEntries[j]->stageidx] += PNode<W, K>::size;
-
-						testGlobalPNodeNum[pfront->childEntries[j]->stageidx]++;
+						_map.stage(pfront->childEntries[j]->id) = (_map.stage(pfront->id) + 1) % _stagenum;
 
 						pqueue.push(pfront->childEntries[j]);
 					}
@@ -1586,7 +1665,7 @@ public:
 
 				pqueue.pop();
 			}
-		}
+		});
 
 		// output information
 		size_t pnodeNumInAllStages = 0;
@@ -1629,15 +1708,16 @@ public:
 
 		delete[] testGlobalSNodeNum;
 
-		delete[] colored;
-
-		delete[] trycolor;
-
 		return;
 	}
 
 	/// \brief Update the index 
-	void update(const std::string & _fn, int _stagenum = W - U + 1) {
+	///
+	/// \param _map mapping in which the new nodes are placed, nullptr for the own mapping of the index.
+	/// The other mappings do not cover the new nodes, and are to be scattered again before their traces are generated.
+	void update(const std::string & _fn, int _stagenum = W - U + 1, StageMap* _map = nullptr) {
+
+		if (nullptr == _map) _map = &mStageMap;
 
 		size_t withdrawnum = 0;
 
@@ -1670,6 +1750,10 @@ public:
 		std::uniform_int_distribution<int> distribution_s(0, _stagenum - 1);
 
 
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("RMPTree", {W, K, U}, "update"));
+
+		counter.start();
+
 		// retrieve
 		while (getline(fin, line)) {
 
@@ -1686,13 +1770,15 @@ public:
 
 				++announcenum;
 
-				nexthop = length;
+				nexthop = utility::retrieveNexthop(line, length); // interned nexthop if given, or the length (for test only)
 
-				ins(prefix, length, nexthop, generator_p, distribution_p, generator_s, distribution_s);
+				ins(prefix, length, nexthop, generator_p, distribution_p, generator_s, distribution_s, *_map);
 			}
 		}		
 
-		reportNodeNumInStage(_stagenum);
+		counter.stop(withdrawnum + announcenum);
+
+		reportNodeNumInStage(_stagenum, _map);
 
 		std::cerr << "withdraw num: " << withdrawnum << " announce num: " << announcenum << std::endl;
 
@@ -1701,7 +1787,7 @@ public:
 
 
 	/// \brief for update, insert into index 
-	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, std::default_random_engine& _generator_p, std::uniform_int_distribution<int>& _distribution_p, std::default_random_engine& _generator_s, std::uniform_int_distribution<int>& _distribution_s) {
+	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, std::default_random_engine& _generator_p, std::uniform_int_distribution<int>& _distribution_p, std::default_random_engine& _generator_s, std::uniform_int_distribution<int>& _distribution_s, StageMap& _map) {
 
 		if (_length < U) { // insert into the fast table
 
@@ -1709,20 +1795,24 @@ public:
 		}
 		else { // insert into the MPT forest
 
-			ins(_prefix, _length, _nexthop, mRootTable[utility::getBitsValue(_prefix, 0, U - 1)], 0, utility::getBitsValue(_prefix, 0, U - 1), _generator_p, _distribution_p, _generator_s, _distribution_s);
+			ins(_prefix, _length, _nexthop, mRootTable[utility::getBitsValue(_prefix, 0, U - 1)], 0, utility::getBitsValue(_prefix, 0, U - 1), _generator_p, _distribution_p, _generator_s, _distribution_s, _map);
 		}
 		
 		return;
 	} 
 
 	/// \brief for update, insert into MPT forest
-	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, pnode_type*& _pnode, const int _level, const uint32 _treeIdx, std::default_random_engine& _generator_p, std::uniform_int_distribution<int>& _distribution_p, std::default_random_engine& _generator_s, std::uniform_int_distribution<int>& _distribution_s) {
+	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, pnode_type*& _pnode, const int _level, const uint32 _treeIdx, std::default_random_engine& _generator_p, std::uniform_int_distribution<int>& _distribution_p, std::default_random_engine& _generator_s, std::uniform_int_distribution<int>& _distribution_s, StageMap& _map) {
 
 		if (nullptr == _pnode) { // node is empty, create the node
 
 			_pnode = new pnode_type();
 
-			_pnode->stageidx = _distribution_p(_generator_p); // randomly allocated
+			_pnode->id = mNodeIdNum++;
+
+			_map.resize(mNodeIdNum);
+
+			_map.stage(_pnode->id) = _distribution_p(_generator_p); // randomly allocated
 	
 			++mLocalPNodeNum[_treeIdx]; // primary nodes in current MPT
 
@@ -1732,7 +1822,7 @@ public:
 		if (_length < U + (_level + 1) * K) { // [U, U + (_level + 1) * K - 1], in this level
 
 			// current prefix must be inserted into the auxiliary prefix tree
-			ins(_prefix, _length, _nexthop, _pnode->sRoot, 0, _level, _treeIdx, _generator_s, _distribution_s);
+			ins(_prefix, _length, _nexthop, _pnode->sRoot, 0, _level, _treeIdx, _generator_s, _distribution_s, _map);
 		}
 		else { // insert the prefix into current primary node or a node in a higher level
 
@@ -1759,14 +1849,14 @@ public:
 					insertPrefixInPNode(_pnode, _prefix, _length, _nexthop);
 
 					// recursively insert the prefix deleted from the primary node into a higher level
-					ins(prefix, length, nexthop, _pnode->childEntries[utility::getBitsValue(prefix, U + _level * K, U + (_level + 1) * K - 1)], _level + 1, _treeIdx, _generator_p, _distribution_p, _generator_s, _distribution_s);
+					ins(prefix, length, nexthop, _pnode->childEntries[utility::getBitsValue(prefix, U + _level * K, U + (_level + 1) * K - 1)], _level + 1, _treeIdx, _generator_p, _distribution_p, _generator_s, _distribution_s, _map);
 						
 				}
 				else {
 				
 					// insert prefix into a node in a higher level
 
-					ins(_prefix, _length, _nexthop, _pnode->childEntries[utility::getBitsValue(_prefix, U + _level * K, U + (_level + 1) * K - 1)], _level + 1, _treeIdx, _generator_p, _distribution_p, _generator_s, _distribution_s);	
+					ins(_prefix, _length, _nexthop, _pnode->childEntries[utility::getBitsValue(_prefix, U + _level * K, U + (_level + 1) * K - 1)], _level + 1, _treeIdx, _generator_p, _distribution_p, _generator_s, _distribution_s, _map);	
 				}
 			}
 		}
@@ -1775,14 +1865,18 @@ public:
 	}	
 
 	/// \brief for update, insert into the auxiliary tree.
-	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, snode_type*& _snode, const int _sLevel, const int _pLevel, const uint32 _treeIdx, std::default_random_engine& _generator_s, std::uniform_int_distribution<int>& _distribution_s) {
+	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, snode_type*& _snode, const int _sLevel, const int _pLevel, const uint32 _treeIdx, std::default_random_engine& _generator_s, std::uniform_int_distribution<int>& _distribution_s, StageMap& _map) {
 
 		if (nullptr == _snode) { // empty
 
 			// create a new secondary node
 			_snode = new snode_type();
 
-			_snode->stageidx = _distribution_s(_generator_s); // randomly allocated
+			_snode->id = mNodeIdNum++;
+
+			_map.resize(mNodeIdNum);
+
+			_map.stage(_snode->id) = _distribution_s(_generator_s); // randomly allocated
 
 			mLocalSNodeNum[_treeIdx]++;	
 
@@ -1820,11 +1914,11 @@ public:
 					// recursively insert the replaced prefix
 					if (0 == utility::getBitValue(prefix, U + _pLevel * K + _sLevel)) {
 
-						ins(prefix, length, nexthop, _snode->lchild, _sLevel + 1, _pLevel, _treeIdx, _generator_s, _distribution_s);
+						ins(prefix, length, nexthop, _snode->lchild, _sLevel + 1, _pLevel, _treeIdx, _generator_s, _distribution_s, _map);
 					}
 					else {
 
-						ins(prefix, length, nexthop, _snode->rchild, _sLevel + 1, _pLevel, _treeIdx, _generator_s, _distribution_s);
+						ins(prefix, length, nexthop, _snode->rchild, _sLevel + 1, _pLevel, _treeIdx, _generator_s, _distribution_s, _map);
 					}	
 				}
 				else { // prefix in current node must be equal to the one to be inserted
@@ -1836,11 +1930,11 @@ public:
 
 				if (0 == utility::getBitValue(_prefix, U + _pLevel * K + _sLevel)) {
 
-					ins(_prefix, _length, _nexthop, _snode->lchild, _sLevel + 1, _pLevel, _treeIdx, _generator_s, _distribution_s); 
+					ins(_prefix, _length, _nexthop, _snode->lchild, _sLevel + 1, _pLevel, _treeIdx, _generator_s, _distribution_s, _map); 
 				}
 				else {
 
-					ins(_prefix, _length, _nexthop, _snode->rchild, _sLevel + 1, _pLevel, _treeIdx, _generator_s, _distribution_s);
+					ins(_prefix, _length, _nexthop, _snode->rchild, _sLevel + 1, _pLevel, _treeIdx, _generator_s, _distribution_s, _map);
 				}
 			}
 		}
@@ -1849,7 +1943,11 @@ public:
 	}
 
 	/// \brief report number of nodes in each stage
-	void reportNodeNumInStage(int _stagenum) {
+	///
+	/// \param _map mapping of the nodes, nullptr for the own mapping of the index
+	void reportNodeNumInStage(int _stagenum, const StageMap* _map = nullptr) {
+
+		if (nullptr == _map) _map = &mStageMap;
 
 		size_t* pnodeNumInStage = new size_t[_stagenum];
 
@@ -1880,7 +1978,7 @@ public:
 
 					auto pfront = pqueue.front();
 
-					pnodeNumInStage[pfront->stageidx]++;
+					pnodeNumInStage[_map->stage(pfront->id)]++;
 
 					// traverse auxiliary tree	
 					if (nullptr != pqueue.front()->sRoot) {
@@ -1893,7 +1991,7 @@ public:
 
 							auto sfront = squeue.front();
 
-							snodeNumInStage[sfront->stageidx]++;
+							snodeNumInStage[_map->stage(sfront->id)]++;
 
 							if (nullptr != sfront->lchild) squeue.push(sfront->lchild);
 
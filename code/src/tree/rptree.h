@@ -17,8 +17,17 @@
 
 #include "../common/common.h"
 #include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/accesslog.h"
 
 #include "fasttable.h"
+#include "stageplacer.h"
+#include "cirplacer.h"
+#include "bankmapper.h"
+#include "stagemap.h"
+#include "tracegen.h"
+#include "tracer.h"
+#include "../common/parallel.h"
 
 #include <queue>
 #include <cmath>
@@ -44,10 +53,10 @@ struct PNode{
 
 	uint32 nexthop; ///< next hop	
 
-	int stageidx; ///< location in pipe stage
+	uint32 id; ///< node ID, indexing the stage mappings (see StageMap)
 
 	/// \brief ctor
-	PNode() : lchild(nullptr), rchild(nullptr), prefix(0), length(0), nexthop(0) {}
+	PNode() : lchild(nullptr), rchild(nullptr), prefix(0), length(0), nexthop(0), id(0) {}
 
 };
 
@@ -77,10 +86,16 @@ private:
 
 	FastTable<W, U - 1> ft;
 
+	StageMap mStageMap; ///< mapping of the nodes to the stages, used if no other mapping is given
+
+	uint32 mNodeIdNum; ///< number of node IDs given, the ID of the next node created
+
+	utility::AccessLog* mAccessLog; ///< log of the memory accesses of search(), nullptr for none
+
 public:
 
 	/// \brief default ctor
-	RPTree() {
+	RPTree() : mAccessLog(nullptr) {
 
 		initializeParameters();
 	}
@@ -90,6 +105,10 @@ public:
 
 		mTotalNodeNum = 0;
 
+		mStageMap.clear();
+
+		mNodeIdNum = 0;
+
 		for (size_t i = 0; i < V; ++i) {
 
 			mRootTable[i] = nullptr;
@@ -141,40 +160,43 @@ public:
 	/// \brief Build the index.
 	void build(const std::string& _fn) {
 
-		// clear old index if there exists any
-		clear();
+		std::vector<utility::Route<W> > table;
 
-		// initialize 
-		initializeParameters();
+		utility::loadTable<W>(_fn, table);
 
-		// insert prefixes into ptree one by one
-		std::ifstream fin(_fn, std::ios_base::binary);
+		build(table);
 
-		std::string line;
+		return;
+	}
 
-		ip_type prefix;
+	/// \brief Build the index from a parsed table, e.g., shared by several indexes.
+	void build(const std::vector<utility::Route<W> >& _table) {
 
-		uint8 length;
+		// clear old index if there exists any
+		clear();
 
-		uint32 nexthop;
+		// initialize
+		initializeParameters();
 
-		while(getline(fin, line)) {
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("RPTree", {W, U}, "build"));
 
-			// retrieve prefix and length
-			utility::retrieveInfo(line, prefix, length);
+		counter.start();
 
-			nexthop = length;
+		// insert prefixes into ptree one by one
+		for (auto& route : _table) {
 
-			if (0 == length) { // */0
+			if (0 == route.length) { // */0
 
 				// do nothing
 			}
 			else {
 
-				ins(prefix, length, nexthop);
+				ins(route.prefix, route.length, route.nexthop);
 			}
 		}
 
+		counter.stop(_table.size());
+
 		report();
 
 		//traverse();	
@@ -251,6 +273,8 @@ public:
 			// create a node
 			_node = new node_type();
 
+			_node->id = mNodeIdNum++;
+
 			++mNodeNum[_treeIdx];
 
 			++mLevelNodeNum[_treeIdx][_level - U];
@@ -360,12 +384,41 @@ public:
 	}
 
 
-	/// \brief Search LPM for target IP address.
-	///
-	/// Record trace in the vector.
+	/// \brief attach a log of the memory accesses of search(), nullptr to detach
+	void setAccessLog(utility::AccessLog* _log) {
+
+		mAccessLog = _log;
+	}
+
+	/// \brief search LPM for target IP address, without the trace
 	///
+	/// The memory accesses are logged if a log is attached, otherwise nothing is traced, i.e., search() with NullTracer.
+	uint32 search(const ip_type& _ip) {
+
+		if (nullptr != mAccessLog) {
+
+			AddressTracer tracer(*mAccessLog);
+
+			return search(_ip, tracer);
+		}
+
+		NullTracer tracer;
+
+		return search(_ip, tracer);
+	}
+
+	/// \brief search LPM for target IP address, with the node IDs visited appended to the trace
 	uint32 search(const ip_type& _ip, std::vector<int>& _trace) {
 
+		StageTracer tracer(_trace);
+
+		return search(_ip, tracer);
+	}
+
+	/// \brief Search LPM for target IP address, traced by a tracer (see tracer.h).
+	template<typename R>
+	uint32 search(const ip_type& _ip, R& _tracer) {
+
 		// try to find a match in the fast lookup table
 		uint32 nexthop1 = 0;
 
@@ -374,6 +427,10 @@ public:
 		// try to find a match in the forest of prefix trees
 		uint32 nexthop2 = 0;
 
+		_tracer.access(&ft.mEntries[utility::getBitsValue(_ip, 0, U - 1)], sizeof(ft.mEntries[0]));
+
+		_tracer.access(&mRootTable[utility::getBitsValue(_ip, 0, U - 1)], sizeof(node_type*));
+
 		node_type* node = mRootTable[utility::getBitsValue(_ip, 0, U - 1)];
 
 		int level = U;
@@ -382,7 +439,9 @@ public:
 
 		while (nullptr != node) {
 
-			_trace.push_back(node->stageidx);
+			_tracer.step(node->id); // mapped to stage and bank by a StageMap
+
+			_tracer.access(node, sizeof(node_type));
 
 			if (utility::getBitsValue(_ip, 0, node->length - 1) == utility::getBitsValue(node->prefix, 0, node->length - 1)) {
 
@@ -419,54 +478,28 @@ public:
 	/// \brief generate lookup trace for simulation
 	void generateTrace (const std::string& _reqFile, const std::string& _traceFile, const uint32 _stageNum){
 
-		std::ifstream reqFin(_reqFile, std::ios_base::binary);
-
-		std::string line;
-
-		ip_type prefix;
-
-		std::ofstream traFin(_traceFile, std::ios_base::binary);	
-		
-		size_t searchNum = 0;
+		generateTrace(_reqFile, std::vector<TraceOutput>(1, TraceOutput(&mStageMap, _traceFile, _stageNum)));
 
-		double avgSearchDepth = 0;
+		return;
+	}
 
-		while (getline(reqFin, line)) {
+	/// \brief generate lookup traces under several mappings in one pass
+	///
+	/// Each request is searched once, and its steps are written to each trace file as mapped by the mapping of the file.
+	void generateTrace (const std::string& _reqFile, const std::vector<TraceOutput>& _outputs){
 
-			std::vector<int> trace;
+		// the requests are searched on the worker threads, see TraceGenerator
+		TraceGenerator<ip_type> generator;
 
-			std::stringstream ss(line);
+		generator.run(_reqFile, _outputs, utility::getPerfName("RPTree", {W, U}, "traced search"), [this](const ip_type& _ip, TraceBatch& _batch) {
 
-			ss >> prefix;
-			
 			// generate trace while performing the lookup request
-			search(prefix, trace);
-
-			// collect search depth
-			++searchNum;
-
-			avgSearchDepth += trace.size();
-		 
-			// output trace to file	
-			traFin << static_cast<size_t>(trace.size());
-
-			traFin << " ";
-	
-			// record stage list
-			for (int i = 0; i < trace.size(); ++i) {
-			
-				traFin << static_cast<size_t>(trace[i]);		
+			search(_ip, _batch.steps);
+		});
 
-				traFin << " ";
-			}
-	
-			//
-			traFin << "\n";
-		}
-	
-		avgSearchDepth /= searchNum; 
+		double avgSearchDepth = generator.getAvgSearchDepth(); 
 
-		std::cerr << "workload: " << LAMBDA * BURSTSIZE * avgSearchDepth / _stageNum << std::endl;
+		for (auto& output : _outputs) std::cerr << "workload: " << LAMBDA * BURSTSIZE * avgSearchDepth / output.stageNum << std::endl;
 
 		std::cerr << "average search depth: " << avgSearchDepth << std::endl;		
 
@@ -603,19 +636,75 @@ public:
 	/// \brief Scatter nodes in binary trees according to a pipeline
 	///
 	/// Three types of pipelines are considered: linear, cirular and random
+	/// For a random pipeline, _ranpolicy selects the placement policy (see StagePlacer).
+	/// The memory of each stage is split into _banknum banks (see BankMapper), 
+	/// then the traces give stage * _banknum + bank for each step.
 	/// 
-	void scatterToPipeline(int _pipestyle, int _stagenum = W - U + 1){
+	void scatterToPipeline(int _pipestyle, int _stagenum = W - U + 1, int _ranpolicy = 0, int _banknum = 1){
+
+		scatterToPipeline(mStageMap, _pipestyle, _stagenum, _ranpolicy, _banknum);
+
+		return;
+	}
+
+	/// \brief Scatter nodes into a mapping of its own, apart from the other mappings of the index
+	void scatterToPipeline(StageMap& _map, int _pipestyle, int _stagenum = W - U + 1, int _ranpolicy = 0, int _banknum = 1){
+
+		_map.resize(mNodeIdNum);
+
+		_map.setPipeline(_stagenum, _banknum);
 
 	 	switch(_pipestyle) {
 
-		case 0: lin(_stagenum); break;
+		case 0: lin(_map, _stagenum); break;
 
-		case 1: ran(_stagenum); break;
+		case 1: ran(_map, _stagenum, _ranpolicy); break;
 
-		case 2: cir(_stagenum); break;
+		case 2: cir(_map, _stagenum); break;
 
 		}	
 
+		mapToBanks(_map, _stagenum, _banknum);
+
+		return;
+	}
+
+	/// \brief mapping of the nodes to the stages, used if no other mapping is given
+	StageMap& getStageMap() {
+
+		return mStageMap;
+	}
+
+	/// \brief Map nodes into the memory banks of their pipe stages.
+	void mapToBanks(StageMap& _map, int _stagenum, int _banknum) {
+
+		BankMapper mapper(_stagenum, _banknum);
+
+		for (size_t i = 0; i < V; ++i) {
+
+			if (nullptr != mRootTable[i]) {
+
+				std::queue<node_type*> queue;
+
+				queue.push(mRootTable[i]);
+
+				while (!queue.empty()) {
+
+					auto front = queue.front();
+
+					_map.bank(front->id) = mapper.map(_map.stage(front->id));
+
+					if (nullptr != front->lchild) queue.push(front->lchild);
+
+					if (nullptr != front->rchild) queue.push(front->rchild);
+
+					queue.pop();
+				}
+			}
+		}
+
+		if (_banknum > 1) mapper.report();
+
 		return;
 	}
 
@@ -624,7 +713,7 @@ public:
 	/// Map nodes into a linear pipe line in a manner of one level per stage.
 	///
 	/// \note the number of stages is W - U + 1 for a linear pipe line.
-	void lin(int _stagenum) {
+	void lin(StageMap& _map, int _stagenum) {
 		
 		size_t* nodeNumInStage = new size_t[_stagenum];
 
@@ -640,7 +729,7 @@ public:
 
 				std::queue<node_type*> queue;
 
-				mRootTable[i]->stageidx = 0;
+				_map.stage(mRootTable[i]->id) = 0;
 
 				nodeNumInStage[0]++;
 
@@ -652,18 +741,18 @@ public:
 
 					if (nullptr != front->lchild) {
 
-						front->lchild->stageidx = front->stageidx + 1; // increment 1
+						_map.stage(front->lchild->id) = _map.stage(front->id) + 1; // increment 1
 
-						nodeNumInStage[front->lchild->stageidx]++; 
+						nodeNumInStage[_map.stage(front->lchild->id)]++; 
 						
 						queue.push(front->lchild);
 					}								
 
 					if (nullptr != front->rchild) {
 
-						front->rchild->stageidx = front->stageidx + 1; // increment 1
+						_map.stage(front->rchild->id) = _map.stage(front->id) + 1; // increment 1
 
-						nodeNumInStage[front->rchild->stageidx]++;
+						nodeNumInStage[_map.stage(front->rchild->id)]++;
 
 						queue.push(front->rchild);
 					}
@@ -711,9 +800,10 @@ public:
 
 	/// \brief Scatter in a random pipeline.
 	///
-	/// Map nodes into a random pipeline. A random generator is applied to determine the pipe stage to where a node is allocated.
+	/// Map nodes into a random pipeline. A placer is applied to determine the pipe stage to where a node is allocated.
 	///
-	void ran(int _stagenum) {
+	/// \param _ranpolicy 0, 1 or 2 for uniform, power-of-two-choices or greedy least-loaded placement, respectively (see StagePlacer)
+	void ran(StageMap& _map, int _stagenum, int _ranpolicy = 0) {
 
 		size_t* nodeNumInStage = new size_t[_stagenum];
 
@@ -722,13 +812,10 @@ public:
 			nodeNumInStage[i] = 0;
 		}
 
-		unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-
-		std::default_random_engine generator(seed);
-
-		std::uniform_int_distribution<int> distribution(0, _stagenum - 1);
+		// all nodes are of the same size, thus memory in use is measured in nodes
+		StagePlacer placer(_stagenum, _ranpolicy);
 
-		auto roll = std::bind(distribution, generator);
+		placer.reportPolicy();
 
 		for (size_t i = 0; i < V; ++i) {
 
@@ -736,9 +823,9 @@ public:
 
 				std::queue<node_type*> queue;
 
-				mRootTable[i]->stageidx = roll();
+				_map.stage(mRootTable[i]->id) = placer.place(1);
 
-				nodeNumInStage[mRootTable[i]->stageidx]++;
+				nodeNumInStage[_map.stage(mRootTable[i]->id)]++;
 
 				queue.push(mRootTable[i]);
 
@@ -748,18 +835,18 @@ public:
 
 					if (nullptr != front->lchild) {
 
-						front->lchild->stageidx = roll(); // roll
+						_map.stage(front->lchild->id) = placer.place(1, _map.stage(front->id)); // place
 
-						nodeNumInStage[front->lchild->stageidx]++;
+						nodeNumInStage[_map.stage(front->lchild->id)]++;
 
 						queue.push(front->lchild);
 					}								
 
 					if (nullptr != front->rchild) {
 
-						front->rchild->stageidx = roll(); // roll
+						_map.stage(front->rchild->id) = placer.place(1, _map.stage(front->id)); // place
 
-						nodeNumInStage[front->rchild->stageidx]++;
+						nodeNumInStage[_map.stage(front->rchild->id)]++;
 
 						queue.push(front->rchild);
 					}
@@ -800,6 +887,8 @@ public:
 	
 		std::cerr << "min ratio: " << min_ratio << " max ratio: " << max_ratio << " mean ratio: " << mean_ratio << std::endl;	
 
+		std::cerr << "nodes in the largest stage: " << placer.getMaxMemUse() << std::endl;
+
 		delete[] nodeNumInStage;
 
 		return;
@@ -832,8 +921,8 @@ public:
 	/// \brief Scatter in a circular pipe line.
 	///
 	/// Scatter nodes into a circular pipe line according to method proposed by Sailesh Karmar et al.
-	/// we use variance to make heuristic.
-	void cir(int _stagenum) {
+	/// we use variance to make heuristic (see CirPlacer).
+	void cir(StageMap& _map, int _stagenum) {
 
 		// step 1: sort binary tries by their size in non-decreasing order
 		std::vector<SortElem> vec;
@@ -848,71 +937,24 @@ public:
 
 		std::sort(std::begin(vec), std::end(vec));		
 
-		// step 2: scatter nodes
-		size_t* colored = new size_t[_stagenum];
-
-		for (int i = 0; i < _stagenum; ++i) colored[i]= 0;
+		// step 2: choose the start stage for each tree, larger-size tree first
+		CirPlacer placer(_stagenum);
 
-		size_t* trycolor = new size_t[_stagenum];
+		std::vector<int> startIdx(vec.size(), 0);
 
-		for (int i = 0; i < _stagenum; ++i) trycolor[i] = 0;
-
-		int bestStartIdx = 0;
-
-		for (int i = vec.size() - 1; i >= 0; --i) { // larger-size tree first
+		for (int i = vec.size() - 1; i >= 0; --i) {
 		
-			size_t treeIdx = vec[i].treeIdx;
-
-			double bestVar = std::numeric_limits<double>::max();
-
-			for (size_t j = 0; j < _stagenum; ++j) { // try to put the root node at j-th pipe stage
-
-				for (size_t k = 0; k < _stagenum; ++k) { // reset 
-
-					trycolor[k] = colored[k];
-				}
-	
-				for (size_t k = 0; k < W - U + 1; ++k) { // put nodes one level per stage
-
-					trycolor[(j + k) % _stagenum] += mLevelNodeNum[treeIdx][k]; // wrap around
-				}
-
-				// compute variance
-				double sum = std::accumulate(trycolor, trycolor + _stagenum, 0.0);
-
-				double mean = sum / _stagenum;
-
-				double accum = 0.0;
-
-				for (int k = 0; k < _stagenum; ++k) {
-
-					accum += (trycolor[k] - mean) * (trycolor[k] - mean);
-				}
-				
-				double var = accum / _stagenum;
-
-//				std::cerr << "var: " << var << " bestVar: " << bestVar << std::endl;
-//				std::cin.get();
-
-				if (var < bestVar) {
-					
-					bestVar = var;
-
-					bestStartIdx = j;
-				}
-			}	
+			startIdx[i] = placer.place(mLevelNodeNum[vec[i].treeIdx], W - U + 1);
+		}
 
-			for (int j = 0; j < W - U + 1; ++j) {
-		
-				colored[(bestStartIdx + j) % _stagenum] += mLevelNodeNum[treeIdx][j]; // wrap around	
-			}
+		// step 3: color nodes in the binary trees, trees are independent of each other
+		utility::parallelFor(vec.size(), [&](const size_t i) {
 
-			// color nodes in current binary tree
-			node_type* root = mRootTable[treeIdx];
+			node_type* root = mRootTable[vec[i].treeIdx];
 
 			std::queue<node_type*> queue;
 
-			root->stageidx = bestStartIdx;
+			_map.stage(root->id) = startIdx[i];
 
 			queue.push(root);
 
@@ -922,23 +964,27 @@ public:
 
 				if (nullptr != front->lchild) {
 
-					front->lchild->stageidx = (front->stageidx + 1) % _stagenum; // wrap around
+					_map.stage(front->lchild->id) = (_map.stage(front->id) + 1) % _stagenum; // wrap around
 
 					queue.push(front->lchild);
 				}
 
 				if (nullptr != front->rchild) {
 
-					front->rchild->stageidx = (front->stageidx + 1) % _stagenum; // wrap around
+					_map.stage(front->rchild->id) = (_map.stage(front->id) + 1) % _stagenum; // wrap around
 
 					queue.push(front->rchild);
 				}
 
 				queue.pop();
 			}
-		} 
+		});
 
 		// collect information
+		size_t* colored = new size_t[_stagenum];
+
+		for (int i = 0; i < _stagenum; ++i) colored[i] = placer.getColored(i);
+
 		size_t nodeNumInAllStages = 0;
 
 		// compute total number of nodes 
@@ -970,13 +1016,16 @@ public:
 		std::cerr << "min ratio: " << min_ratio << " max ratio: " << max_ratio << " mean ratio: " << mean_ratio << std::endl;	
 
 		delete[] colored;
-
-		delete[] trycolor;
 	}
 
 
 	/// \brief update
-	void update(const std::string& _fn, int _pipestyle, int _stagenum = W - U + 1) {
+	///
+	/// \param _map mapping in which the new nodes are placed, nullptr for the own mapping of the index.
+	/// The other mappings do not cover the new nodes, and are to be scattered again before their traces are generated.
+	void update(const std::string& _fn, int _pipestyle, int _stagenum = W - U + 1, StageMap* _map = nullptr) {
+
+		if (nullptr == _map) _map = &mStageMap;
 
 		size_t withdrawnum = 0;
 
@@ -1001,6 +1050,10 @@ public:
 		
 		std::uniform_int_distribution<int> distribution(0, _stagenum - 1);
 
+		utility::PerfCounter& counter = utility::PerfCounter::get(utility::getPerfName("RPTree", {W, U}, "update"));
+
+		counter.start();
+
 		while (getline(fin, line)) {
 
 			// retrieve prefix and length
@@ -1016,13 +1069,15 @@ public:
 
 				++announcenum;
 
-				nexthop = length;
+				nexthop = utility::retrieveNexthop(line, length); // interned nexthop if given, or the length (for test only)
 
-				ins(prefix, length, nexthop, _pipestyle, generator, distribution, _stagenum);
+				ins(prefix, length, nexthop, _pipestyle, generator, distribution, _stagenum, *_map);
 			}
 		}
 
-		reportNodeNumInStage(_stagenum);
+		counter.stop(withdrawnum + announcenum);
+
+		reportNodeNumInStage(_stagenum, _map);
 
 		std::cerr << "withdraw num: " << withdrawnum << " announce num: " << announcenum << std::endl;
 
@@ -1030,7 +1085,7 @@ public:
 	}
 
 	/// \brief for update, insert into index
-	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, const int _pipestyle, std::default_random_engine& _generator, std::uniform_int_distribution<int>& _distribution, const int _stagenum) {
+	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, const int _pipestyle, std::default_random_engine& _generator, std::uniform_int_distribution<int>& _distribution, const int _stagenum, StageMap& _map) {
 
 		if (_length < U) { // insert into the fast table
 
@@ -1038,7 +1093,7 @@ public:
 		}
 		else { // insert into the PT forest
 
-			ins(_prefix, _length, _nexthop, mRootTable[utility::getBitsValue(_prefix, 0, U - 1)], U, utility::getBitsValue(_prefix, 0, U - 1), true, _pipestyle, std::numeric_limits<int>::max(), _generator, _distribution, _stagenum);
+			ins(_prefix, _length, _nexthop, mRootTable[utility::getBitsValue(_prefix, 0, U - 1)], U, utility::getBitsValue(_prefix, 0, U - 1), true, _pipestyle, std::numeric_limits<int>::max(), _generator, _distribution, _stagenum, _map);
 		}
 
 		return;
@@ -1046,23 +1101,27 @@ public:
 	}
 
 	/// \brief for update, insert into a prefix tree
-	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, node_type*& _node, const int _level, const size_t _treeIdx, const bool _isRoot, const int _pipestyle, const int _parentStageidx, std::default_random_engine& _generator, std::uniform_int_distribution<int>& _distribution, const int _stagenum) {
+	void ins(const ip_type& _prefix, const uint8& _length, const uint32& _nexthop, node_type*& _node, const int _level, const size_t _treeIdx, const bool _isRoot, const int _pipestyle, const int _parentStageidx, std::default_random_engine& _generator, std::uniform_int_distribution<int>& _distribution, const int _stagenum, StageMap& _map) {
 
 		if (nullptr == _node) { // create a new node and insert the prefix into the node
 
 			_node = new node_type();
 
+			_node->id = mNodeIdNum++;
+
+			_map.resize(mNodeIdNum);
+
 			if (_isRoot) {
 
 				switch(_pipestyle) {
 
 				case 0: // linear pipeline, root is located at the first stage
-					_node->stageidx = 0; break;
+					_map.stage(_node->id) = 0; break;
 
 				case 1:
 				case 2: // circular and randome pipeline, root is randomly allocated into a stage
 
-					_node->stageidx = _distribution(_generator); break;
+					_map.stage(_node->id) = _distribution(_generator); break;
 				}
 			}
 			else { // not root node
@@ -1070,11 +1129,11 @@ public:
 				switch(_pipestyle) {
 
 				case 1: // random
-					_node->stageidx = _distribution(_generator); break;
+					_map.stage(_node->id) = _distribution(_generator); break;
 
 				case 0:
 				case 2:
-					_node->stageidx = (_parentStageidx + 1) % _stagenum; break;
+					_map.stage(_node->id) = (_parentStageidx + 1) % _stagenum; break;
 				}
 			}
 
@@ -1114,11 +1173,11 @@ public:
 					// recursively insert the cached prefix into higher levels
 					if (0 == utility::getBitValue(prefix, _level)) { 
 		
-						ins(prefix, length, nexthop, _node->lchild, _level + 1, _treeIdx, false, _pipestyle, _node->stageidx, _generator, _distribution, _stagenum);
+						ins(prefix, length, nexthop, _node->lchild, _level + 1, _treeIdx, false, _pipestyle, _map.stage(_node->id), _generator, _distribution, _stagenum, _map);
 					}
 					else {
 		
-						ins(prefix, length, nexthop, _node->rchild, _level + 1, _treeIdx, false, _pipestyle, _node->stageidx, _generator, _distribution, _stagenum);
+						ins(prefix, length, nexthop, _node->rchild, _level + 1, _treeIdx, false, _pipestyle, _map.stage(_node->id), _generator, _distribution, _stagenum, _map);
 					}
 				}
 				else { // the prefix in current node must be the same as the one to be inserted
@@ -1130,11 +1189,11 @@ public:
 	
 				if (0 == utility::getBitValue(_prefix, _level)) {
 	
-					ins(_prefix, _length, _nexthop, _node->lchild, _level + 1, _treeIdx, false, _pipestyle, _node->stageidx, _generator, _distribution, _stagenum);
+					ins(_prefix, _length, _nexthop, _node->lchild, _level + 1, _treeIdx, false, _pipestyle, _map.stage(_node->id), _generator, _distribution, _stagenum, _map);
 				}
 				else {
 
-					ins(_prefix, _length, _nexthop, _node->rchild, _level + 1, _treeIdx, false, _pipestyle, _node->stageidx, _generator, _distribution, _stagenum);
+					ins(_prefix, _length, _nexthop, _node->rchild, _level + 1, _treeIdx, false, _pipestyle, _map.stage(_node->id), _generator, _distribution, _stagenum, _map);
 				}
 			}
 		}
@@ -1143,7 +1202,11 @@ public:
 	}
 
 	/// \brief report number of nodes in each stage
-	void reportNodeNumInStage(int _stagenum) {
+	///
+	/// \param _map mapping of the nodes, nullptr for the own mapping of the index
+	void reportNodeNumInStage(int _stagenum, const StageMap* _map = nullptr) {
+
+		if (nullptr == _map) _map = &mStageMap;
 
 		size_t* nodeNumInStage = new size_t[_stagenum];
 
@@ -1166,7 +1229,7 @@ public:
 
 				while(!queue.empty()) {
 
-					nodeNumInStage[queue.front()->stageidx]++;
+					nodeNumInStage[_map->stage(queue.front()->id)]++;
 
 					if (nullptr != queue.front()->lchild) queue.push(queue.front()->lchild);
 
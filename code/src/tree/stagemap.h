@@ -0,0 +1,130 @@
+#ifndef _STAGEMAP_H
+#define _STAGEMAP_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file stagemap.h
+/// \brief Definition of the mapping of the nodes of an index to pipe stages.
+///
+/// Keep the stage and the memory bank of each node apart from the nodes, so that an index built once holds several mappings.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+
+#include <vector>
+#include <string>
+
+
+/// \brief Mapping of the nodes of an index to pipe stages and memory banks.
+///
+/// The nodes are numbered by the index as they are created, and the stage and the bank of each node are kept in side arrays indexed by the node ID.
+/// Thus, one built index can hold several mappings at once, e.g., to linear, random and circular pipelines with different numbers of stages,
+/// each one given to scatterToPipeline() and generateTrace() of the trees.
+/// A node not mapped yet is in stage 0 and bank 0.
+///
+/// The arrays are sized by resize() before the nodes are mapped, so that the nodes can be mapped by several threads.
+class StageMap{
+
+private:
+
+	std::vector<int> mStage; ///< stage of each node
+
+	std::vector<int> mBank; ///< bank of each node in its stage
+
+	int mStageNum; ///< number of pipe stages
+
+	int mBankNum; ///< number of memory banks per pipe stage
+
+public:
+
+	/// \brief ctor
+	StageMap() : mStageNum(0), mBankNum(1) {}
+
+	/// \brief make room for the nodes with IDs below _nodenum
+	void resize(const size_t _nodenum) {
+
+		if (_nodenum > mStage.size()) {
+
+			mStage.resize(_nodenum, 0);
+
+			mBank.resize(_nodenum, 0);
+		}
+
+		return;
+	}
+
+	/// \brief remove all the nodes
+	void clear() {
+
+		mStage.clear();
+
+		mBank.clear();
+
+		return;
+	}
+
+	/// \brief stage of a node
+	int& stage(const uint32 _id) {
+
+		return mStage[_id];
+	}
+
+	/// \brief stage of a node
+	int stage(const uint32 _id) const {
+
+		return mStage[_id];
+	}
+
+	/// \brief bank of a node
+	int& bank(const uint32 _id) {
+
+		return mBank[_id];
+	}
+
+	/// \brief stage * banknum + bank of a node, as given in the traces
+	int getSlot(const uint32 _id) const {
+
+		return mStage[_id] * mBankNum + mBank[_id];
+	}
+
+	/// \brief number of pipe stages
+	int getStageNum() const {
+
+		return mStageNum;
+	}
+
+	/// \brief number of memory banks per pipe stage
+	int getBankNum() const {
+
+		return mBankNum;
+	}
+
+	/// \brief set the numbers of stages and banks, when the nodes are scattered
+	void setPipeline(const int _stagenum, const int _banknum) {
+
+		mStageNum = _stagenum;
+
+		mBankNum = _banknum;
+
+		return;
+	}
+};
+
+
+/// \brief a trace file generated under a mapping, see generateTrace() of the trees
+struct TraceOutput{
+
+	const StageMap* map; ///< mapping of the nodes to the stages
+
+	std::string traceFile; ///< trace file
+
+	uint32 stageNum; ///< number of pipe stages, for the workload reported
+
+	TraceOutput(const StageMap* _map, const std::string& _traceFile, const uint32 _stageNum) : map(_map), traceFile(_traceFile), stageNum(_stageNum) {}
+};
+
+#endif // _STAGEMAP_H
@@ -0,0 +1,147 @@
+#ifndef _STAGEPLACER_H
+#define _STAGEPLACER_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file stageplacer.h
+/// \brief Definition of the node placer for a random pipeline.
+///
+/// Decide the pipe stage of each node when scattering a forest into a random pipeline.
+/// The placer keeps track of the memory occupied in each pipe stage, so that
+/// load-aware policies can be applied while the nodes are visited one by one.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <limits>
+
+
+/// \brief Place nodes into the stages of a random pipeline.
+///
+/// Three policies are supported:
+/// 0 (uniform): a node is located at a stage chosen uniformly at random.
+/// 1 (power-of-two-choices): two stages are chosen at random and the node goes to the one with less memory in use.
+/// 2 (greedy): the node goes to the least-loaded stage other than the one accommodating its parent.
+///
+/// \note The memory in use is measured in the unit given by the caller (bytes, nodes or entries).
+class StagePlacer{
+
+private:
+
+	int mStageNum; ///< number of pipe stages
+
+	int mPolicy; ///< placement policy
+
+	std::vector<size_t> mMemUseInStage; ///< memory in use for each pipe stage
+
+	std::default_random_engine mGenerator; ///< random generator
+
+	std::uniform_int_distribution<int> mDistribution; ///< uniform distribution over [0, mStageNum - 1]
+
+public:
+
+	/// \brief ctor
+	///
+	/// \param _stagenum number of pipe stages
+	/// \param _policy 0, 1 or 2 for uniform, power-of-two-choices or greedy, respectively
+	/// \param _seed seed of the random generator
+	StagePlacer(const int _stagenum, const int _policy, const unsigned _seed = std::chrono::system_clock::now().time_since_epoch().count()) :
+		mStageNum(_stagenum),
+		mPolicy(_policy),
+		mMemUseInStage(_stagenum, 0),
+		mGenerator(_seed),
+		mDistribution(0, _stagenum - 1) {}
+
+	/// \brief determine the stage for a node and account for its memory
+	///
+	/// \param _size memory required by the node
+	/// \param _parentStageidx stage of the parent node, -1 for a root node
+	int place(const size_t _size, const int _parentStageidx = -1) {
+
+		int stageidx = 0;
+
+		switch (mPolicy) {
+
+		case 1: { // power-of-two-choices
+
+			int first = mDistribution(mGenerator);
+
+			int second = mDistribution(mGenerator);
+
+			stageidx = (mMemUseInStage[second] < mMemUseInStage[first]) ? second : first;
+
+			break;
+		}
+
+		case 2: { // greedy, least-loaded stage other than the parent's
+
+			size_t minMemUse = std::numeric_limits<size_t>::max();
+
+			for (int i = 0; i < mStageNum; ++i) {
+
+				if (i == _parentStageidx && mStageNum > 1) continue;
+
+				if (mMemUseInStage[i] < minMemUse) {
+
+					minMemUse = mMemUseInStage[i];
+
+					stageidx = i;
+				}
+			}
+
+			break;
+		}
+
+		default: // uniform
+
+			stageidx = mDistribution(mGenerator);
+		}
+
+		mMemUseInStage[stageidx] += _size;
+
+		return stageidx;
+	}
+
+	/// \brief memory in use for a stage
+	size_t getMemUse(const int _stageidx) const {
+
+		return mMemUseInStage[_stageidx];
+	}
+
+	/// \brief memory in use for the largest stage, which determines the size of a memory block per stage
+	size_t getMaxMemUse() const {
+
+		size_t maxMemUse = 0;
+
+		for (int i = 0; i < mStageNum; ++i) {
+
+			if (maxMemUse < mMemUseInStage[i]) maxMemUse = mMemUseInStage[i];
+		}
+
+		return maxMemUse;
+	}
+
+	/// \brief print name of the policy in use
+	void reportPolicy() const {
+
+		switch (mPolicy) {
+
+		case 1: std::cerr << "placement policy: power-of-two-choices" << std::endl; break;
+
+		case 2: std::cerr << "placement policy: greedy least-loaded" << std::endl; break;
+
+		default: std::cerr << "placement policy: uniform" << std::endl;
+		}
+
+		return;
+	}
+};
+
+#endif // _STAGEPLACER_H
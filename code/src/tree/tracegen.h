@@ -0,0 +1,260 @@
+#ifndef _TRACEGEN_H
+#define _TRACEGEN_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file tracegen.h
+/// \brief Generation of the lookup traces on multiple threads, shared by the trees.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+#include "../common/utility.h"
+#include "../common/perfcounter.h"
+#include "../common/parallel.h"
+#include "stagemap.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+/// \brief Lookups of a batch of requests, searched and formatted by a worker thread.
+///
+/// The buffers are kept over the chunks, so that a worker does not allocate them per request.
+struct TraceBatch{
+
+	std::vector<int> steps; ///< node IDs visited by all the lookups in a row, appended by search()
+
+	std::vector<size_t> ends; ///< end of the steps of each lookup in steps
+
+	std::vector<uint32> nexthops; ///< nexthop of each lookup, filled in if a route cache needs it
+
+	std::vector<bool> moreSpecifics; ///< whether the match of each lookup has more specific prefixes, filled in if a route cache needs it
+
+	std::vector<bool> bypassed; ///< whether each lookup bypasses the pipeline, i.e., its trace has no step
+
+	std::vector<std::string> texts; ///< traces formatted for each output
+
+	/// \brief number of the lookups
+	size_t size() const {
+
+		return ends.size();
+	}
+
+	/// \brief number of steps of a lookup, bypassed or not
+	size_t getDepth(const size_t _idx) const {
+
+		return ends[_idx] - (0 == _idx ? 0 : ends[_idx - 1]);
+	}
+
+	/// \brief remove the lookups, keeping the memory
+	void clear() {
+
+		steps.clear();
+
+		ends.clear();
+
+		nexthops.clear();
+
+		moreSpecifics.clear();
+
+		bypassed.clear();
+
+		return;
+	}
+
+	/// \brief format the traces for each output, in the format of the trace files, i.e., "depth slot slot ... \n" per lookup
+	void format(const std::vector<TraceOutput>& _outputs) {
+
+		texts.resize(_outputs.size());
+
+		for (size_t k = 0; k < _outputs.size(); ++k) {
+
+			std::string& text = texts[k];
+
+			const StageMap& map = *_outputs[k].map;
+
+			text.clear();
+
+			size_t beg = 0;
+
+			for (size_t i = 0; i < ends.size(); ++i) {
+
+				if (bypassed[i]) {
+
+					append(text, 0);
+				}
+				else {
+
+					append(text, ends[i] - beg);
+
+					for (size_t j = beg; j < ends[i]; ++j) append(text, static_cast<size_t>(map.getSlot(steps[j])));
+				}
+
+				text.push_back('\n');
+
+				beg = ends[i];
+			}
+		}
+
+		return;
+	}
+
+	/// \brief append a number and a space, as written by operator<<
+	static void append(std::string& _text, size_t _num) {
+
+		char digits[24];
+
+		int len = 0;
+
+		do {
+
+			digits[len++] = static_cast<char>('0' + _num % 10);
+
+			_num /= 10;
+
+		} while (0 != _num);
+
+		while (len > 0) _text.push_back(digits[--len]);
+
+		_text.push_back(' ');
+
+		return;
+	}
+};
+
+
+/// \brief Generate the traces of the requests in a file on a group of worker threads.
+///
+/// The requests are read in chunks, each split into batches of SEARCHBATCH requests searched by the workers,
+/// and the batches are written out in order, thus the traces and the statistics are the same as those generated by a single thread.
+/// A route cache, if any, is looked up in order between the search and the output, since its content depends on the requests before.
+///
+/// \param I type of an IP address
+template<typename I>
+class TraceGenerator{
+
+private:
+
+	std::vector<TraceBatch> mBatches; ///< batches of a chunk, one per task
+
+	size_t mSearchNum; ///< number of requests searched
+
+	size_t mStepNum; ///< number of steps in the traces, i.e., without the steps bypassed
+
+public:
+
+	/// \brief ctor
+	TraceGenerator() : mSearchNum(0), mStepNum(0) {}
+
+	/// \brief average depth of the traces
+	double getAvgSearchDepth() const {
+
+		return 0 == mSearchNum ? 0.0 : static_cast<double>(mStepNum) / mSearchNum;
+	}
+
+	/// \brief generate the traces without a route cache
+	///
+	/// \param _search search(ip, batch) appending the steps of a lookup to batch.steps, called by the workers at the same time
+	template<typename S>
+	void run(const std::string& _reqFile, const std::vector<TraceOutput>& _outputs, const std::string& _perfName, S _search) {
+
+		run(_reqFile, _outputs, _perfName, _search, [](const I&, TraceBatch&, const size_t) { return false; });
+
+		return;
+	}
+
+	/// \brief generate the traces
+	///
+	/// \param _search search(ip, batch) appending the steps of a lookup to batch.steps, called by the workers at the same time
+	/// \param _bypass bypass(ip, batch, idx) checking if a lookup bypasses the pipeline, called in the order of the requests
+	template<typename S, typename B>
+	void run(const std::string& _reqFile, const std::vector<TraceOutput>& _outputs, const std::string& _perfName, S _search, B _bypass) {
+
+		std::ifstream reqFin(_reqFile, std::ios_base::binary);
+
+		std::vector<std::ofstream*> traFins;
+
+		for (auto& output : _outputs) traFins.push_back(new std::ofstream(output.traceFile, std::ios_base::binary));
+
+		// a few batches per worker in a chunk, so that the workers are balanced
+		size_t tasknum = 4 * utility::getWorkerNum(static_cast<size_t>(-1));
+
+		if (mBatches.size() < tasknum) mBatches.resize(tasknum);
+
+		std::vector<std::vector<I> > requests(tasknum);
+
+		mSearchNum = 0;
+
+		mStepNum = 0;
+
+		while (true) {
+
+			// step 1: read a chunk
+			size_t batchnum = 0;
+
+			while (batchnum < tasknum && utility::readRequestBatch(reqFin, requests[batchnum])) ++batchnum;
+
+			if (0 == batchnum) break;
+
+			// step 2: search the batches
+			utility::parallelFor(batchnum, [&](const size_t t) {
+
+				TraceBatch& batch = mBatches[t];
+
+				batch.clear();
+
+				utility::PerfCounter& counter = utility::PerfCounter::get(_perfName); // of the calling thread
+
+				counter.start();
+
+				for (auto& ip : requests[t]) {
+
+					_search(ip, batch);
+
+					batch.ends.push_back(batch.steps.size());
+				}
+
+				counter.stop(requests[t].size());
+			});
+
+			// step 3: look up the route cache in order
+			for (size_t t = 0; t < batchnum; ++t) {
+
+				TraceBatch& batch = mBatches[t];
+
+				for (size_t j = 0; j < batch.size(); ++j) {
+
+					bool bypassed = _bypass(requests[t][j], batch, j);
+
+					batch.bypassed.push_back(bypassed);
+
+					mSearchNum++;
+
+					if (!bypassed) mStepNum += batch.getDepth(j);
+				}
+			}
+
+			// step 4: format the batches, then write them in order
+			utility::parallelFor(batchnum, [&](const size_t t) {
+
+				mBatches[t].format(_outputs);
+			});
+
+			for (size_t k = 0; k < _outputs.size(); ++k) {
+
+				for (size_t t = 0; t < batchnum; ++t) traFins[k]->write(mBatches[t].texts[k].data(), mBatches[t].texts[k].size());
+			}
+		}
+
+		for (auto traFin : traFins) delete traFin;
+
+		return;
+	}
+};
+
+#endif // _TRACEGEN_H
@@ -0,0 +1,129 @@
+#ifndef _TRACER_H
+#define _TRACER_H
+
+////////////////////////////////////////////////////////////
+/// Copyright (c) 2016, Sun Yat-sen University,
+/// All rights reserved
+/// \file tracer.h
+/// \brief Policies of tracing the lookups, given to search() of the trees.
+///
+/// search() of a tree is a template on a tracer, and calls the tracer at each node visited (step()) and at each memory access (access()).
+/// The calls of NullTracer are empty and inlined, thus the plain search() is compiled without any tracing.
+///
+/// \author Yi Wu
+/// \date 2016.11
+///////////////////////////////////////////////////////////
+
+#include "../common/common.h"
+#include "../common/accesslog.h"
+
+#include <vector>
+
+
+/// \brief No tracing, for the lookups in production.
+struct NullTracer{
+
+	/// \brief a node visited, i.e., a step in the pipeline
+	void step(const uint32) {}
+
+	/// \brief memory accessed
+	void access(const void*, const uint32) {}
+};
+
+
+/// \brief Node IDs of a lookup in a buffer of fixed capacity inside the tracer, i.e., without allocation.
+///
+/// The steps beyond the capacity are counted but not kept.
+///
+/// \param N capacity, e.g., the number of stages of a linear pipeline
+template<size_t N>
+class BufferTracer{
+
+private:
+
+	uint32 mSteps[N]; ///< node IDs of the steps
+
+	size_t mSize; ///< number of steps
+
+public:
+
+	/// \brief ctor
+	BufferTracer() : mSize(0) {}
+
+	void step(const uint32 _id) {
+
+		if (mSize < N) mSteps[mSize] = _id;
+
+		++mSize;
+	}
+
+	void access(const void*, const uint32) {}
+
+	/// \brief number of steps, kept or not
+	size_t size() const {
+
+		return mSize;
+	}
+
+	/// \brief node ID of a step kept
+	uint32 operator[] (const size_t _idx) const {
+
+		return mSteps[_idx];
+	}
+
+	/// \brief check if some steps are not kept
+	bool isTruncated() const {
+
+		return mSize > N;
+	}
+
+	/// \brief remove the steps, for the next lookup
+	void clear() {
+
+		mSize = 0;
+	}
+};
+
+
+/// \brief Node IDs of a lookup appended to a vector, mapped to the stages by a StageMap, as the traces of the pipelines.
+class StageTracer{
+
+private:
+
+	std::vector<int>& mTrace; ///< trace appended
+
+public:
+
+	/// \brief ctor
+	StageTracer(std::vector<int>& _trace) : mTrace(_trace) {}
+
+	void step(const uint32 _id) {
+
+		mTrace.push_back(_id);
+	}
+
+	void access(const void*, const uint32) {}
+};
+
+
+/// \brief Memory accesses of a lookup recorded in a log, replayed by CacheSim.
+class AddressTracer{
+
+private:
+
+	utility::AccessLog& mLog; ///< log of the memory accesses
+
+public:
+
+	/// \brief ctor
+	AddressTracer(utility::AccessLog& _log) : mLog(_log) {}
+
+	void step(const uint32) {}
+
+	void access(const void* _addr, const uint32 _size) {
+
+		mLog.record(_addr, _size);
+	}
+};
+
+#endif // _TRACER_H
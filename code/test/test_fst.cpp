@@ -86,5 +86,9 @@ int main(int argc, char** argv){
 //	fst->traverse();
 
 
+	utility::NexthopTable::global().report();
+
+	utility::PerfCounter::reportAll();
+
 	return 0;
 }
@@ -11,9 +11,9 @@ static const int SN = 16; // number of pipe stages
 
 int main(int argc, char** argv){
 
-	if (argc != 4) {
+	if (argc != 4 && argc != 5) {
 		
-		std::cerr << "This program takes two parameters:\n";
+		std::cerr << "This program takes three or four parameters:\n";
 
 		std::cerr << "The 1st parameter specifies the file of the BGP table. We reuse the table to generate search requests.\n";
 	
@@ -21,6 +21,8 @@ int main(int argc, char** argv){
 
 		std::cerr << "The 3rd parameter specifies the update file.\n";
 
+		std::cerr << "The 4th parameter (optional) specifies the file for logging the memory accesses of the lookups, which is replayed by cachesim.\n";
+
 		exit(0);
 	}
 
@@ -46,6 +48,11 @@ int main(int argc, char** argv){
 		RBTree<PL, PT>* rbt = new RBTree<PL, PT>();
 		
 		rbt->build(bgptable);
+
+		// log the memory accesses of the lookups for cache simulation
+		if (argc > 4) utility::generateAccessLog<PL>(*rbt, reqFile, argv[4]);
+
+		utility::NexthopTable::global().report();
 	
 		// step 2: generate trace
 		std::cerr << "-----Scatter to linear pipeline.\n";
@@ -181,5 +188,7 @@ int main(int argc, char** argv){
 //
 //	rbt->traverse();
 
+	utility::PerfCounter::reportAll();
+
 	return 0;
 }
@@ -16,14 +16,16 @@ static const int SN = 16; ///< number of pipe stages
 
 int main(int argc, char** argv){
 
-	if (argc != 3) {
+	if (argc != 3 && argc != 4) {
 		
-		std::cerr << "This program takes two parameters:\n";
+		std::cerr << "This program takes two or three parameters:\n";
 
 		std::cerr << "The 1st parameter specifies the file of the BGP table. We reuse the table to generate search requests.\n";
 	
 		std::cerr << "The 2nd parameter specifies the file prefix for storing lookup trace. The trace is used for simulation.\n";
 
+		std::cerr << "The 3rd parameter (optional) specifies the file for logging the memory accesses of the lookups, which is replayed by cachesim.\n";
+
 		exit(0);
 	}
 
@@ -53,30 +55,59 @@ int main(int argc, char** argv){
 
 	std::cerr << "The method for determing fixed-strides is  " << fmn << std::endl;
 
+	// step 1: build the index once for all the pipelines
+	std::cerr << "-----Create the index.\n";
+			
+	// RFSTree<W, K, M, U>
+	// W = 32 or 128 for IPv4 or IPv6, respectively.
+	// K number of expansion level
+	// M fixed-stride method, 0, 1, or 2 for CPE, MINMAX or EVEN
+	// U threshold for classifying short & long prefixes
+	RFSTree<PL, EL, FM, PT>* rfst = new RFSTree<PL, EL, FM, PT>();
+		
+	rfst->build(bgptable);
+
+	// log the memory accesses of the lookups for cache simulation
+	if (argc > 3) utility::generateAccessLog<PL>(*rfst, reqFile, argv[3]);
+
+	// step 2: scatter to each pipeline in a mapping of its own
+	StageMap linMap, cirMap, ranMap;
+
+	std::cerr << "-----Scatter to linear pipeline.\n";
+
+	rfst->scatterToPipeline(linMap, 0);
+
+	std::cerr << "-----Scatter to circular pipeline.\n";
+
+	rfst->scatterToPipeline(cirMap, 2, SN);
+
+	std::cerr << "-----Scatter to random pipeline.\n";
+
+	rfst->scatterToPipeline(ranMap, 1, SN);
+
+	// step 3: generate the traces of all the pipelines in one pass
+	std::cerr << "-----Generate traces.\n";
+
+	std::string linTraceFile = std::string(argv[2]).append("_lin.dat");
+
+	std::string cirTraceFile = std::string(argv[2]).append("_cir.dat");
+
+	std::string ranTraceFile = std::string(argv[2]).append("_ran.dat");
+
+	std::vector<TraceOutput> outputs;
+
+	outputs.push_back(TraceOutput(&linMap, linTraceFile, EL));
+
+	outputs.push_back(TraceOutput(&cirMap, cirTraceFile, SN));
+
+	outputs.push_back(TraceOutput(&ranMap, ranTraceFile, SN));
+
+	rfst->generateTrace(reqFile, outputs);
+
+	delete rfst;
+
 	{ // linear pipeline
 
-		// step 1: build the index
-		std::cerr << "-----Create the index.\n";
-				
-		// RFSTree<W, K, M, U>
-		// W = 32 or 128 for IPv4 or IPv6, respectively.
-		// K number of expansion level
-		// M fixed-stride method, 0, 1, or 2 for CPE, MINMAX or EVEN
-		// U threshold for classifying short & long prefixes
-		RFSTree<PL, EL, FM, PT>* rfst = new RFSTree<PL, EL, FM, PT>();
-			
-		rfst->build(bgptable);
-	
-		// step 2: generate trace
-		std::cerr << "-----Scatter to linear pipeline.\n";
-	
-		rfst->scatterToPipeline(0);
-	
-		std::string linTraceFile = std::string(argv[2]).append("_lin.dat");
-	
-		rfst->generateTrace(reqFile, linTraceFile, EL);
-	
-		// step 3: schedule
 		std::cerr << "-----Schedule in a linear pipeline\n";
 			
 		LinSched<EL>* linsched = new LinSched<EL>();
@@ -84,34 +115,10 @@ int main(int argc, char** argv){
 		linsched->searchRun(linTraceFile);
 			
 		delete linsched;
-
-		delete rfst;
 	}
 
-	{ // circular pipeline
-
-		// step 1: build the index
-		std::cerr << "-----Create the index.\n";
-
-		// RFSTree<W, K, M, U>
-		// W = 32 or 128 for IPv4 or IPv6, respectively.
-		// K number of expansion level
-		// M fixed-stride method, 0, 1, or 2 for CPE, MINMAX or EVEN
-		// U threshold for classifying short & long prefixes
-		RFSTree<PL, EL, FM, PT>* rfst = new RFSTree<PL, EL, FM, PT>();
-	
-		rfst->build(bgptable);
-
-		// step 2: generate trace	
-		std::cerr << "-----Scatter to circular pipeline.\n";
-
-		rfst->scatterToPipeline(2, SN);
-		
-		std::string cirTraceFile = std::string(argv[2]).append("_cir.dat");
-		
-		rfst->generateTrace(reqFile, cirTraceFile, SN);
+	{ // circular pipeline, number of stages is given in SN
 
-		// step 3: schedule, number of stages is given in SN
 		std::cerr << "-----Schedule in circular pipeline.\n";
 			
 		CirSched<EL, SN>* cirsched = new CirSched<EL, SN>();
@@ -119,34 +126,10 @@ int main(int argc, char** argv){
 		cirsched->searchRun(cirTraceFile);
 			
 		delete cirsched;
-
-		delete rfst;	
 	}
 	
-	{ // random pipeline
-
-		// step 1: build the index
-		std::cerr << "-----Create the index.\n";
-
-		// RFSTree<W, K, M, U>
-		// W = 32 or 128 for IPv4 or IPv6, respectively.
-		// K number of expansion level
-		// M fixed-stride method, 0, 1, or 2 for CPE, MINMAX or EVEN
-		// U threshold for classifying short & long prefixes
-		RFSTree<PL, EL, FM, PT>* rfst = new RFSTree<PL, EL, FM, PT>();
-			
-		rfst->build(bgptable);
-
-		// step 2: generate trace
-		std::cerr << "-----Scatter to random pipeline.\n";
+	{ // random pipeline, number of stages is given in SN
 
-		rfst->scatterToPipeline(1, SN); // W - U + 1 = 32 - 8 + 1 = 25
-		
-		std::string ranTraceFile = std::string(argv[2]).append("_ran.dat");
-			
-		rfst->generateTrace(reqFile, ranTraceFile, SN);
-		
-		// step 3: schedule, number of stages is given in SN		
 		std::cerr << "-----Schedule in a random pipeline.\n";
 
 		RanSched<EL, SN>* ransched = new RanSched<EL, SN>();
@@ -154,10 +137,12 @@ int main(int argc, char** argv){
 		ransched->searchRun(ranTraceFile);
 	
 		delete ransched;
-
-		delete rfst;
 	}	
 
 
+	utility::NexthopTable::global().report();
+
+	utility::PerfCounter::reportAll();
+
 	return 0;
 }
@@ -14,15 +14,17 @@ static const int SN = 16; ///< number of pipe stages
 
 int main(int argc, char** argv){
 
-	if (argc != 4) {
+	if (argc != 4 && argc != 5) {
 
-		std::cerr << "This program takes two parameters:\n";
+		std::cerr << "This program takes three or four parameters:\n";
 
 		std::cerr << "The 1st parameter specifies the file of the BGP table. We reuse the table to generate search requests.\n";
 	
 		std::cerr << "The 2nd parameter specifies the file prefix for storing lookup trace. The trace is used for simulation.\n";
 
-		std::cerr << "The 3rd parameter specifies the update file.\n"; 
+		std::cerr << "The 3rd parameter specifies the update file.\n";
+
+		std::cerr << "The 4th parameter (optional) specifies the file for logging the memory accesses of the lookups, which is replayed by cachesim.\n"; 
 
 		exit(0);
 	}
@@ -47,6 +49,9 @@ int main(int argc, char** argv){
 	
 		rmpt->build(bgptable);
 
+		// log the memory accesses of the lookups for cache simulation
+		if (argc > 4) utility::generateAccessLog<PL>(*rmpt, reqFile, argv[4]);
+
 		// step 2: generate trace 
 		std::cerr << "-----Scatter to random pipeline.\n";
 
@@ -76,5 +81,9 @@ int main(int argc, char** argv){
 	}
 
 
+	utility::NexthopTable::global().report();
+
+	utility::PerfCounter::reportAll();
+
 	return 0;
 }
@@ -12,9 +12,9 @@ static const int SN = 16; ///< number of pipe stages
 
 int main(int argc, char** argv){
 
-	if (argc != 4) {
+	if (argc != 4 && argc != 5) {
 		
-		std::cerr << "This program takes three parameters:\n";
+		std::cerr << "This program takes three or four parameters:\n";
 
 		std::cerr << "The 1st parameter specifies the file of the BGP table. We reuse the table to generate search requests.\n";
 	
@@ -22,6 +22,8 @@ int main(int argc, char** argv){
 
 		std::cerr << "The 3rd parameter specifies the update file.\n";
 
+		std::cerr << "The 4th parameter (optional) specifies the file for logging the memory accesses of the lookups, which is replayed by cachesim.\n";
+
 		exit(0);
 	}
 
@@ -46,6 +48,9 @@ int main(int argc, char** argv){
 	
 		rpt->build(bgptable);
 
+		// log the memory accesses of the lookups for cache simulation
+		if (argc > 4) utility::generateAccessLog<PL>(*rpt, reqFile, argv[4]);
+
 		// step 2: generate trace
 		std::cerr << "-----Scatter to linear pipeline.\n";
 
@@ -156,5 +161,9 @@ int main(int argc, char** argv){
 	 	delete rpt;
 	}
 
+	utility::NexthopTable::global().report();
+
+	utility::PerfCounter::reportAll();
+
 	return 0;
 }
@@ -0,0 +1,243 @@
+#include "../src/tree/rbtree.h"
+#include "../src/common/utility.h"
+#include "../src/common/parallel.h"
+#include "../src/scheduler/cirsched.h"
+#include "../src/scheduler/ransched.h"
+
+#include <vector>
+#include <deque>
+
+static const size_t RN = 1024 * 1024 * 1; // number of lookups
+static const int PL = 32; // prefix length, 32 or 128
+static const int PT = 10; // threshold for short & long prefixes
+static const int SL = PL - PT + 1; // at most SL search steps for a request
+
+// grid of the sweep
+static const double LAMBDAS[] = {0.1, 0.3, 0.5, 0.7, 0.9}; // packet arriving probability
+static const int BURSTSIZES[] = {1, 2, 4}; // number of packets arriving at the same time
+static const int QUEUESIZES[] = {32, 128, 512}; // size of queue
+static const int QUEUEPOLICIES[] = {1, 2}; // policy for full queues, 1 for tail drop and 2 for backpressure
+static const int STAGENUMS[] = {8, 16, 24, 32}; // number of pipe stages, each one must be instantiated in runPoint
+
+/// \brief a point in the grid and its results
+struct SweepPoint{
+
+	int pipestyle; ///< 1 for random pipeline and 2 for circular pipeline
+
+	int stagenum; ///< number of pipe stages
+
+	SchedParam param; ///< parameters of the run
+
+	const TraceBuffer* trace; ///< traces shared by all the points with the same pipestyle and stagenum
+
+	size_t slotnum; ///< number of time slots in total
+
+	double usage; ///< usage ratio
+
+	double avgQueueLength; ///< average queue length
+
+	size_t maxQueueLength; ///< maximum queue length
+
+	double lossRate; ///< dropped over offered
+
+	double blockingProb; ///< probability that an arrival finds a full queue
+
+	uint64 p99Latency; ///< 99th percentile of latency
+
+	uint64 p999Latency; ///< 99.9th percentile of latency
+};
+
+/// \brief run a point with K pipe stages
+template<int K>
+void runPoint(SweepPoint& _point) {
+
+	if (2 == _point.pipestyle) {
+
+		CirSched<SL, K>* cirsched = new CirSched<SL, K>();
+
+		cirsched->searchRun(*_point.trace, _point.param);
+
+		_point.slotnum = cirsched->getSlotNum();
+
+		_point.usage = cirsched->getUsageRatio();
+
+		_point.avgQueueLength = cirsched->getAvgQueueLength();
+
+		_point.maxQueueLength = cirsched->getMaxQueueLength();
+
+		_point.lossRate = cirsched->getSource().getLossRate();
+
+		_point.blockingProb = cirsched->getSource().getBlockingProb();
+
+		_point.p99Latency = cirsched->getLatencyStat().getLatency().getPercentile(0.99);
+
+		_point.p999Latency = cirsched->getLatencyStat().getLatency().getPercentile(0.999);
+
+		delete cirsched;
+	}
+	else {
+
+		RanSched<SL, K>* ransched = new RanSched<SL, K>();
+
+		ransched->searchRun(*_point.trace, _point.param);
+
+		_point.slotnum = ransched->getSlotNum();
+
+		_point.usage = ransched->getUsageRatio();
+
+		_point.avgQueueLength = ransched->getAvgQueueLength();
+
+		_point.maxQueueLength = ransched->getMaxQueueLength();
+
+		_point.lossRate = ransched->getSource().getLossRate();
+
+		_point.blockingProb = ransched->getSource().getBlockingProb();
+
+		_point.p99Latency = ransched->getLatencyStat().getLatency().getPercentile(0.99);
+
+		_point.p999Latency = ransched->getLatencyStat().getLatency().getPercentile(0.999);
+
+		delete ransched;
+	}
+
+	return;
+}
+
+/// \brief dispatch a point to the instance for its number of pipe stages
+void runPoint(SweepPoint& _point) {
+
+	switch (_point.stagenum) {
+
+	case 8: runPoint<8>(_point); break;
+
+	case 16: runPoint<16>(_point); break;
+
+	case 24: runPoint<24>(_point); break;
+
+	case 32: runPoint<32>(_point); break;
+
+	default: std::cerr << "stage number " << _point.stagenum << " is not instantiated.\n"; exit(1);
+	}
+
+	return;
+}
+
+int main(int argc, char** argv){
+
+	if (argc != 4) {
+
+		std::cerr << "This program takes three parameters:\n";
+
+		std::cerr << "The 1st parameter specifies the file of the BGP table. We reuse the table to generate search requests.\n";
+
+		std::cerr << "The 2nd parameter specifies the file prefix for storing lookup trace.\n";
+
+		std::cerr << "The 3rd parameter specifies the file for storing the results of the sweep.\n";
+
+		exit(0);
+	}
+
+	// generate search requests
+	std::string bgptable(argv[1]);
+
+	std::cerr << "-----Generate search requests.\n";
+
+	std::string reqFile = std::string(argv[2]).append("_req.dat");
+
+	utility::generateSearchRequest<PL>(bgptable, RN, reqFile);
+
+	// build the index
+	std::cerr << "-----Create the index.\n";
+
+	RBTree<PL, PT>* rbt = new RBTree<PL, PT>();
+
+	rbt->build(bgptable);
+
+	// generate traces, one for each pipestyle and stagenum, loaded into memory once
+	std::deque<TraceBuffer> traces;
+
+	std::vector<SweepPoint> points;
+
+	for (int pipestyle = 1; pipestyle <= 2; ++pipestyle) {
+
+		for (auto stagenum : STAGENUMS) {
+
+			std::cerr << "-----Scatter to " << (1 == pipestyle ? "random" : "circular") << " pipeline with " << stagenum << " stages.\n";
+
+			rbt->scatterToPipeline(pipestyle, stagenum);
+
+			std::string traceFile = std::string(argv[2]).append(1 == pipestyle ? "_ran_" : "_cir_").append(std::to_string(stagenum)).append(".dat");
+
+			rbt->generateTrace(reqFile, traceFile, stagenum);
+
+			traces.push_back(TraceBuffer());
+
+			traces.back().load(traceFile);
+
+			for (auto lambda : LAMBDAS) {
+
+				for (auto burstsize : BURSTSIZES) {
+
+					for (auto queuesize : QUEUESIZES) {
+
+						for (auto queuepolicy : QUEUEPOLICIES) {
+
+							SweepPoint point;
+
+							point.pipestyle = pipestyle;
+
+							point.stagenum = stagenum;
+
+							point.param.lambda = lambda;
+
+							point.param.burstsize = burstsize;
+
+							point.param.queuesize = queuesize;
+
+							point.param.queuepolicy = queuepolicy;
+
+							point.param.eventDriven = true;
+
+							point.param.report = false;
+
+							point.trace = &traces.back();
+
+							points.push_back(point);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	delete rbt;
+
+	// run all the points
+	std::cerr << "-----Run " << points.size() << " points on " << utility::getWorkerNum(points.size()) << " threads.\n";
+
+	utility::parallelFor(points.size(), [&points](const size_t i) {
+
+		runPoint(points[i]);
+	});
+
+	// write results
+	std::ofstream fout(argv[3], std::ios_base::binary);
+
+	fout << "pipeline stages lambda burst queue policy slots usage avg_queue max_queue loss_rate blocking p99_latency p999_latency\n";
+
+	for (auto& point : points) {
+
+		fout << (1 == point.pipestyle ? "ran" : "cir") << " " << point.stagenum << " " << point.param.lambda << " " << point.param.burstsize << " " << point.param.queuesize << " " << (1 == point.param.queuepolicy ? "drop" : "backpressure") << " "
+			<< point.slotnum << " " << point.usage << " " << point.avgQueueLength << " " << point.maxQueueLength << " " << point.lossRate << " " << point.blockingProb << " " << point.p99Latency << " " << point.p999Latency << "\n";
+	}
+
+	fout.close();
+
+	std::cerr << "-----Results are written to " << argv[3] << "\n";
+
+	utility::NexthopTable::global().report();
+
+	utility::PerfCounter::reportAll();
+
+	return 0;
+}